@@ -28,7 +28,13 @@ static void print_usage(const char *progname)
         "Options:\n"
         "  -d, --device=DEV    I2C device (default: %s)\n"
         "  -a, --address=ADDR  I2C address in hex (default: 0x%02X)\n"
-        "  -s, --size=SIZE     LCD size: 16x2 or 20x4 (default: 16x2)\n"
+        "  -s, --size=SIZE     LCD size: 16x2, 20x4 or 40x4 (default: 16x2)\n"
+        "  -t, --trace=FILE    Record bus traffic to FILE\n"
+        "  -p, --pinmap=MAP    Backpack wiring: default or mjkdz\n"
+        "  -x, --expander=CHIP Port expander: pcf8574, mcp23008, mcp23017\n"
+        "                      or plate (RGB LCD plate)\n"
+        "  -m, --mux=ADDR:CH   Backpack sits on channel CH of a TCA9548A\n"
+        "  -e, --emulate       Use the built-in emulator instead of hardware\n"
         "  -h, --help          Show this help message\n"
         "  -v, --version       Show version information\n"
         "\n"
@@ -40,19 +46,33 @@ static void print_usage(const char *progname)
         "  write TEXT          Write TEXT at current cursor position\n"
         "  cursor COL ROW      Set cursor position\n"
         "  backlight on|off    Turn backlight on or off\n"
+        "  color rgb|off       Backlight channels on an RGB plate (e.g. rb)\n"
         "  display on|off      Turn display on or off\n"
         "  cursor-show on|off  Show or hide cursor\n"
         "  cursor-blink on|off Enable or disable cursor blink\n"
         "  home                Return cursor to home position\n"
+        "  replay FILE [fast] [any]\n"
+        "                      Send a recorded bus trace to the display;\n"
+        "                      any: allow a trace recorded at another address\n"
+        "  dump                Read back and print screen and CGRAM contents\n"
+        "  scan [deep]         List backpacks on every I2C bus (read-only);\n"
+        "                      deep: write test patterns to each device,\n"
+        "                      which can briefly toggle its outputs\n"
+        "  stats COMMAND ...   Run COMMAND, then print bus and latency stats\n"
         "\n"
         "Examples:\n"
         "  %s init\n"
         "  %s line 0 \"Hello, World!\"\n"
         "  %s -a 0x3F -s 20x4 line 2 \"Line 3 text\"\n"
         "  %s backlight off\n"
+        "  %s stats line 0 \"Hello\"\n"
+        "  %s -t hello.trace line 0 \"Hello\"\n"
+        "  %s -e replay hello.trace fast\n"
+        "  %s scan\n"
         "\n",
         progname, DEFAULT_I2C_DEVICE, DEFAULT_I2C_ADDR,
-        progname, progname, progname, progname);
+        progname, progname, progname, progname, progname, progname,
+        progname, progname);
 }
 
 static void print_version(void)
@@ -82,6 +102,175 @@ static int parse_bool(const char *str, bool *value)
     return -1;
 }
 
+/* Backlight colour as channel letters ("rg", "b") or "off" */
+static int parse_color(const char *str, uint8_t *color)
+{
+    *color = 0;
+    if (strcasecmp(str, "off") == 0) {
+        return 0;
+    }
+    for (; *str; str++) {
+        switch (*str) {
+        case 'r': case 'R': *color |= I2CLCD_COLOR_RED;   break;
+        case 'g': case 'G': *color |= I2CLCD_COLOR_GREEN; break;
+        case 'b': case 'B': *color |= I2CLCD_COLOR_BLUE;  break;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void print_stats(i2clcd_t *lcd)
+{
+    i2clcd_stats_t st;
+    int i, b;
+
+    if (i2clcd_stats_get(lcd, &st) != I2CLCD_OK) {
+        return;
+    }
+
+    printf("bus:      %llu transactions, %llu bytes, %llu us\n",
+           (unsigned long long)st.xfers,
+           (unsigned long long)st.bytes,
+           (unsigned long long)(st.bus_ns / 1000));
+    printf("sleep:    %llu sleeps, %llu us\n",
+           (unsigned long long)st.sleeps,
+           (unsigned long long)(st.sleep_ns / 1000));
+    printf("syscalls: %llu\n", (unsigned long long)st.syscalls);
+    printf("errors:   %llu (%llu retries)\n",
+           (unsigned long long)st.errors,
+           (unsigned long long)st.retries);
+    if (st.recoveries) {
+        printf("recovery: %llu runs, %llu us total, %llu us max\n",
+               (unsigned long long)st.recoveries,
+               (unsigned long long)(st.recovery_ns / 1000),
+               (unsigned long long)(st.recovery_max_ns / 1000));
+    }
+    if (st.disconnects || st.reconnects) {
+        printf("link:     %llu disconnects, %llu reconnects\n",
+               (unsigned long long)st.disconnects,
+               (unsigned long long)st.reconnects);
+    }
+
+    printf("commands:");
+    for (i = 0; i < I2CLCD_CMD_TYPE_COUNT; i++) {
+        if (st.commands[i]) {
+            printf(" %s=%llu", i2clcd_stats_cmd_name((i2clcd_cmd_type_t)i),
+                   (unsigned long long)st.commands[i]);
+        }
+    }
+    printf("\n");
+
+    for (i = 0; i < I2CLCD_API_COUNT; i++) {
+        const i2clcd_hist_t *h = &st.api[i];
+
+        if (!h->count) {
+            continue;
+        }
+
+        printf("%-16s n=%llu mean=%lluus max=%lluus err=%llu\n",
+               i2clcd_stats_api_name((i2clcd_api_t)i),
+               (unsigned long long)h->count,
+               (unsigned long long)(h->total_ns / h->count / 1000),
+               (unsigned long long)(h->max_ns / 1000),
+               (unsigned long long)h->errors);
+        for (b = 0; b < I2CLCD_HIST_BUCKETS; b++) {
+            if (h->buckets[b]) {
+                printf("  >= %10lluns: %llu\n", 1ULL << b,
+                       (unsigned long long)h->buckets[b]);
+            }
+        }
+    }
+}
+
+static void print_screen(i2clcd_t *lcd)
+{
+    char line[I2CLCD_MAX_COLS + 1];
+    uint8_t cols, rows, r;
+
+    if (i2clcd_get_size(lcd, &cols, &rows) != I2CLCD_OK) {
+        return;
+    }
+
+    for (r = 0; r < rows; r++) {
+        if (i2clcd_emu_line(lcd, r, line, sizeof(line)) == I2CLCD_OK) {
+            printf("|%s|\n", line);
+        }
+    }
+}
+
+/* Read the screen back through the RW line (needs a backpack that wires it) */
+static i2clcd_err_t dump_screen(i2clcd_t *lcd)
+{
+    static const uint8_t row_bank[4] = { 0x00, 0x40, 0x00, 0x40 };
+    uint8_t cols, rows, r, i, ac, addr;
+    uint8_t buf[64];
+    i2clcd_err_t err;
+
+    err = i2clcd_get_size(lcd, &cols, &rows);
+    if (err == I2CLCD_OK) {
+        err = i2clcd_read_addr(lcd, &ac);
+    }
+    if (err != I2CLCD_OK) {
+        return err;
+    }
+
+    for (r = 0; r < rows; r++) {
+        /* Rows 2 and 3 continue rows 0 and 1 in the same 40-cell bank */
+        addr = (uint8_t)(row_bank[r] + (r >= 2 ? cols : 0));
+        err = i2clcd_read_mem(lcd, false, addr, buf, cols);
+        if (err != I2CLCD_OK) {
+            return err;
+        }
+        printf("%u: |", r);
+        for (i = 0; i < cols; i++) {
+            putchar(buf[i] >= 0x20 && buf[i] < 0x7F ? buf[i] : '.');
+        }
+        printf("|\n");
+    }
+
+    err = i2clcd_read_mem(lcd, true, 0, buf, 64);
+    if (err != I2CLCD_OK) {
+        return err;
+    }
+    for (r = 0; r < 8; r++) {
+        printf("CGRAM %u:", r);
+        for (i = 0; i < 8; i++) {
+            printf(" %02X", buf[r * 8 + i] & 0x1F);
+        }
+        printf("\n");
+    }
+    printf("Address counter: 0x%02X\n", ac);
+
+    return I2CLCD_OK;
+}
+
+/* Probe every bus; needs no open handle */
+static int scan_buses(bool deep)
+{
+    i2clcd_scan_result_t found[64];
+    size_t count, i;
+    i2clcd_err_t err;
+
+    err = i2clcd_scan(found, 64, deep ? I2CLCD_SCAN_DEEP : 0, &count);
+    if (err != I2CLCD_OK) {
+        fprintf(stderr, "Error: %s\n", i2clcd_strerror(err));
+        return 1;
+    }
+
+    for (i = 0; i < count && i < 64; i++) {
+        printf("%s 0x%02X %s\n", found[i].device, found[i].addr,
+               found[i].busy ? "in use by a kernel driver" :
+               found[i].backpack ? "PCF8574 backpack" : "other device");
+    }
+    if (count == 0) {
+        printf("No devices found\n");
+    }
+
+    return 0;
+}
+
 static int parse_size(const char *str, i2clcd_size_t *size)
 {
     if (strcmp(str, "16x2") == 0 || strcmp(str, "1602") == 0) {
@@ -92,6 +281,10 @@ static int parse_size(const char *str, i2clcd_size_t *size)
         *size = I2CLCD_20X4;
         return 0;
     }
+    if (strcmp(str, "40x4") == 0 || strcmp(str, "4004") == 0) {
+        *size = I2CLCD_40X4;
+        return 0;
+    }
     return -1;
 }
 
@@ -99,13 +292,24 @@ int main(int argc, char *argv[])
 {
     i2clcd_config_t config = I2CLCD_CONFIG_DEFAULT;
     i2clcd_t *lcd = NULL;
+    i2clcd_mux_t *mux = NULL;
     i2clcd_err_t err;
+    i2clcd_vclock_t vc;
+    i2clcd_clock_t clock;
+    const char *trace = NULL;
+    static const i2clcd_pinmap_t mjkdz = I2CLCD_PINMAP_MJKDZ;
+    static const i2clcd_pinmap_t mcp23008 = I2CLCD_PINMAP_MCP23008;
     int ret = 0;
 
     static struct option long_options[] = {
         {"device",  required_argument, 0, 'd'},
         {"address", required_argument, 0, 'a'},
         {"size",    required_argument, 0, 's'},
+        {"trace",   required_argument, 0, 't'},
+        {"pinmap",  required_argument, 0, 'p'},
+        {"expander", required_argument, 0, 'x'},
+        {"mux",     required_argument, 0, 'm'},
+        {"emulate", no_argument,       0, 'e'},
         {"help",    no_argument,       0, 'h'},
         {"version", no_argument,       0, 'v'},
         {0, 0, 0, 0}
@@ -113,7 +317,7 @@ int main(int argc, char *argv[])
 
     /* Parse options */
     int opt;
-    while ((opt = getopt_long(argc, argv, "d:a:s:hv",
+    while ((opt = getopt_long(argc, argv, "d:a:s:t:p:x:m:ehv",
                               long_options, NULL)) != -1) {
         switch (opt) {
         case 'd':
@@ -128,6 +332,50 @@ int main(int argc, char *argv[])
                 return 1;
             }
             break;
+        case 't':
+            trace = optarg;
+            break;
+        case 'p':
+            if (strcmp(optarg, "mjkdz") == 0) {
+                config.pinmap = &mjkdz;
+            } else if (strcmp(optarg, "default") != 0) {
+                fprintf(stderr, "Invalid pin map: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'x':
+            if (strcmp(optarg, "mcp23008") == 0) {
+                config.expander = I2CLCD_EXPANDER_MCP23008;
+            } else if (strcmp(optarg, "mcp23017") == 0) {
+                config.expander = I2CLCD_EXPANDER_MCP23017;
+            } else if (strcmp(optarg, "plate") == 0) {
+                config.expander = I2CLCD_EXPANDER_RGB_PLATE;
+            } else if (strcmp(optarg, "pcf8574") == 0) {
+                config.expander = I2CLCD_EXPANDER_PCF8574;
+            } else {
+                fprintf(stderr, "Invalid expander: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'm': {
+            char *end;
+            long addr = strtol(optarg, &end, 0);
+
+            if (*end != ':' || i2clcd_mux_create((uint8_t)addr, &mux) !=
+                I2CLCD_OK) {
+                fprintf(stderr, "Invalid mux: %s\n", optarg);
+                return 1;
+            }
+            config.mux = mux;
+            config.mux_channel = (uint8_t)strtol(end + 1, NULL, 0);
+            break;
+        }
+        case 'e':
+            /* Nothing to wait for, so run on a virtual clock */
+            config.backend = I2CLCD_BACKEND_EMULATOR;
+            i2clcd_vclock_init(&vc, &clock);
+            config.clock = &clock;
+            break;
         case 'h':
             print_usage(argv[0]);
             return 0;
@@ -140,6 +388,11 @@ int main(int argc, char *argv[])
         }
     }
 
+    /* MCP23008 backpacks share one wiring unless told otherwise */
+    if (config.expander == I2CLCD_EXPANDER_MCP23008 && !config.pinmap) {
+        config.pinmap = &mcp23008;
+    }
+
     /* Need at least one command */
     if (optind >= argc) {
         fprintf(stderr, "Error: No command specified\n");
@@ -150,16 +403,41 @@ int main(int argc, char *argv[])
     const char *cmd = argv[optind];
     int nargs = argc - optind - 1;
     char **args = &argv[optind + 1];
+    bool stats = false;
 
-    /* Initialize or open LCD based on command */
-    if (strcmp(cmd, "init") == 0) {
-        err = i2clcd_init(&config, &lcd);
-    } else {
-        err = i2clcd_open(&config, &lcd);
+    /* "stats COMMAND ..." runs COMMAND and reports what it cost */
+    if (strcmp(cmd, "stats") == 0) {
+        if (nargs < 1) {
+            fprintf(stderr, "Error: stats requires a command\n");
+            return 1;
+        }
+        stats = true;
+        cmd = args[0];
+        nargs--;
+        args++;
+    }
+
+    if (strcmp(cmd, "scan") == 0) {
+        return scan_buses(nargs >= 1 && strcmp(args[0], "deep") == 0);
+    }
+
+    /* Open first so a trace also captures the initialization */
+    config.probe = true;
+    err = i2clcd_open(&config, &lcd);
+    if (err == I2CLCD_OK && trace) {
+        err = i2clcd_trace_start(lcd, trace);
+    }
+
+    /* An emulated controller powers up with every run */
+    if (err == I2CLCD_OK && (strcmp(cmd, "init") == 0 ||
+                             config.backend == I2CLCD_BACKEND_EMULATOR)) {
+        err = i2clcd_reinit(lcd);
     }
     if (err != I2CLCD_OK) {
         fprintf(stderr, "Error opening LCD: %s\n",
                 i2clcd_strerror(err));
+        i2clcd_deinit(lcd);
+        i2clcd_mux_destroy(mux);
         return 1;
     }
 
@@ -220,6 +498,16 @@ int main(int argc, char *argv[])
         }
         err = i2clcd_backlight(lcd, on);
 
+    } else if (strcmp(cmd, "color") == 0) {
+        uint8_t color;
+        if (nargs < 1 || parse_color(args[0], &color) != 0) {
+            fprintf(stderr, "Error: color requires channels (r, g, b) "
+                    "or off\n");
+            ret = 1;
+            goto cleanup;
+        }
+        err = i2clcd_set_color(lcd, color);
+
     } else if (strcmp(cmd, "display") == 0) {
         if (nargs < 1) {
             fprintf(stderr, "Error: display requires on/off\n");
@@ -265,6 +553,25 @@ int main(int argc, char *argv[])
     } else if (strcmp(cmd, "home") == 0) {
         err = i2clcd_home(lcd);
 
+    } else if (strcmp(cmd, "replay") == 0) {
+        if (nargs < 1) {
+            fprintf(stderr, "Error: replay requires a trace file\n");
+            ret = 1;
+            goto cleanup;
+        }
+        unsigned int flags = 0;
+        for (int i = 1; i < nargs; i++) {
+            if (strcmp(args[i], "fast") == 0) {
+                flags |= I2CLCD_REPLAY_FAST;
+            } else if (strcmp(args[i], "any") == 0) {
+                flags |= I2CLCD_REPLAY_ANY_ADDR;
+            }
+        }
+        err = i2clcd_trace_replay(lcd, args[0], flags);
+
+    } else if (strcmp(cmd, "dump") == 0) {
+        err = dump_screen(lcd);
+
     } else {
         fprintf(stderr, "Error: Unknown command: %s\n", cmd);
         ret = 1;
@@ -276,7 +583,16 @@ int main(int argc, char *argv[])
         ret = 1;
     }
 
+    if (stats) {
+        print_stats(lcd);
+    }
+
+    if (config.backend == I2CLCD_BACKEND_EMULATOR) {
+        print_screen(lcd);
+    }
+
 cleanup:
     i2clcd_deinit(lcd);
+    i2clcd_mux_destroy(mux);
     return ret;
 }
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * bench.c - Standard workloads over the null backend
+ *
+ * Prints one CSV row per workload so results can be compared across
+ * releases. Bus time is modeled from the transaction sizes (9 clocks per
+ * byte including the address byte, plus START and STOP) rather than
+ * measured, and controller delays run on a virtual clock, so results do
+ * not depend on the machine's I2C hardware or timer resolution.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "i2clcd.h"
+
+#define MAX_DISPLAYS        4
+#define DEFAULT_FRAMES      2000
+#define DEFAULT_BUS_HZ      100000
+
+/*---------------------------------------------------------------------------
+ * Workloads
+ *---------------------------------------------------------------------------*/
+
+typedef struct {
+    const char   *name;
+    i2clcd_size_t size;
+    int           displays;
+    bool          composite;      /* Run through the compositor */
+    unsigned int  ops;            /* API calls per display per frame */
+    void        (*frame)(i2clcd_t *lcd, unsigned int n);
+    uint8_t       mirrors;        /* Mirror members per display */
+} workload_t;
+
+/* Every cell changes every frame */
+static void frame_redraw(i2clcd_t *lcd, unsigned int n)
+{
+    char text[I2CLCD_MAX_COLS + 1];
+    uint8_t cols, rows, r;
+
+    i2clcd_get_size(lcd, &cols, &rows);
+    for (r = 0; r < rows; r++) {
+        memset(text, 'A' + (n + r) % 26, cols);
+        text[cols] = '\0';
+        i2clcd_set_line(lcd, r, text);
+    }
+}
+
+/* Clear, then redraw every row */
+static void frame_clear_redraw(i2clcd_t *lcd, unsigned int n)
+{
+    i2clcd_clear(lcd);
+    frame_redraw(lcd, n);
+}
+
+/* A counter in the corner; usually only the last digit changes */
+static void frame_counter(i2clcd_t *lcd, unsigned int n)
+{
+    i2clcd_set_cursor(lcd, 14, 0);
+    i2clcd_printf(lcd, "%6u", n);
+    i2clcd_compositor_flush(lcd);
+}
+
+/* Text scrolling one cell per frame */
+static void frame_marquee(i2clcd_t *lcd, unsigned int n)
+{
+    static const char msg[] = "libi2clcd marquee -- scrolling text -- ";
+    char text[I2CLCD_MAX_COLS + 1];
+    size_t len = sizeof(msg) - 1;
+    uint8_t cols, i;
+
+    i2clcd_get_size(lcd, &cols, NULL);
+    for (i = 0; i < cols; i++) {
+        text[i] = msg[(n + i) % len];
+    }
+    text[cols] = '\0';
+
+    i2clcd_set_line(lcd, 0, text);
+    i2clcd_compositor_flush(lcd);
+}
+
+/* All eight custom characters redefined */
+static void frame_cgram(i2clcd_t *lcd, unsigned int n)
+{
+    uint8_t charmap[8];
+    uint8_t slot, row;
+
+    for (slot = 0; slot < 8; slot++) {
+        for (row = 0; row < 8; row++) {
+            charmap[row] = (uint8_t)((n + slot + row) & 0x1F);
+        }
+        i2clcd_create_char(lcd, slot, charmap);
+    }
+}
+
+static const workload_t workloads[] = {
+    { "redraw_16x2",   I2CLCD_16X2, 1,    false, 2, frame_redraw,       0 },
+    { "redraw_20x4",   I2CLCD_20X4, 1,    false, 4, frame_redraw,       0 },
+    { "clear_20x4",    I2CLCD_20X4, 1,    false, 5, frame_clear_redraw, 0 },
+    { "counter_20x4",  I2CLCD_20X4, 1,    true,  3, frame_counter,      0 },
+    { "marquee_16x2",  I2CLCD_16X2, 1,    true,  2, frame_marquee,      0 },
+    { "cgram_8",       I2CLCD_16X2, 1,    false, 8, frame_cgram,        0 },
+    { "fanout_4x20x4", I2CLCD_20X4, 4,    false, 4, frame_redraw,       0 },
+    { "mirror_4x20x4", I2CLCD_20X4, 1,    false, 4, frame_redraw,       3 },
+};
+
+/*---------------------------------------------------------------------------
+ * Measurement
+ *---------------------------------------------------------------------------*/
+
+static uint64_t cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int run(const workload_t *w, unsigned int frames, unsigned long bus_hz)
+{
+    i2clcd_config_t config = I2CLCD_CONFIG_DEFAULT;
+    i2clcd_t *lcds[MAX_DISPLAYS] = { NULL };
+    i2clcd_vclock_t vc;
+    i2clcd_clock_t clock;
+    i2clcd_stats_t st;
+    uint8_t m;
+    uint64_t bytes = 0, xfers = 0, delay_ns = 0, cpu, bus_ns;
+    double per_frame_ns;
+    unsigned int n;
+    int d, ret = 0;
+
+    config.size = w->size;
+    config.backend = I2CLCD_BACKEND_NULL;
+    config.clock = &clock;
+    i2clcd_vclock_init(&vc, &clock);
+
+    for (d = 0; d < w->displays; d++) {
+        if (i2clcd_init(&config, &lcds[d]) != I2CLCD_OK ||
+            (w->composite &&
+             i2clcd_compositor_start(lcds[d], 60) != I2CLCD_OK)) {
+            fprintf(stderr, "%s: setup failed\n", w->name);
+            ret = -1;
+            goto out;
+        }
+        for (m = 0; m < w->mirrors; m++) {
+            if (i2clcd_mirror_add(lcds[d], (uint8_t)(0x20 + m)) !=
+                I2CLCD_OK) {
+                fprintf(stderr, "%s: mirror setup failed\n", w->name);
+                ret = -1;
+                goto out;
+            }
+        }
+        i2clcd_stats_reset(lcds[d]);
+    }
+
+    cpu = cpu_ns();
+    for (n = 0; n < frames; n++) {
+        for (d = 0; d < w->displays; d++) {
+            w->frame(lcds[d], n);
+        }
+    }
+    cpu = cpu_ns() - cpu;
+
+    for (d = 0; d < w->displays; d++) {
+        i2clcd_stats_get(lcds[d], &st);
+        bytes += st.bytes;
+        xfers += st.xfers;
+        delay_ns += st.sleep_ns;
+    }
+
+    /* All displays share one bus */
+    bus_ns = (9 * (bytes + xfers) + 2 * xfers) * 1000000000ULL / bus_hz;
+    per_frame_ns = (double)(bus_ns + delay_ns + cpu) / frames;
+
+    printf("%s,%d,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+           w->name, w->displays * (1 + w->mirrors), frames,
+           (double)bytes / frames,
+           (double)xfers / frames,
+           (double)bus_ns / frames / 1000.0,
+           (double)delay_ns / frames / 1000.0,
+           (double)cpu / ((double)frames * w->ops * w->displays),
+           per_frame_ns > 0 ? 1e9 / per_frame_ns : 0.0);
+
+out:
+    for (d = 0; d < w->displays; d++) {
+        i2clcd_deinit(lcds[d]);
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int frames = DEFAULT_FRAMES;
+    unsigned long bus_hz = DEFAULT_BUS_HZ;
+    size_t i;
+    int opt, ret = 0;
+
+    while ((opt = getopt(argc, argv, "n:b:")) != -1) {
+        switch (opt) {
+        case 'n':
+            frames = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            bus_hz = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n FRAMES] [-b BUS_HZ]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (frames == 0 || bus_hz == 0) {
+        fprintf(stderr, "Frames and bus frequency must be non-zero\n");
+        return 1;
+    }
+
+    printf("workload,displays,frames,bytes_per_frame,xfers_per_frame,"
+           "bus_us_per_frame,delay_us_per_frame,cpu_ns_per_op,fps\n");
+
+    for (i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+        if (run(&workloads[i], frames, bus_hz) < 0) {
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
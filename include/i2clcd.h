@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,6 +21,10 @@ extern "C" {
 #define I2CLCD_VERSION_MINOR 0
 #define I2CLCD_VERSION_PATCH 0
 
+/* Largest geometry a single HD44780 can address */
+#define I2CLCD_MAX_COLS 40
+#define I2CLCD_MAX_ROWS 4
+
 /* Error codes */
 typedef enum {
     I2CLCD_OK              =  0,   /* Success */
@@ -29,6 +34,11 @@ typedef enum {
     I2CLCD_ERR_INVALID_ARG = -4,   /* Invalid argument */
     I2CLCD_ERR_NOT_INIT    = -5,   /* LCD not initialized */
     I2CLCD_ERR_RANGE       = -6,   /* Value out of range */
+    I2CLCD_ERR_NOMEM       = -7,   /* Out of memory */
+    I2CLCD_ERR_UNSUPPORTED = -8,   /* Not supported by this backend */
+    I2CLCD_ERR_IO          = -9,   /* File I/O or format error */
+    I2CLCD_ERR_NODEV       = -10,  /* No device answered at the address */
+    I2CLCD_ERR_INEXACT     = -11,  /* Replay skipped writes of unknown effect */
 } i2clcd_err_t;
 
 /* LCD size presets */
@@ -36,8 +46,73 @@ typedef enum {
     I2CLCD_16X2 = 0,   /* 16 columns, 2 rows (1602A) */
     I2CLCD_20X4 = 1,   /* 20 columns, 4 rows (2004A) */
     I2CLCD_CUSTOM,     /* Custom dimensions */
+    I2CLCD_40X4,       /* 40 columns, 4 rows, two controllers (4004A) */
 } i2clcd_size_t;
 
+/* Bus backends */
+typedef enum {
+    I2CLCD_BACKEND_I2CDEV = 0,   /* Linux i2c-dev character device */
+    I2CLCD_BACKEND_EMULATOR,     /* In-memory PCF8574 + HD44780 model */
+    I2CLCD_BACKEND_NULL,         /* Discards all traffic (benchmarking) */
+} i2clcd_backend_t;
+
+/* I/O expander on the backpack */
+typedef enum {
+    I2CLCD_EXPANDER_PCF8574 = 0, /* PCF8574(A), 4-bit bus */
+    I2CLCD_EXPANDER_MCP23008,    /* MCP23008 GPIO register, 4-bit bus */
+    I2CLCD_EXPANDER_MCP23017,    /* MCP23017: control on GPA, D0-D7 on GPB,
+                                    8-bit bus */
+    I2CLCD_EXPANDER_RGB_PLATE,   /* MCP23017 RGB LCD plate: LCD and blue on
+                                    GPB, red, green and buttons on GPA */
+} i2clcd_expander_t;
+
+/* Clock used for all delays and timestamps (see i2clcd_set_clock()) */
+typedef struct {
+    uint64_t (*now_ns)(void *user);   /* Monotonic time in nanoseconds */
+    void     (*sleep_until_ns)(void *user, uint64_t deadline_ns);
+    void      *user;                  /* Passed to both callbacks */
+} i2clcd_clock_t;
+
+/* PCF8574 port (0-7) wired to each HD44780 signal */
+typedef struct {
+    uint8_t rs, rw, en, bl;      /* Control lines and backlight */
+    uint8_t d4, d5, d6, d7;      /* Data bus (4-bit mode) */
+    bool    bl_active_low;       /* Backlight lights when its pin is low */
+} i2clcd_pinmap_t;
+
+/* The common backpack: RS=P0, RW=P1, EN=P2, BL=P3, D4-D7=P4-P7 */
+#define I2CLCD_PINMAP_DEFAULT { \
+    .rs = 0, .rw = 1, .en = 2, .bl = 3, \
+    .d4 = 4, .d5 = 5, .d6 = 6, .d7 = 7, \
+    .bl_active_low = false, \
+}
+
+/* Adafruit MCP23008 backpack: RS=GP1, EN=GP2, D4-D7=GP3-GP6, BL=GP7; RW is
+ * not connected (GP0 is spare) */
+#define I2CLCD_PINMAP_MCP23008 { \
+    .rs = 1, .rw = 0, .en = 2, .bl = 7, \
+    .d4 = 3, .d5 = 4, .d6 = 5, .d7 = 6, \
+    .bl_active_low = false, \
+}
+
+/* RGB LCD plate, port GPB: BLUE=GPB0 (inverted), D7-D4=GPB1-GPB4, EN=GPB5,
+ * RW=GPB6, RS=GPB7. The default for I2CLCD_EXPANDER_RGB_PLATE. */
+#define I2CLCD_PINMAP_RGB_PLATE { \
+    .rs = 7, .rw = 6, .en = 5, .bl = 0, \
+    .d4 = 4, .d5 = 3, .d6 = 2, .d7 = 1, \
+    .bl_active_low = true, \
+}
+
+/* mjkdz-style backpack: D4-D7=P0-P3, EN=P4, RW=P5, RS=P6, BL=P7 (inverted) */
+#define I2CLCD_PINMAP_MJKDZ { \
+    .rs = 6, .rw = 5, .en = 4, .bl = 7, \
+    .d4 = 0, .d5 = 1, .d6 = 2, .d7 = 3, \
+    .bl_active_low = true, \
+}
+
+/* Opaque TCA9548A I2C multiplexer (see I2C Multiplexer) */
+typedef struct i2clcd_mux i2clcd_mux_t;
+
 /* LCD configuration structure */
 typedef struct {
     const char    *i2c_device;   /* e.g., "/dev/i2c-1" */
@@ -46,6 +121,13 @@ typedef struct {
     uint8_t        cols;         /* Columns (used if size == I2CLCD_CUSTOM) */
     uint8_t        rows;         /* Rows (used if size == I2CLCD_CUSTOM) */
     bool           backlight;    /* Initial backlight state */
+    i2clcd_backend_t backend;    /* Bus backend (i2c_device unused if emulated) */
+    const i2clcd_clock_t *clock; /* Clock (NULL for CLOCK_MONOTONIC) */
+    bool           probe;        /* Check for an ACK in i2clcd_open() */
+    const i2clcd_pinmap_t *pinmap; /* Backpack wiring (NULL for the default) */
+    i2clcd_expander_t expander;  /* I/O expander type */
+    i2clcd_mux_t  *mux;          /* TCA9548A ahead of the backpack (or NULL) */
+    uint8_t        mux_channel;  /* Mux channel of the backpack (0-7) */
 } i2clcd_config_t;
 
 /* Opaque handle to LCD instance */
@@ -59,6 +141,13 @@ typedef struct i2clcd_ctx i2clcd_t;
     .cols       = 20,           \
     .rows       = 4,            \
     .backlight  = true,         \
+    .backend    = I2CLCD_BACKEND_I2CDEV, \
+    .clock      = NULL,         \
+    .probe      = false,        \
+    .pinmap     = NULL,         \
+    .expander   = I2CLCD_EXPANDER_PCF8574, \
+    .mux        = NULL,         \
+    .mux_channel = 0,           \
 }
 
 /*---------------------------------------------------------------------------
@@ -69,7 +158,9 @@ typedef struct i2clcd_ctx i2clcd_t;
  * @brief Initialize LCD with given configuration
  * @param config Pointer to configuration structure
  * @param handle Pointer to receive LCD handle on success
- * @return I2CLCD_OK on success, negative error code on failure
+ * @return I2CLCD_OK on success, I2CLCD_ERR_WRITE if the initialization
+ *         sequence could not be sent (the handle is closed and set to
+ *         NULL), negative error code on failure
  *
  * This performs the HD44780 initialization sequence but does not clear the
  * display. Call i2clcd_clear() explicitly if you want to clear the screen.
@@ -83,10 +174,25 @@ i2clcd_err_t i2clcd_init(const i2clcd_config_t *config, i2clcd_t **handle);
  * @return I2CLCD_OK on success, negative error code on failure
  *
  * Opens I2C connection without LCD initialization. Use for commands
- * after the LCD has been initialized with i2clcd_init().
+ * after the LCD has been initialized with i2clcd_init(). Shadow state starts
+ * empty; i2clcd_sync_shadow() reads it back from the panel. With
+ * config->probe set, a one-byte read checks that the backpack answers and
+ * I2CLCD_ERR_NODEV is returned if it does not.
  */
 i2clcd_err_t i2clcd_open(const i2clcd_config_t *config, i2clcd_t **handle);
 
+/**
+ * @brief Run the HD44780 initialization sequence on an open handle
+ * @param handle LCD handle from i2clcd_open()
+ * @return I2CLCD_OK on success, I2CLCD_ERR_WRITE if any write of the
+ *         sequence failed (the handle stays open), negative error code on
+ *         failure
+ *
+ * Equivalent to the sequence i2clcd_init() performs after opening. Useful
+ * when bus tracing should capture the initialization as well.
+ */
+i2clcd_err_t i2clcd_reinit(i2clcd_t *handle);
+
 /**
  * @brief Deinitialize LCD and free resources
  * @param handle LCD handle (may be NULL)
@@ -100,6 +206,84 @@ void i2clcd_deinit(i2clcd_t *handle);
  */
 const char *i2clcd_strerror(i2clcd_err_t err);
 
+/*---------------------------------------------------------------------------
+ * Discovery
+ *
+ * i2clcd_scan() probes the PCF8574 (0x20-0x27) and PCF8574A (0x38-0x3F)
+ * addresses on every /dev/i2c-* bus, one thread per bus, with a one-byte
+ * read each, and writes nothing by default. A device counts as a backpack
+ * when the levels read show EN and RW low on either built-in pin map, as an
+ * HD44780 driver leaves them; a PCF8574 nothing has written since power-up
+ * reads 0xFF and is not recognized.
+ *
+ * I2CLCD_SCAN_DEEP also writes two patterns with EN and RW low (invisible
+ * to the LCD) to every device that answers and reads them back: a PCF8574
+ * output latch echoes them, most other devices do not. The original latch
+ * is restored afterwards, but the writes briefly change the outputs of any
+ * expander there, toggling relays or an active-low backlight.
+ *---------------------------------------------------------------------------*/
+
+/* Scan flags */
+#define I2CLCD_SCAN_DEEP    0x01  /* Write probe patterns to each device */
+
+/* One device found by i2clcd_scan() */
+typedef struct {
+    char     device[32];    /* Bus device, e.g. "/dev/i2c-1" */
+    uint8_t  addr;          /* 7-bit address */
+    bool     backpack;      /* Idle pin levels (or echoed deep probe) */
+    bool     busy;          /* Address claimed by a kernel driver */
+    uint8_t  latch;         /* Pin levels read before probing */
+} i2clcd_scan_result_t;
+
+/**
+ * @brief Find devices at PCF8574/PCF8574A addresses on all I2C buses
+ * @param results Array to receive devices, ordered by bus then address
+ * @param max Capacity of results
+ * @param flags I2CLCD_SCAN_* flags, or 0 for a read-only scan
+ * @param count Receives the number of devices found (may exceed max)
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_scan(i2clcd_scan_result_t *results, size_t max,
+                         unsigned int flags, size_t *count);
+
+/*---------------------------------------------------------------------------
+ * Backpack Wiring
+ *
+ * Each pin map is compiled into lookup tables that turn an HD44780 byte,
+ * RS and the backlight state straight into the four PCF8574 bytes sent
+ * for it. The emulator models the wiring given in the configuration.
+ *
+ * MCP230xx expanders are set up once (byte mode, outputs) when the first
+ * write reaches them, and again after they lose power. The MCP23008 then
+ * behaves like a PCF8574 behind a GPIO register address. The MCP23017
+ * drives all eight data lines, so the controller runs in 8-bit mode with
+ * one enable strobe per byte; its control port GPA uses the pin map's
+ * rs/rw/en/bl ports and GPB carries D0-D7. Readback needs the
+ * quasi-bidirectional PCF8574 and is unsupported on MCP230xx backpacks.
+ *
+ * The RGB LCD plate is an MCP23017 with the 4-bit bus on GPB, so it costs
+ * one bus byte per port state like a PCF8574. See "RGB Plate" below.
+ *
+ * A 40x4 panel (I2CLCD_40X4) has two controllers on one bus: E1 drives
+ * lines 0-1 and E2 lines 2-3. Its RW line is tied low, and the pin map's
+ * rw port drives E2 instead (P1 with the default map). Each controller
+ * has its own shadow. Clear, home, initialization and custom characters
+ * go to both in the same strobes. A controller busy with a slow
+ * instruction only holds up writes to itself: the compositor redraws
+ * the other half first, so the two halves refresh concurrently. The
+ * cursor shows on the controller of the line it was last placed on.
+ * 40x4 panels need a 4-bit bus and have no readback.
+ *---------------------------------------------------------------------------*/
+
+/**
+ * @brief Change the backpack wiring used by a handle
+ * @param handle LCD handle
+ * @param map Pin map, or NULL for I2CLCD_PINMAP_DEFAULT
+ * @return I2CLCD_OK on success, I2CLCD_ERR_INVALID_ARG unless the map uses
+ *         each of P0-P7 exactly once
+ */
+i2clcd_err_t i2clcd_set_pinmap(i2clcd_t *handle, const i2clcd_pinmap_t *map);
+
 /*---------------------------------------------------------------------------
  * Display Control
  *---------------------------------------------------------------------------*/
@@ -224,8 +408,26 @@ i2clcd_err_t i2clcd_backlight_get(i2clcd_t *handle, bool *on);
 
 /*---------------------------------------------------------------------------
  * Custom Characters (CGRAM)
+ *
+ * Uploads only send the pattern rows the shadow CGRAM does not already
+ * hold, then put the address counter back on the cursor's DDRAM cell;
+ * i2clcd_create_chars() loads a run of slots with one address command
+ * through the controller's auto-increment.
+ *
+ * For more icons than the eight slots, let the glyph cache pick the slot:
+ * i2clcd_glyph() returns the slot holding a bitmap, uploading it only on a
+ * miss. A miss takes the least recently requested slot that no known cell
+ * on screen (or in the compositor back buffer) shows.
  *---------------------------------------------------------------------------*/
 
+/* Glyph cache statistics */
+typedef struct {
+    uint64_t hits;            /* Glyphs found in CGRAM */
+    uint64_t misses;          /* Glyphs uploaded */
+    uint64_t evictions;       /* Uploads that replaced a cached glyph */
+    uint64_t full;            /* Requests refused: every slot on screen */
+} i2clcd_glyph_stats_t;
+
 /**
  * @brief Define a custom character
  * @param handle LCD handle
@@ -236,6 +438,1226 @@ i2clcd_err_t i2clcd_backlight_get(i2clcd_t *handle, bool *on);
 i2clcd_err_t i2clcd_create_char(i2clcd_t *handle, uint8_t location,
                                 const uint8_t charmap[8]);
 
+/**
+ * @brief Define a contiguous range of custom characters
+ * @param handle LCD handle
+ * @param first First character code to define (0-7)
+ * @param count Number of characters; first + count must not exceed 8
+ * @param charmaps One 8-byte pattern per character
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_create_chars(i2clcd_t *handle, uint8_t first,
+                                 uint8_t count, const uint8_t charmaps[][8]);
+
+/**
+ * @brief Get the CGRAM slot of a glyph, uploading it on a miss
+ * @param handle LCD handle
+ * @param charmap 8-byte array defining 5x8 pixel pattern
+ * @param slot Pointer to receive the character code (0-7)
+ * @return I2CLCD_OK on success, I2CLCD_ERR_RANGE if all eight slots hold
+ *         glyphs that are on screen
+ */
+i2clcd_err_t i2clcd_glyph(i2clcd_t *handle, const uint8_t charmap[8],
+                          uint8_t *slot);
+
+/**
+ * @brief Get glyph cache statistics
+ * @param handle LCD handle
+ * @param stats Pointer to receive statistics
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_glyph_stats(i2clcd_t *handle,
+                                i2clcd_glyph_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * Glyph Animation
+ *
+ * A spinner or pulse drawn by rewriting cells costs an address and a data
+ * byte per cell, every frame. Animating the CGRAM slot instead changes
+ * every cell showing it with at most eight data bytes, and only the rows
+ * that differ from the previous frame go out. Frame deadlines are
+ * absolute and sit on one timeline per handle, so slots with related
+ * periods change together; a late frame is skipped, not queued. Frames
+ * are turned from i2clcd_anim_step() and, on time, from
+ * i2clcd_compositor_wait() and i2clcd_compositor_poll(), in their own
+ * short batches between display updates.
+ *---------------------------------------------------------------------------*/
+
+/* Most frames in one slot's sequence */
+#define I2CLCD_ANIM_FRAMES_MAX  16
+
+/* Animation statistics */
+typedef struct {
+    uint64_t frames;          /* Frames turned on their deadline */
+    uint64_t skipped;         /* Frames passed over because they were late */
+    uint64_t rows;            /* CGRAM rows written */
+    uint64_t lag_max_ns;      /* Worst lateness of a frame */
+} i2clcd_anim_stats_t;
+
+/**
+ * @brief Animate a CGRAM slot through a sequence of patterns
+ * @param handle LCD handle
+ * @param slot Character code to animate (0-7)
+ * @param frames One 8-byte pattern per frame (copied)
+ * @param count Number of frames (1-I2CLCD_ANIM_FRAMES_MAX)
+ * @param frame_ms Time each frame is shown
+ * @param loop Start over after the last frame; otherwise stop on it
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * The first frame is uploaded before returning. Starting a slot that is
+ * already animated replaces its sequence.
+ */
+i2clcd_err_t i2clcd_anim_start(i2clcd_t *handle, uint8_t slot,
+                               const uint8_t frames[][8], uint8_t count,
+                               uint32_t frame_ms, bool loop);
+
+/**
+ * @brief Stop animating a slot, leaving its current frame in place
+ * @param handle LCD handle
+ * @param slot Character code (0-7)
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_anim_stop(i2clcd_t *handle, uint8_t slot);
+
+/**
+ * @brief Turn every animation frame that is due
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_anim_step(i2clcd_t *handle);
+
+/**
+ * @brief Get animation statistics
+ * @param handle LCD handle
+ * @param stats Pointer to receive statistics
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_anim_stats(i2clcd_t *handle, i2clcd_anim_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * Compositor (Frame-Paced Updates)
+ *
+ * While the compositor is running, text writes (i2clcd_set_line(),
+ * i2clcd_clear_line(), i2clcd_clear(), i2clcd_putc(), i2clcd_puts(),
+ * i2clcd_printf()) and cursor moves only update a back buffer. The back
+ * buffer is diffed against what is already on the glass and sent at most
+ * once per frame, so intermediate states are coalesced.
+ *---------------------------------------------------------------------------*/
+
+/* Compositor statistics */
+typedef struct {
+    uint64_t frames;          /* Frame deadlines serviced */
+    uint64_t frames_flushed;  /* Frames that put bytes on the bus */
+    uint64_t frames_dropped;  /* Frame deadlines missed entirely */
+    uint64_t updates;         /* Writes accepted into the back buffer */
+    uint64_t updates_coalesced; /* Writes to rows already pending */
+    uint64_t cells_written;   /* Cells actually sent to the display */
+    uint64_t jitter_last_ns;  /* Lateness of the most recent frame */
+    uint64_t jitter_max_ns;   /* Worst lateness observed */
+    uint64_t jitter_mean_ns;  /* Mean lateness across frames */
+} i2clcd_compositor_stats_t;
+
+/**
+ * @brief Start compositing text writes into a back buffer
+ * @param handle LCD handle
+ * @param fps Frame rate for i2clcd_compositor_wait()/poll() (1-1000)
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * The back buffer starts as a copy of what is known to be on screen;
+ * unknown cells start as spaces. The first deadline is one frame from now.
+ */
+i2clcd_err_t i2clcd_compositor_start(i2clcd_t *handle, unsigned int fps);
+
+/**
+ * @brief Flush pending changes and return to immediate writes
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_compositor_stop(i2clcd_t *handle);
+
+/**
+ * @brief Send pending back buffer changes now, ignoring the frame clock
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_compositor_flush(i2clcd_t *handle);
+
+/**
+ * @brief Sleep until the next frame deadline, then flush
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * Deadlines are absolute on CLOCK_MONOTONIC, so the frame rate does not
+ * drift with flush time. If whole frames were missed they are counted as
+ * dropped and the schedule skips ahead rather than bursting to catch up.
+ */
+i2clcd_err_t i2clcd_compositor_wait(i2clcd_t *handle);
+
+/**
+ * @brief Flush if the current frame deadline has passed
+ * @param handle LCD handle
+ * @param flushed Set to true if a frame was serviced (may be NULL)
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * Non-blocking variant of i2clcd_compositor_wait() for event loops.
+ */
+i2clcd_err_t i2clcd_compositor_poll(i2clcd_t *handle, bool *flushed);
+
+/**
+ * @brief Get compositor statistics
+ * @param handle LCD handle
+ * @param stats Pointer to receive statistics
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_compositor_stats(i2clcd_t *handle,
+                                     i2clcd_compositor_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * Priority Lanes
+ *
+ * Every back buffer cell carries the priority of its pending write. Flushes
+ * send lanes from highest to lowest, so an alert goes out ahead of a bulk
+ * refresh queued in the same frame. While a cell holds a pending write, a
+ * lower-priority write to it is dropped; a higher-priority write replaces
+ * it. I2CLCD_PRIO_HIGH writes do not wait for the frame clock: their cells
+ * are flushed as soon as the write call is made.
+ *---------------------------------------------------------------------------*/
+
+/* Write priorities */
+typedef enum {
+    I2CLCD_PRIO_LOW    = 0,   /* Bulk refresh, animation */
+    I2CLCD_PRIO_NORMAL = 1,   /* Default */
+    I2CLCD_PRIO_HIGH   = 2,   /* Alerts */
+    I2CLCD_PRIO_COUNT,
+} i2clcd_prio_t;
+
+/* Per-priority statistics */
+typedef struct {
+    uint32_t depth;           /* Cells currently waiting in this lane */
+    uint64_t cells;           /* Cells sent from this lane */
+    uint64_t superseded;      /* Pending cells replaced or refused */
+    uint64_t flushes;         /* Row flushes latency was sampled on */
+    uint64_t latency_last_ns; /* Write-to-bus latency, last flush */
+    uint64_t latency_max_ns;  /* Worst write-to-bus latency */
+    uint64_t latency_mean_ns; /* Mean write-to-bus latency */
+} i2clcd_prio_stats_t;
+
+/**
+ * @brief Set the priority of subsequent compositor writes
+ * @param handle LCD handle
+ * @param prio Priority (default I2CLCD_PRIO_NORMAL)
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_set_priority(i2clcd_t *handle, i2clcd_prio_t prio);
+
+/**
+ * @brief Get queue depth and latency statistics for one priority
+ * @param handle LCD handle
+ * @param prio Priority lane
+ * @param stats Pointer to receive statistics
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_priority_stats(i2clcd_t *handle, i2clcd_prio_t prio,
+                                   i2clcd_prio_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * Bus Budget
+ *
+ * A budget limits how much of a shared I2C bus the display may occupy.
+ * Transfers are split into chunks of at most max_xfer_bytes, a token bucket
+ * refilled at max_duty_pct of real time pays for the modeled bus time of
+ * each chunk, and at least min_gap_us of idle bus is left between chunks so
+ * other drivers' transactions can get in. One budget may be shared by all
+ * handles on the same bus (from a single thread).
+ *---------------------------------------------------------------------------*/
+
+/* Budget configuration */
+typedef struct {
+    uint32_t bus_hz;          /* SCL rate used to model bus time */
+    uint16_t max_xfer_bytes;  /* Largest transaction (0 = no limit) */
+    uint8_t  max_duty_pct;    /* Long-run share of bus time (1-100) */
+    uint32_t burst_us;        /* Bus time that may be used back-to-back */
+    uint32_t min_gap_us;      /* Idle time left between chunks */
+} i2clcd_budget_config_t;
+
+/* Default budget: 100 kHz bus, 32-byte chunks, 50% duty, 200 us gaps */
+#define I2CLCD_BUDGET_CONFIG_DEFAULT { \
+    .bus_hz         = 100000,          \
+    .max_xfer_bytes = 32,              \
+    .max_duty_pct   = 50,              \
+    .burst_us       = 5000,            \
+    .min_gap_us     = 200,             \
+}
+
+/* Budget statistics */
+typedef struct {
+    uint64_t xfers;           /* Transactions issued */
+    uint64_t bytes;           /* Bytes written */
+    uint64_t bus_time_us;     /* Modeled bus occupancy */
+    uint64_t throttled_xfers; /* Transactions that had to wait */
+    uint64_t throttle_us;     /* Total time spent waiting for budget */
+    uint64_t lag_last_us;     /* Budget delay added to the last operation */
+    uint64_t lag_max_us;      /* Worst budget delay added to one operation */
+} i2clcd_budget_stats_t;
+
+/* Opaque budget handle */
+typedef struct i2clcd_budget i2clcd_budget_t;
+
+/**
+ * @brief Create a bus budget
+ * @param config Pointer to budget configuration
+ * @param budget Pointer to receive the budget on success
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_budget_create(const i2clcd_budget_config_t *config,
+                                  i2clcd_budget_t **budget);
+
+/**
+ * @brief Destroy a bus budget
+ * @param budget Budget (may be NULL); detach it from all handles first
+ */
+void i2clcd_budget_destroy(i2clcd_budget_t *budget);
+
+/**
+ * @brief Attach a budget to an LCD handle
+ * @param handle LCD handle
+ * @param budget Budget to charge, or NULL for unlimited bus use
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_set_budget(i2clcd_t *handle, i2clcd_budget_t *budget);
+
+/**
+ * @brief Get budget statistics
+ * @param budget Budget
+ * @param stats Pointer to receive statistics
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * lag_last_us and lag_max_us report how far display updates are running
+ * behind because of the budget.
+ */
+i2clcd_err_t i2clcd_budget_stats(i2clcd_budget_t *budget,
+                                 i2clcd_budget_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * I2C Multiplexer
+ *
+ * A TCA9548A splits one bus into eight channels, each with room for the 16
+ * PCF8574/PCF8574A addresses. Create one mux object per chip and set
+ * config.mux and config.mux_channel for each backpack behind it; the mux
+ * address, channel and PCF8574 address together name the display. Before a
+ * transaction the library writes the mux control register if another
+ * channel is selected, as a separate transaction (the chip switches on the
+ * STOP). The mux remembers its last selection, so a run of transactions on
+ * one channel costs a single select.
+ *
+ * i2clcd_mux_flush() flushes the compositors of several handles, grouped
+ * by channel and starting with the one already selected, so a frame needs
+ * at most one select per channel in use. Handles opened on the virtual
+ * buses of the kernel's i2c-mux driver (config.mux NULL) are grouped by
+ * bus device the same way, which keeps the driver's own selects to one
+ * per bus. A mux and its handles must be used from one thread.
+ *---------------------------------------------------------------------------*/
+
+/* Multiplexer statistics */
+typedef struct {
+    uint64_t selects;         /* Control register writes */
+    uint64_t skipped;         /* Transactions that found their channel open */
+    uint64_t failed;          /* Control register writes that failed */
+} i2clcd_mux_stats_t;
+
+/**
+ * @brief Create a TCA9548A multiplexer object
+ * @param addr Mux I2C address (0x70-0x77)
+ * @param mux Pointer to receive the mux on success
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_mux_create(uint8_t addr, i2clcd_mux_t **mux);
+
+/**
+ * @brief Destroy a multiplexer object
+ * @param mux Mux (may be NULL); close all handles behind it first
+ */
+void i2clcd_mux_destroy(i2clcd_mux_t *mux);
+
+/**
+ * @brief Get multiplexer statistics
+ * @param mux Mux
+ * @param stats Pointer to receive statistics
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_mux_stats(i2clcd_mux_t *mux, i2clcd_mux_stats_t *stats);
+
+/**
+ * @brief Flush the compositors of several handles in channel order
+ * @param handles Handles to flush (those without a running compositor are
+ *        skipped)
+ * @param count Number of handles
+ * @return I2CLCD_OK on success, else the first error; the remaining handles
+ *         are still flushed
+ */
+i2clcd_err_t i2clcd_mux_flush(i2clcd_t *const *handles, size_t count);
+
+/*---------------------------------------------------------------------------
+ * Canvas
+ *
+ * A canvas joins many panels into one character grid, e.g. a 4x3 wall of
+ * 20x4 panels as an 80x12 canvas. Attach each panel at the canvas cell of
+ * its top-left corner; panels may sit on different buses and leave gaps.
+ * Writes go to the compositor back buffers of the panels they cross, so
+ * each panel sends only the cells that differ from what it shows. Start
+ * every panel's compositor before attaching it.
+ *
+ * i2clcd_canvas_flush() runs one thread per bus; panels that share a bus
+ * device, mux or budget, directly or through a chain of other panels, are
+ * flushed one after another, grouped by mux channel. With sync, no bus starts until every bus is ready, so the wall
+ * changes within one window: the time of the slowest bus. A canvas and
+ * its panels must not be used from other threads during a flush.
+ *---------------------------------------------------------------------------*/
+
+/* Canvas statistics */
+typedef struct {
+    uint64_t flushes;         /* Calls to i2clcd_canvas_flush() */
+    uint32_t buses;           /* Buses flushed in parallel */
+    uint64_t window_last_ns;  /* Slowest bus in the last flush */
+    uint64_t window_max_ns;   /* Slowest bus in any flush */
+} i2clcd_canvas_stats_t;
+
+/* Opaque canvas handle */
+typedef struct i2clcd_canvas i2clcd_canvas_t;
+
+/**
+ * @brief Create a canvas
+ * @param cols Canvas width in characters
+ * @param rows Canvas height in characters
+ * @param canvas Pointer to receive the canvas on success
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_canvas_create(uint16_t cols, uint16_t rows,
+                                  i2clcd_canvas_t **canvas);
+
+/**
+ * @brief Destroy a canvas (the panels stay open)
+ * @param canvas Canvas (may be NULL)
+ */
+void i2clcd_canvas_destroy(i2clcd_canvas_t *canvas);
+
+/**
+ * @brief Place a panel on the canvas
+ * @param canvas Canvas
+ * @param handle Panel with its compositor running
+ * @param col Canvas column of the panel's first column
+ * @param row Canvas row of the panel's first row
+ * @return I2CLCD_OK on success, I2CLCD_ERR_NOT_INIT if the compositor is
+ *         not running, I2CLCD_ERR_RANGE if the panel does not fit,
+ *         I2CLCD_ERR_INVALID_ARG if it overlaps another panel
+ */
+i2clcd_err_t i2clcd_canvas_attach(i2clcd_canvas_t *canvas, i2clcd_t *handle,
+                                  uint16_t col, uint16_t row);
+
+/**
+ * @brief Write text at a canvas position
+ * @param canvas Canvas
+ * @param col Canvas column
+ * @param row Canvas row
+ * @param text Text; whatever runs past the right edge is dropped
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_canvas_write(i2clcd_canvas_t *canvas, uint16_t col,
+                                 uint16_t row, const char *text);
+
+/**
+ * @brief Blank the whole canvas
+ * @param canvas Canvas
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_canvas_clear(i2clcd_canvas_t *canvas);
+
+/**
+ * @brief Send pending canvas changes to every panel, one thread per bus
+ * @param canvas Canvas
+ * @param sync Hold every bus until all are ready, then start them together
+ * @return I2CLCD_OK on success, else the first error; the other panels are
+ *         still flushed
+ */
+i2clcd_err_t i2clcd_canvas_flush(i2clcd_canvas_t *canvas, bool sync);
+
+/**
+ * @brief Get canvas statistics
+ * @param canvas Canvas
+ * @param stats Pointer to receive statistics
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_canvas_stats(i2clcd_canvas_t *canvas,
+                                 i2clcd_canvas_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * Mirror Groups
+ *
+ * Identical panels that always show the same content can hang off one
+ * handle as mirror members: other PCF8574 addresses on the same bus (and
+ * mux channel). Each update is diffed against the handle's shadow and
+ * encoded once; after the handle's own transaction succeeds, the same
+ * bytes go to every member in a single combined I2C_RDWR transfer, so CPU
+ * time does not grow with the number of mirrors. With a bus budget the
+ * members' bytes are charged too, and the members are split into combined
+ * transfers of at most max_xfer_bytes each, with the budget's gap before
+ * each one.
+ *
+ * A member whose copy fails is marked diverged and gets nothing more until
+ * it is healed. A combined transfer stops at the first member that does
+ * not answer; the members before it stay in step when the adapter reports
+ * how many messages went out, but most adapters only report failure, and
+ * then every member of that transfer is marked. Healing re-initializes a
+ * member and replays the handle's shadow to it on its own.
+ * i2clcd_mirror_sync() heals now; with hot-plug detection on, i2clcd_poll()
+ * also heals at its probe interval. Mirrors need a PCF8574 expander and the
+ * handle's wiring on every member.
+ *---------------------------------------------------------------------------*/
+
+/* Most members per handle (the other PCF8574/PCF8574A addresses) */
+#define I2CLCD_MIRROR_MAX  15
+
+/* Mirror statistics */
+typedef struct {
+    uint8_t  members;         /* Member addresses */
+    uint8_t  diverged;        /* Members waiting to be healed */
+    uint64_t fanouts;         /* Combined transfers to the members */
+    uint64_t failures;        /* Combined transfers that failed */
+    uint64_t heals;           /* Members brought back in step */
+} i2clcd_mirror_stats_t;
+
+/**
+ * @brief Add a mirror member and bring it in step with the handle
+ * @param handle LCD handle
+ * @param addr Member PCF8574 address
+ * @return I2CLCD_OK on success, I2CLCD_ERR_UNSUPPORTED for other expanders,
+ *         I2CLCD_ERR_NODEV if the member did not answer (it stays in the
+ *         group, diverged)
+ */
+i2clcd_err_t i2clcd_mirror_add(i2clcd_t *handle, uint8_t addr);
+
+/**
+ * @brief Remove a mirror member
+ * @param handle LCD handle
+ * @param addr Member PCF8574 address
+ * @return I2CLCD_OK on success, I2CLCD_ERR_INVALID_ARG if not a member
+ */
+i2clcd_err_t i2clcd_mirror_remove(i2clcd_t *handle, uint8_t addr);
+
+/**
+ * @brief Heal diverged mirror members now
+ * @param handle LCD handle
+ * @return I2CLCD_OK if every member is in step, I2CLCD_ERR_NODEV otherwise
+ */
+i2clcd_err_t i2clcd_mirror_sync(i2clcd_t *handle);
+
+/**
+ * @brief Get mirror statistics
+ * @param handle LCD handle
+ * @param stats Pointer to receive statistics
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_mirror_stats(i2clcd_t *handle,
+                                 i2clcd_mirror_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * Error Recovery
+ *
+ * A failed transaction is retried with exponential backoff. A failure that
+ * may have delivered part of a transaction (anything but an address NACK)
+ * can leave the HD44780 between nibbles, so once the operation finishes the
+ * library resynchronizes the 4-bit interface and replays the registers,
+ * CGRAM and DDRAM it knows from shadow state. Recovery is on by default.
+ *---------------------------------------------------------------------------*/
+
+/* Recovery configuration */
+typedef struct {
+    uint8_t  retries;            /* Extra attempts per transaction */
+    uint32_t backoff_us;         /* Wait before the first retry */
+    uint32_t backoff_max_us;     /* Cap for the doubling backoff */
+    uint16_t adapter_timeout_ms; /* I2C_TIMEOUT for i2c-dev (0 = keep) */
+    uint8_t  adapter_retries;    /* I2C_RETRIES for i2c-dev (0 = keep) */
+    bool     resync;             /* Resync and replay after a glitch */
+} i2clcd_recovery_config_t;
+
+/* Default recovery: 3 retries from 500 us, resync and replay enabled */
+#define I2CLCD_RECOVERY_CONFIG_DEFAULT { \
+    .retries            = 3,             \
+    .backoff_us         = 500,           \
+    .backoff_max_us     = 8000,          \
+    .adapter_timeout_ms = 0,             \
+    .adapter_retries    = 0,             \
+    .resync             = true,          \
+}
+
+/**
+ * @brief Configure retries and resynchronization
+ * @param handle LCD handle
+ * @param config Recovery configuration (copied)
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * Adapter settings apply to the i2c-dev backend and are ignored by others.
+ */
+i2clcd_err_t i2clcd_set_recovery(i2clcd_t *handle,
+                                 const i2clcd_recovery_config_t *config);
+
+/**
+ * @brief Resynchronize the controller and replay shadow state now
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_recover(i2clcd_t *handle);
+
+/*---------------------------------------------------------------------------
+ * Hot-Plug Detection
+ *
+ * A run of NACKed transactions marks the panel as disconnected. While it is
+ * gone, writes only update shadow state and report success. i2clcd_poll()
+ * probes the PCF8574 with a one-byte read; when the device answers again, or
+ * when its output latch reads back at power-on levels after a brown-out, the
+ * library runs the init sequence and restores backlight, registers, CGRAM
+ * and DDRAM from shadow state. The callback reports each transition.
+ *---------------------------------------------------------------------------*/
+
+/* Link events */
+typedef enum {
+    I2CLCD_LINK_LOST = 0,     /* Device stopped answering */
+    I2CLCD_LINK_RESTORED,     /* Device answered again and was restored */
+    I2CLCD_LINK_BROWNOUT      /* Device lost power and was restored */
+} i2clcd_link_event_t;
+
+/* Link status callback */
+typedef void (*i2clcd_link_cb_t)(i2clcd_t *handle, i2clcd_link_event_t event,
+                                 void *user);
+
+/* Hot-plug configuration */
+typedef struct {
+    uint8_t  nack_streak;        /* NACKed attempts in a row that mean gone */
+    uint32_t probe_interval_ms;  /* Minimum time between probes */
+    i2clcd_link_cb_t callback;   /* Status callback (may be NULL) */
+    void    *user;               /* Passed to the callback */
+} i2clcd_hotplug_config_t;
+
+/* Default hot-plug: 3 NACKs, probe at most once a second */
+#define I2CLCD_HOTPLUG_CONFIG_DEFAULT { \
+    .nack_streak       = 3,             \
+    .probe_interval_ms = 1000,          \
+    .callback          = NULL,          \
+    .user              = NULL,          \
+}
+
+/**
+ * @brief Enable or disable hot-plug detection
+ * @param handle LCD handle
+ * @param config Hot-plug configuration (copied), or NULL to disable
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_set_hotplug(i2clcd_t *handle,
+                                const i2clcd_hotplug_config_t *config);
+
+/**
+ * @brief Probe the device if due and restore it after a reconnect
+ * @param handle LCD handle with hot-plug detection enabled
+ * @param up Receives true if the device is connected (may be NULL)
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * Call this periodically, e.g. once per frame; probes are rate-limited by
+ * probe_interval_ms. A disconnected panel is not an error.
+ */
+i2clcd_err_t i2clcd_poll(i2clcd_t *handle, bool *up);
+
+/*---------------------------------------------------------------------------
+ * RGB Plate
+ *
+ * Handles opened with I2CLCD_EXPANDER_RGB_PLATE drive a three-colour
+ * backlight and read five buttons. The colour is cached in the expander's
+ * output latches: blue shares the LCD port and goes out with the next LCD
+ * byte, and red and green go out with the next button poll, so changing
+ * colour costs no transaction of its own while buttons are polled.
+ * i2clcd_backlight() still switches the whole backlight on and off.
+ *
+ * A button poll writes one register address and reads one byte; both
+ * transactions count in the handle's stats and wait for its bus budget, so
+ * a poll never takes the gap the budget keeps for other devices. Polls run
+ * between the transactions of display updates, in i2clcd_compositor_wait()
+ * and i2clcd_compositor_poll(), and from i2clcd_buttons_poll(). While
+ * buttons are polled, display transactions are split so that none keeps a
+ * due poll waiting longer than the configured latency.
+ *---------------------------------------------------------------------------*/
+
+/* Backlight channels for i2clcd_set_color() */
+#define I2CLCD_COLOR_RED    0x01
+#define I2CLCD_COLOR_GREEN  0x02
+#define I2CLCD_COLOR_BLUE   0x04
+#define I2CLCD_COLOR_WHITE  0x07
+
+/* Plate buttons, as bits of a button mask */
+typedef enum {
+    I2CLCD_BUTTON_SELECT = 0x01,
+    I2CLCD_BUTTON_RIGHT  = 0x02,
+    I2CLCD_BUTTON_DOWN   = 0x04,
+    I2CLCD_BUTTON_UP     = 0x08,
+    I2CLCD_BUTTON_LEFT   = 0x10,
+} i2clcd_button_t;
+
+/* Button polling policy */
+typedef struct {
+    uint32_t poll_ms;         /* Interval between input reads */
+    uint32_t debounce_ms;     /* A level must hold this long to count */
+    uint32_t latency_ms;      /* Longest a display transfer may hold up a
+                                 due poll */
+    uint32_t bus_hz;          /* SCL rate used to size display transfers */
+} i2clcd_buttons_config_t;
+
+#define I2CLCD_BUTTONS_CONFIG_DEFAULT { \
+    .poll_ms     = 10,     \
+    .debounce_ms = 20,     \
+    .latency_ms  = 5,      \
+    .bus_hz      = 100000, \
+}
+
+/* A debounced press or release */
+typedef struct {
+    i2clcd_button_t button;   /* Button that changed */
+    bool     pressed;         /* true for a press, false for a release */
+    uint64_t time_ns;         /* When the new level was first seen */
+} i2clcd_button_event_t;
+
+/* Button polling counters */
+typedef struct {
+    uint64_t polls;           /* Input reads */
+    uint64_t errors;          /* Input reads that failed */
+    uint64_t events;          /* Events queued */
+    uint64_t dropped;         /* Events lost to a full queue */
+    uint64_t late;            /* Polls started after the latency bound */
+    uint64_t lag_max_ns;      /* Longest delay of a poll past its due time */
+} i2clcd_buttons_stats_t;
+
+/**
+ * @brief Set the backlight colour
+ * @param handle LCD handle opened with I2CLCD_EXPANDER_RGB_PLATE
+ * @param color Lit channels (I2CLCD_COLOR_* bits)
+ * @return I2CLCD_OK on success, I2CLCD_ERR_UNSUPPORTED on other backpacks
+ */
+i2clcd_err_t i2clcd_set_color(i2clcd_t *handle, uint8_t color);
+
+/**
+ * @brief Enable or change button polling
+ * @param handle LCD handle opened with I2CLCD_EXPANDER_RGB_PLATE
+ * @param config Polling policy, or NULL to stop polling
+ * @return I2CLCD_OK on success, I2CLCD_ERR_UNSUPPORTED on other backpacks,
+ *         I2CLCD_ERR_INVALID_ARG for a zero interval, latency or bus rate
+ *
+ * Enabling clears the event queue. Buttons held at that moment do not
+ * produce press events.
+ */
+i2clcd_err_t i2clcd_set_buttons(i2clcd_t *handle,
+                                const i2clcd_buttons_config_t *config);
+
+/**
+ * @brief Read the buttons if a poll is due
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success (including when no poll was due),
+ *         I2CLCD_ERR_NOT_INIT if polling is off
+ *
+ * For applications that do not run the compositor. A failed read is
+ * counted in the stats and retried at the next poll.
+ */
+i2clcd_err_t i2clcd_buttons_poll(i2clcd_t *handle);
+
+/**
+ * @brief Take the oldest button event from the queue
+ * @param handle LCD handle
+ * @param event Receives the event
+ * @param got Set to true if an event was returned, false if none queued
+ * @return I2CLCD_OK on success, I2CLCD_ERR_NOT_INIT if polling is off
+ */
+i2clcd_err_t i2clcd_button_event(i2clcd_t *handle,
+                                 i2clcd_button_event_t *event, bool *got);
+
+/**
+ * @brief Get the buttons held down, after debouncing
+ * @param handle LCD handle
+ * @param held Receives a mask of i2clcd_button_t bits
+ * @return I2CLCD_OK on success, I2CLCD_ERR_NOT_INIT if polling is off
+ */
+i2clcd_err_t i2clcd_buttons_get(i2clcd_t *handle, uint8_t *held);
+
+/**
+ * @brief Get button polling counters
+ * @param handle LCD handle
+ * @param stats Pointer to receive the counters
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_buttons_stats(i2clcd_t *handle,
+                                  i2clcd_buttons_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * Readback
+ *
+ * Backpacks that wire the HD44780 RW line to P1 (the common layout) can read
+ * controller memory. i2clcd_sync_shadow() seeds shadow state from the panel
+ * so a new process's first update is a minimal diff instead of a redraw;
+ * call it after i2clcd_open() and before i2clcd_compositor_start(). Reading
+ * costs about 1.5 times the bus time of writing the same cells.
+ *---------------------------------------------------------------------------*/
+
+/**
+ * @brief Read controller memory
+ * @param handle LCD handle
+ * @param cgram true to read CGRAM, false for DDRAM
+ * @param addr First address
+ * @param buf Buffer to receive len bytes (in address counter order)
+ * @param len Number of bytes to read
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_read_mem(i2clcd_t *handle, bool cgram, uint8_t addr,
+                             uint8_t *buf, size_t len);
+
+/**
+ * @brief Read the address counter
+ * @param handle LCD handle
+ * @param addr Receives the 7-bit address counter
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_read_addr(i2clcd_t *handle, uint8_t *addr);
+
+/**
+ * @brief Replace shadow state with CGRAM, DDRAM and cursor read from the panel
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_sync_shadow(i2clcd_t *handle);
+
+/*---------------------------------------------------------------------------
+ * Scrubbing
+ *
+ * Interference can flip characters on the glass without any bus error. The
+ * scrubber checks known CGRAM rows and DDRAM cells against shadow state a few
+ * at a time, so every cell is checked within
+ * (known cells / cells per step) * interval. With verify set and a backpack
+ * where i2clcd_read_mem() works (PCF8574, one controller), a step reads its
+ * cells back and rewrites only those that differ, so a clean panel gets no
+ * writes and the stats count real corruption. Reading takes four bus
+ * transactions per cell against a share of one for a blind rewrite; clear
+ * verify to trade the detection for bus time. Other backpacks always
+ * rewrite every cell of the step blind.
+ * Steps run from i2clcd_scrub_step() and from idle compositor frames, and
+ * are skipped rather than delayed when the bus budget has no room.
+ *---------------------------------------------------------------------------*/
+
+/* Scrubber configuration */
+typedef struct {
+    uint8_t  cells;          /* Cells (DDRAM bytes or CGRAM rows) per step */
+    uint32_t interval_ms;    /* Minimum time between steps */
+    bool     verify;         /* Read cells back and rewrite only mismatches */
+} i2clcd_scrub_config_t;
+
+/* Default scrub: 8 cells every 100 ms (under 2 s per sweep on a 20x4) */
+#define I2CLCD_SCRUB_CONFIG_DEFAULT { \
+    .cells       = 8,                 \
+    .interval_ms = 100,               \
+    .verify      = true,              \
+}
+
+/* Scrubber statistics */
+typedef struct {
+    uint64_t steps;          /* Steps that wrote to the bus */
+    uint64_t skipped;        /* Steps skipped for lack of budget */
+    uint64_t cells;          /* Cells rewritten */
+    uint64_t sweeps;         /* Complete passes over controller memory */
+    uint64_t verified;       /* Cells read back and compared */
+    uint64_t mismatches;     /* Read-back cells that differed from shadow */
+} i2clcd_scrub_stats_t;
+
+/**
+ * @brief Enable or disable background scrubbing
+ * @param handle LCD handle
+ * @param config Scrub configuration (copied), or NULL to disable
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_set_scrub(i2clcd_t *handle,
+                              const i2clcd_scrub_config_t *config);
+
+/**
+ * @brief Rewrite the next few cells if a step is due
+ * @param handle LCD handle with scrubbing enabled
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_scrub_step(i2clcd_t *handle);
+
+/**
+ * @brief Get scrubber statistics
+ * @param handle LCD handle
+ * @param stats Pointer to receive statistics
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_scrub_stats(i2clcd_t *handle, i2clcd_scrub_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * Instrumentation
+ *---------------------------------------------------------------------------*/
+
+/* Public entry points with latency histograms */
+typedef enum {
+    I2CLCD_API_INIT = 0,
+    I2CLCD_API_OPEN,
+    I2CLCD_API_CLEAR,
+    I2CLCD_API_CLEAR_LINE,
+    I2CLCD_API_HOME,
+    I2CLCD_API_DISPLAY,
+    I2CLCD_API_SET_CURSOR,
+    I2CLCD_API_CURSOR,
+    I2CLCD_API_BLINK,
+    I2CLCD_API_PUTC,
+    I2CLCD_API_PUTS,
+    I2CLCD_API_PRINTF,
+    I2CLCD_API_SET_LINE,
+    I2CLCD_API_BACKLIGHT,
+    I2CLCD_API_CREATE_CHAR,
+    I2CLCD_API_COMPOSITOR_FLUSH,
+    I2CLCD_API_CREATE_CHARS,
+    I2CLCD_API_COMPOSITOR_START,
+    I2CLCD_API_COMPOSITOR_WAIT,
+    I2CLCD_API_COMPOSITOR_POLL,
+    I2CLCD_API_SET_PRIORITY,
+    I2CLCD_API_SET_COLOR,
+    I2CLCD_API_CANVAS_FLUSH,   /* On the first panel's handle */
+    I2CLCD_API_MUX_FLUSH,      /* On the first handle passed */
+    I2CLCD_API_TRACE_REPLAY,
+    I2CLCD_API_SYNC_SHADOW,
+    I2CLCD_API_READ_MEM,
+    I2CLCD_API_RECOVER,
+    I2CLCD_API_SCRUB_STEP,
+    I2CLCD_API_GLYPH,
+    I2CLCD_API_ANIM_STEP,
+    I2CLCD_API_COUNT,
+} i2clcd_api_t;
+
+/* HD44780 instruction classes (bit position of the opcode) plus data */
+typedef enum {
+    I2CLCD_CMD_CLEAR = 0,
+    I2CLCD_CMD_HOME,
+    I2CLCD_CMD_ENTRY_MODE,
+    I2CLCD_CMD_DISPLAY_CTRL,
+    I2CLCD_CMD_SHIFT,
+    I2CLCD_CMD_FUNCTION_SET,
+    I2CLCD_CMD_SET_CGRAM,
+    I2CLCD_CMD_SET_DDRAM,
+    I2CLCD_CMD_DATA,
+    I2CLCD_CMD_TYPE_COUNT,
+} i2clcd_cmd_type_t;
+
+/* Histogram bucket i counts calls taking [2^i, 2^(i+1)) ns */
+#define I2CLCD_HIST_BUCKETS 32
+
+/* Latency histogram for one entry point */
+typedef struct {
+    uint64_t count;           /* Calls */
+    uint64_t errors;          /* Calls that returned an error */
+    uint64_t total_ns;        /* Sum of call durations */
+    uint64_t max_ns;          /* Longest call */
+    uint64_t buckets[I2CLCD_HIST_BUCKETS];
+} i2clcd_hist_t;
+
+/* Per-handle counters */
+typedef struct {
+    uint64_t xfers;           /* I2C transactions */
+    uint64_t bytes;           /* Bytes written to the bus */
+    uint64_t syscalls;        /* write(), ioctl() and sleep system calls */
+    uint64_t bus_ns;          /* Time spent inside bus transfers */
+    uint64_t sleeps;          /* Controller delays and budget waits */
+    uint64_t sleep_ns;        /* Time spent in those sleeps */
+    uint64_t errors;          /* Failed transfers */
+    uint64_t retries;         /* Retried transfers */
+    uint64_t recoveries;      /* Resync and replay runs */
+    uint64_t recovery_ns;     /* Time spent recovering */
+    uint64_t recovery_max_ns; /* Longest single recovery */
+    uint64_t disconnects;     /* Times the device stopped answering */
+    uint64_t reconnects;      /* Restores after a reconnect or brown-out */
+    uint64_t commands[I2CLCD_CMD_TYPE_COUNT]; /* Bytes sent by type */
+    i2clcd_hist_t api[I2CLCD_API_COUNT];      /* Per entry point latency */
+} i2clcd_stats_t;
+
+/**
+ * @brief Get instrumentation counters for a handle
+ * @param handle LCD handle
+ * @param stats Pointer to receive a snapshot of the counters
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_stats_get(i2clcd_t *handle, i2clcd_stats_t *stats);
+
+/**
+ * @brief Reset instrumentation counters for a handle
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_stats_reset(i2clcd_t *handle);
+
+/**
+ * @brief Get the name of an instrumented entry point
+ * @param api Entry point
+ * @return Static string, e.g. "set_line"
+ */
+const char *i2clcd_stats_api_name(i2clcd_api_t api);
+
+/**
+ * @brief Get the name of an instruction class
+ * @param type Instruction class
+ * @return Static string, e.g. "set_ddram"
+ */
+const char *i2clcd_stats_cmd_name(i2clcd_cmd_type_t type);
+
+/*---------------------------------------------------------------------------
+ * Emulator
+ *
+ * Handles opened with I2CLCD_BACKEND_EMULATOR drive an in-memory model of
+ * the PCF8574 and HD44780 from the exact bytes that would go on the bus,
+ * including enable strobes and the 4-bit nibble phase.
+ *---------------------------------------------------------------------------*/
+
+/* Emulated controller state */
+typedef struct {
+    uint8_t  ddram[128];      /* Display data RAM */
+    uint8_t  cgram[64];       /* Character generator RAM */
+    uint8_t  ac;              /* Address counter */
+    bool     ac_cgram;        /* Address counter points into CGRAM */
+    uint8_t  display_ctrl;    /* Display/cursor/blink flags */
+    uint8_t  entry_mode;      /* Increment/shift flags */
+    uint8_t  function_set;    /* Interface width, lines, font */
+    bool     four_bit;        /* Controller is in 4-bit mode */
+    bool     nibble_pending;  /* Waiting for the low nibble */
+    bool     backlight;       /* Backlight pin state */
+    uint8_t  color;           /* Lit backlight channels (I2CLCD_COLOR_*) */
+    uint64_t strobes;         /* Enable falling edges */
+    uint64_t instructions;    /* Instructions executed */
+    uint64_t data_writes;     /* Data bytes written */
+    uint64_t data_reads;      /* Data bytes read */
+} i2clcd_emu_state_t;
+
+/**
+ * @brief Get the emulated controller state
+ * @param handle LCD handle opened with I2CLCD_BACKEND_EMULATOR
+ * @param state Pointer to receive the state
+ * @return I2CLCD_OK on success, I2CLCD_ERR_UNSUPPORTED if not emulated
+ */
+i2clcd_err_t i2clcd_emu_state(i2clcd_t *handle, i2clcd_emu_state_t *state);
+
+/**
+ * @brief Get the state of one controller of an emulated 40x4 panel
+ * @param handle LCD handle opened with I2CLCD_BACKEND_EMULATOR
+ * @param ctrl Controller: 0 drives lines 0-1 (E1), 1 drives lines 2-3 (E2)
+ * @param state Pointer to receive the state
+ * @return I2CLCD_OK on success, I2CLCD_ERR_RANGE if the panel has no such
+ *         controller, I2CLCD_ERR_UNSUPPORTED if not emulated
+ *
+ * i2clcd_emu_state() and i2clcd_emu_glitch() act on controller 0.
+ */
+i2clcd_err_t i2clcd_emu_controller(i2clcd_t *handle, uint8_t ctrl,
+                                   i2clcd_emu_state_t *state);
+
+/**
+ * @brief Get the text of one line as it would appear on the glass
+ * @param handle LCD handle opened with I2CLCD_BACKEND_EMULATOR
+ * @param line Line number (0-indexed)
+ * @param buf Buffer to receive a NUL-terminated copy of the line
+ * @param size Size of buf (cols + 1 bytes holds the whole line)
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * Returns blank text while the display is switched off.
+ */
+i2clcd_err_t i2clcd_emu_line(i2clcd_t *handle, uint8_t line,
+                             char *buf, size_t size);
+
+/**
+ * @brief Switch the emulated panel's power
+ * @param handle LCD handle opened with I2CLCD_BACKEND_EMULATOR
+ * @param on false to unplug it (transfers NACK), true for a power-on reset
+ * @return I2CLCD_OK on success, I2CLCD_ERR_UNSUPPORTED if not emulated
+ */
+i2clcd_err_t i2clcd_emu_power(i2clcd_t *handle, bool on);
+
+/**
+ * @brief Overwrite one byte of controller memory, as interference would
+ * @param handle LCD handle opened with I2CLCD_BACKEND_EMULATOR
+ * @param cgram true for a CGRAM row, false for a DDRAM cell
+ * @param addr Address within that memory
+ * @param value New contents
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_emu_glitch(i2clcd_t *handle, bool cgram, uint8_t addr,
+                               uint8_t value);
+
+/**
+ * @brief Hold down buttons on an emulated RGB plate
+ * @param handle LCD handle opened with I2CLCD_BACKEND_EMULATOR
+ * @param pressed Mask of i2clcd_button_t bits held from now on
+ * @return I2CLCD_OK on success, I2CLCD_ERR_UNSUPPORTED if not emulated
+ */
+i2clcd_err_t i2clcd_emu_buttons(i2clcd_t *handle, uint8_t pressed);
+
+/**
+ * @brief Point the other i2clcd_emu_*() calls at another emulated backpack
+ * @param handle LCD handle opened with I2CLCD_BACKEND_EMULATOR
+ * @param addr Backpack address on the handle's bus; the handle's own
+ *        address returns to the handle's backpack
+ * @return I2CLCD_OK on success, I2CLCD_ERR_UNSUPPORTED if not emulated,
+ *         I2CLCD_ERR_RANGE if no backpack can sit at the address
+ *
+ * Every PCF8574/PCF8574A address on an emulated bus holds a backpack and
+ * panel like the handle's, created when first written or viewed.
+ */
+i2clcd_err_t i2clcd_emu_view(i2clcd_t *handle, uint8_t addr);
+
+/*---------------------------------------------------------------------------
+ * Bus Tracing
+ *
+ * A trace records every transaction on the bus with its PCF8574 bytes and
+ * a monotonic timestamp. Records are a type byte, the microseconds since
+ * the previous record and a length (both LEB128 varints), then the bytes.
+ *---------------------------------------------------------------------------*/
+
+/* Replay flags */
+#define I2CLCD_REPLAY_FAST      0x01   /* Ignore recorded timing */
+#define I2CLCD_REPLAY_ANY_ADDR  0x02   /* Allow a trace from another address
+                                          (the wiring must still match) */
+
+/**
+ * @brief Start recording bus traffic to a file
+ * @param handle LCD handle
+ * @param path Trace file to create (truncated if it exists)
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_trace_start(i2clcd_t *handle, const char *path);
+
+/**
+ * @brief Stop recording and close the trace file
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_trace_stop(i2clcd_t *handle);
+
+/**
+ * @brief Send a recorded trace to a handle's bus
+ * @param handle LCD handle (real hardware or emulator)
+ * @param path Trace file
+ * @param flags I2CLCD_REPLAY_FAST to replay at maximum speed,
+ *        I2CLCD_REPLAY_ANY_ADDR to replay onto a handle at another address
+ * @return I2CLCD_OK on success, I2CLCD_ERR_INVALID_ARG if the trace was
+ *         recorded at another address or with another expander or pin
+ *         map, I2CLCD_ERR_INEXACT if the whole
+ *         trace was sent but held failed writes that may have partly
+ *         arrived, negative error code on failure
+ *
+ * Without I2CLCD_REPLAY_FAST, transactions are sent on absolute deadlines
+ * that reproduce the recorded spacing. The handle's shadow state is
+ * discarded since the trace may leave the display in any state. A write
+ * that failed with an address NACK reached nobody and is skipped; any other
+ * failed write may have delivered some of its bytes, which the trace cannot
+ * tell, so it is skipped too and reported through I2CLCD_ERR_INEXACT.
+ */
+i2clcd_err_t i2clcd_trace_replay(i2clcd_t *handle, const char *path,
+                                 unsigned int flags);
+
+/*---------------------------------------------------------------------------
+ * Fault Injection
+ *
+ * A test layer between the library and its backend (normally the emulator)
+ * that makes transactions fail or misbehave at configurable rates. Rates
+ * are in parts per million: per transaction, except dropped nibbles, which
+ * are per enable pulse. Each recovery run draws from its own stream, so a
+ * change in replay length does not move the faults that come after it.
+ *---------------------------------------------------------------------------*/
+
+/* Fault injection configuration */
+typedef struct {
+    uint32_t seed;            /* PRNG seed; equal seeds give equal runs */
+    uint32_t nack_ppm;        /* Address NACK, nothing sent (ENXIO) */
+    uint32_t short_ppm;       /* Only a prefix is sent (EIO) */
+    uint32_t eremoteio_ppm;   /* Adapter reports EREMOTEIO, nothing sent */
+    uint32_t etimedout_ppm;   /* Adapter reports ETIMEDOUT, nothing sent */
+    uint32_t spike_ppm;       /* Transaction stalls for spike_us */
+    uint32_t spike_us;        /* Length of a latency spike */
+    uint32_t drop_nibble_ppm; /* Enable pulse lost; write still succeeds */
+} i2clcd_fault_config_t;
+
+/* Faults injected so far */
+typedef struct {
+    uint64_t xfers;           /* Transactions seen */
+    uint64_t nacks;
+    uint64_t short_writes;
+    uint64_t eremoteio;
+    uint64_t etimedout;
+    uint64_t spikes;
+    uint64_t dropped_nibbles;
+} i2clcd_fault_stats_t;
+
+/**
+ * @brief Start injecting faults into a handle's bus traffic
+ * @param handle LCD handle
+ * @param config Fault rates (copied)
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * Calling it again while active replaces the configuration and keeps the
+ * statistics.
+ */
+i2clcd_err_t i2clcd_fault_start(i2clcd_t *handle,
+                                const i2clcd_fault_config_t *config);
+
+/**
+ * @brief Stop injecting faults
+ * @param handle LCD handle
+ * @return I2CLCD_OK on success, negative error code on failure
+ */
+i2clcd_err_t i2clcd_fault_stop(i2clcd_t *handle);
+
+/**
+ * @brief Get fault injection statistics
+ * @param handle LCD handle
+ * @param stats Pointer to receive the statistics
+ * @return I2CLCD_OK on success, I2CLCD_ERR_UNSUPPORTED if not injecting
+ */
+i2clcd_err_t i2clcd_fault_stats(i2clcd_t *handle,
+                                i2clcd_fault_stats_t *stats);
+
+/*---------------------------------------------------------------------------
+ * Clock
+ *
+ * Controller delays, frame deadlines, the bus budget, latency histograms and
+ * trace timestamps all use the handle's clock. The default reads
+ * CLOCK_MONOTONIC and really sleeps. A virtual clock instead jumps forward
+ * to each requested deadline, so emulator runs finish at CPU speed while the
+ * requested delays are still accounted for.
+ *---------------------------------------------------------------------------*/
+
+/* Virtual clock state */
+typedef struct {
+    uint64_t now_ns;          /* Current virtual time (may be set directly) */
+    uint64_t sleeps;          /* Sleeps requested */
+    uint64_t slept_ns;        /* Total time skipped by sleeps */
+} i2clcd_vclock_t;
+
+/**
+ * @brief Replace a handle's clock
+ * @param handle LCD handle
+ * @param clock Clock to copy, or NULL for CLOCK_MONOTONIC
+ * @return I2CLCD_OK on success, negative error code on failure
+ *
+ * Pending frame deadlines are rebased onto the new clock. Handles sharing a
+ * bus budget should use the same clock.
+ */
+i2clcd_err_t i2clcd_set_clock(i2clcd_t *handle, const i2clcd_clock_t *clock);
+
+/**
+ * @brief Build a clock that drives a virtual clock
+ * @param vc Virtual clock state (must outlive every handle using it)
+ * @param clock Receives the clock callbacks
+ *
+ * Time stands still except when the library sleeps, which advances vc to
+ * the deadline instantly. Share one vc between handles to keep them in step.
+ */
+void i2clcd_vclock_init(i2clcd_vclock_t *vc, i2clcd_clock_t *clock);
+
 /*---------------------------------------------------------------------------
  * Utility Functions
  *---------------------------------------------------------------------------*/
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * anim.c - Glyph animation by rewriting CGRAM slots on a shared timeline
+ *
+ * Every animated slot's deadlines are multiples of its frame period from
+ * one epoch per handle, set when the first animation starts. A slot that
+ * joins later therefore changes frames together with the others that share
+ * (or divide) its period. Frames whose deadline passed while nobody ran
+ * the engine are skipped, as the compositor skips missed frames. The
+ * frame-to-frame diff is the CGRAM shadow diff: only rows that changed are
+ * sent.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * Timeline
+ *---------------------------------------------------------------------------*/
+
+/* First deadline on the timeline strictly after now */
+static uint64_t first_deadline(const struct i2clcd_anim *an, uint64_t period,
+                               uint64_t now)
+{
+    return an->epoch_ns + ((now - an->epoch_ns) / period + 1) * period;
+}
+
+/* Advance a due slot to the frame its deadline calls for */
+static void advance(struct i2clcd_anim *an, uint8_t slot, uint64_t now)
+{
+    struct i2clcd_anim_slot *as = &an->slots[slot];
+    uint64_t lag = now - as->next_ns;
+    uint64_t missed = lag / as->period_ns;
+    uint64_t step = missed + 1;
+
+    if (lag > an->stats.lag_max_ns) {
+        an->stats.lag_max_ns = lag;
+    }
+    as->next_ns += step * as->period_ns;
+
+    if (as->loop) {
+        as->frame = (uint8_t)((as->frame + step) % as->count);
+    } else {
+        /* Frames past the end of a one-shot sequence do not exist */
+        if (step > (uint64_t)(as->count - 1 - as->frame)) {
+            missed = (uint64_t)(as->count - 2 - as->frame);
+            step = missed + 1;
+        }
+        as->frame = (uint8_t)(as->frame + step);
+        if (as->frame == as->count - 1) {
+            an->active &= (uint8_t)~(1u << slot);
+        }
+    }
+
+    an->stats.frames++;
+    an->stats.skipped += missed;
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+uint64_t i2clcd_anim_next_ns(const i2clcd_t *ctx)
+{
+    const struct i2clcd_anim *an = &ctx->anim;
+    uint64_t next = UINT64_MAX;
+    uint8_t i;
+
+    for (i = 0; i < I2CLCD_GLYPH_SLOTS; i++) {
+        if (((an->active >> i) & 1) && an->slots[i].next_ns < next) {
+            next = an->slots[i].next_ns;
+        }
+    }
+    return next;
+}
+
+int i2clcd_anim_run(i2clcd_t *ctx)
+{
+    struct i2clcd_anim *an = &ctx->anim;
+    const struct i2clcd_anim_slot *as;
+    uint8_t due = 0;
+    uint64_t now;
+    uint8_t i;
+    int sent, ret = 0;
+
+    if (!an->active || ctx->link_down) {
+        return 0;
+    }
+
+    now = i2clcd_monotonic_ns(ctx);
+    for (i = 0; i < I2CLCD_GLYPH_SLOTS; i++) {
+        if (((an->active >> i) & 1) && an->slots[i].next_ns <= now) {
+            advance(an, i, now);
+            due |= (uint8_t)(1u << i);
+        }
+    }
+    if (!due) {
+        return 0;
+    }
+
+    /* One batch for every slot due at this deadline */
+    i2clcd_batch_begin(ctx);
+    for (i = 0; i < I2CLCD_GLYPH_SLOTS && ret == 0; i++) {
+        if (!((due >> i) & 1)) {
+            continue;
+        }
+        as = &an->slots[i];
+        sent = i2clcd_cgram_write(ctx, (uint8_t)(i << 3),
+                                  as->frames[as->frame], 8);
+        if (sent < 0) {
+            ret = -1;
+        } else {
+            an->stats.rows += (uint64_t)sent;
+        }
+    }
+    if (i2clcd_batch_end(ctx) < 0) {
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_anim_start(i2clcd_t *handle, uint8_t slot,
+                               const uint8_t frames[][8], uint8_t count,
+                               uint32_t frame_ms, bool loop)
+{
+    struct i2clcd_anim *an;
+    struct i2clcd_anim_slot *as;
+    uint64_t now;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!frames) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (slot >= I2CLCD_GLYPH_SLOTS || count == 0 ||
+        count > I2CLCD_ANIM_FRAMES_MAX || frame_ms == 0) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    an = &handle->anim;
+    as = &an->slots[slot];
+    now = i2clcd_monotonic_ns(handle);
+
+    if (!an->active) {
+        an->epoch_ns = now;
+    }
+
+    memcpy(as->frames, frames, (size_t)count * 8);
+    as->count = count;
+    as->frame = 0;
+    as->loop = loop;
+    as->period_ns = (uint64_t)frame_ms * 1000000;
+    as->next_ns = first_deadline(an, as->period_ns, now);
+
+    /* A single frame has nothing to turn */
+    an->active &= (uint8_t)~(1u << slot);
+    if (count > 1) {
+        an->active |= (uint8_t)(1u << slot);
+    }
+
+    return i2clcd_create_char(handle, slot, frames[0]);
+}
+
+i2clcd_err_t i2clcd_anim_stop(i2clcd_t *handle, uint8_t slot)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (slot >= I2CLCD_GLYPH_SLOTS) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    handle->anim.active &= (uint8_t)~(1u << slot);
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_anim_step(i2clcd_t *handle)
+{
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    return i2clcd_stats_api(handle, I2CLCD_API_ANIM_STEP, t0,
+                            i2clcd_anim_run(handle) < 0 ? I2CLCD_ERR_WRITE :
+                            I2CLCD_OK);
+}
+
+i2clcd_err_t i2clcd_anim_stats(i2clcd_t *handle, i2clcd_anim_stats_t *stats)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    *stats = handle->anim.stats;
+    return I2CLCD_OK;
+}
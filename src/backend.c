@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * backend.c - Backend stack and the Linux i2c-dev backend
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * Linux i2c-dev Backend
+ *---------------------------------------------------------------------------*/
+
+struct i2cdev_backend {
+    struct i2clcd_backend base;
+    int fd;                /* I2C file descriptor */
+};
+
+static int i2cdev_write(struct i2clcd_backend *be, const uint8_t *buf,
+                        size_t len)
+{
+    struct i2cdev_backend *dev = (struct i2cdev_backend *)be;
+    ssize_t ret;
+
+    ret = write(dev->fd, buf, len);
+    if (ret != (ssize_t)len) {
+        if (ret >= 0) {
+            errno = EIO;
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+static int i2cdev_read(struct i2clcd_backend *be, uint8_t *buf, size_t len)
+{
+    struct i2cdev_backend *dev = (struct i2cdev_backend *)be;
+    ssize_t ret;
+
+    ret = read(dev->fd, buf, len);
+    if (ret != (ssize_t)len) {
+        if (ret >= 0) {
+            errno = EIO;
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+/* One message to another address, leaving the I2C_SLAVE binding alone */
+static int i2cdev_write_to(struct i2clcd_backend *be, uint8_t addr,
+                           const uint8_t *buf, size_t len)
+{
+    struct i2cdev_backend *dev = (struct i2cdev_backend *)be;
+    struct i2c_msg msg = {
+        .addr  = addr,
+        .flags = 0,
+        .len   = (uint16_t)len,
+        .buf   = (uint8_t *)buf,
+    };
+    struct i2c_rdwr_ioctl_data xfer = { .msgs = &msg, .nmsgs = 1 };
+
+    if (ioctl(dev->fd, I2C_RDWR, &xfer) != 1) {
+        if (errno == 0) {
+            errno = EIO;
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+/* One I2C_RDWR call, a repeated START between the messages */
+static int i2cdev_write_many(struct i2clcd_backend *be, const uint8_t *addrs,
+                             size_t naddrs, const uint8_t *buf, size_t len)
+{
+    struct i2cdev_backend *dev = (struct i2cdev_backend *)be;
+    struct i2c_msg msgs[I2CLCD_MIRROR_MAX];
+    struct i2c_rdwr_ioctl_data xfer = { .msgs = msgs };
+    size_t i;
+    int ret;
+
+    if (naddrs > I2CLCD_MIRROR_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < naddrs; i++) {
+        msgs[i].addr  = addrs[i];
+        msgs[i].flags = 0;
+        msgs[i].len   = (uint16_t)len;
+        msgs[i].buf   = (uint8_t *)buf;
+    }
+    xfer.nmsgs = (uint32_t)naddrs;
+
+    /* Most adapters fail the whole call; some report a short count */
+    ret = ioctl(dev->fd, I2C_RDWR, &xfer);
+    if (ret >= 0 && ret < (int)naddrs) {
+        errno = EIO;
+    }
+    return ret;
+}
+
+static int i2cdev_set_adapter(struct i2clcd_backend *be,
+                              unsigned int timeout_ms, unsigned int retries)
+{
+    struct i2cdev_backend *dev = (struct i2cdev_backend *)be;
+    unsigned long ticks;
+
+    /* The adapter timeout is set in units of 10 ms */
+    if (timeout_ms > 0) {
+        ticks = (timeout_ms + 9) / 10;
+        if (ioctl(dev->fd, I2C_TIMEOUT, ticks) < 0) {
+            return -1;
+        }
+    }
+
+    if (retries > 0 && ioctl(dev->fd, I2C_RETRIES, (unsigned long)retries) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void i2cdev_destroy(struct i2clcd_backend *be)
+{
+    struct i2cdev_backend *dev = (struct i2cdev_backend *)be;
+
+    if (dev->fd >= 0) {
+        close(dev->fd);
+    }
+    free(dev);
+}
+
+static const struct i2clcd_backend_ops i2cdev_ops = {
+    .name    = "i2c-dev",
+    .kernel  = true,
+    .write   = i2cdev_write,
+    .read    = i2cdev_read,
+    .write_to = i2cdev_write_to,
+    .write_many = i2cdev_write_many,
+    .set_adapter = i2cdev_set_adapter,
+    .destroy = i2cdev_destroy,
+};
+
+static i2clcd_err_t i2cdev_create(const char *device, uint8_t addr,
+                                  struct i2clcd_backend **be)
+{
+    struct i2cdev_backend *dev;
+
+    if (!device) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    dev = calloc(1, sizeof(*dev));
+    if (!dev) {
+        return I2CLCD_ERR_NOMEM;
+    }
+    dev->base.ops = &i2cdev_ops;
+
+    /* Open I2C device */
+    dev->fd = open(device, O_RDWR);
+    if (dev->fd < 0) {
+        free(dev);
+        return I2CLCD_ERR_OPEN;
+    }
+
+    /* Set I2C slave address */
+    if (ioctl(dev->fd, I2C_SLAVE, addr) < 0) {
+        close(dev->fd);
+        free(dev);
+        return I2CLCD_ERR_IOCTL;
+    }
+
+    *be = &dev->base;
+    return I2CLCD_OK;
+}
+
+/*---------------------------------------------------------------------------
+ * Null Backend
+ *---------------------------------------------------------------------------*/
+
+static int null_write(struct i2clcd_backend *be, const uint8_t *buf,
+                      size_t len)
+{
+    (void)be;
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
+static int null_write_to(struct i2clcd_backend *be, uint8_t addr,
+                         const uint8_t *buf, size_t len)
+{
+    (void)addr;
+    return null_write(be, buf, len);
+}
+
+static int null_write_many(struct i2clcd_backend *be, const uint8_t *addrs,
+                           size_t naddrs, const uint8_t *buf, size_t len)
+{
+    (void)addrs;
+    return null_write(be, buf, len) < 0 ? -1 : (int)naddrs;
+}
+
+static int null_read(struct i2clcd_backend *be, uint8_t *buf, size_t len)
+{
+    (void)be;
+    memset(buf, 0xFF, len);
+    return 0;
+}
+
+static void null_destroy(struct i2clcd_backend *be)
+{
+    free(be);
+}
+
+static const struct i2clcd_backend_ops null_ops = {
+    .name    = "null",
+    .write   = null_write,
+    .read    = null_read,
+    .write_to = null_write_to,
+    .write_many = null_write_many,
+    .destroy = null_destroy,
+};
+
+static i2clcd_err_t null_create(struct i2clcd_backend **be)
+{
+    *be = calloc(1, sizeof(**be));
+    if (!*be) {
+        return I2CLCD_ERR_NOMEM;
+    }
+
+    (*be)->ops = &null_ops;
+    return I2CLCD_OK;
+}
+
+/*---------------------------------------------------------------------------
+ * Backend Stack
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_backend_create(const i2clcd_config_t *config,
+                                   struct i2clcd_backend **be)
+{
+    switch (config->backend) {
+    case I2CLCD_BACKEND_I2CDEV:
+        return i2cdev_create(config->i2c_device, config->i2c_addr, be);
+    case I2CLCD_BACKEND_EMULATOR:
+        return i2clcd_backend_emu_create(config, be);
+    case I2CLCD_BACKEND_NULL:
+        return null_create(be);
+    default:
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+}
+
+void i2clcd_backend_push(i2clcd_t *ctx, struct i2clcd_backend *be)
+{
+    be->inner = ctx->backend;
+    ctx->backend = be;
+}
+
+struct i2clcd_backend *i2clcd_backend_find(i2clcd_t *ctx,
+                                           const struct i2clcd_backend_ops *ops)
+{
+    struct i2clcd_backend *be;
+
+    for (be = ctx->backend; be; be = be->inner) {
+        if (be->ops == ops) {
+            return be;
+        }
+    }
+    return NULL;
+}
+
+void i2clcd_backend_push_bottom(i2clcd_t *ctx, struct i2clcd_backend *be)
+{
+    struct i2clcd_backend **link = &ctx->backend;
+
+    while ((*link)->inner) {
+        link = &(*link)->inner;
+    }
+    be->inner = *link;
+    *link = be;
+}
+
+void i2clcd_backend_remove(i2clcd_t *ctx, struct i2clcd_backend *be)
+{
+    struct i2clcd_backend **link;
+
+    for (link = &ctx->backend; *link; link = &(*link)->inner) {
+        if (*link == be) {
+            *link = be->inner;
+            be->ops->destroy(be);
+            return;
+        }
+    }
+}
+
+void i2clcd_backend_destroy_all(i2clcd_t *ctx)
+{
+    struct i2clcd_backend *be, *inner;
+
+    for (be = ctx->backend; be; be = inner) {
+        inner = be->inner;
+        be->ops->destroy(be);
+    }
+    ctx->backend = NULL;
+}
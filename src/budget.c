@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * budget.c - Token-bucket bus budget for shared I2C buses
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * Bus Time Model
+ *---------------------------------------------------------------------------*/
+
+/* Address byte plus data bytes, 9 clocks each, plus START and STOP */
+static uint64_t xfer_ns(const i2clcd_budget_t *budget, size_t len)
+{
+    uint64_t bits = 9 * ((uint64_t)len + 1) + 2;
+
+    return bits * 1000000000ULL / budget->cfg.bus_hz;
+}
+
+static void refill(i2clcd_budget_t *budget, uint64_t now)
+{
+    int64_t burst_ns = (int64_t)budget->cfg.burst_us * 1000;
+    uint64_t elapsed = 0;
+
+    /* Any gap long enough to fill the bucket is as good as forever */
+    if (now > budget->refill_ns) {
+        elapsed = now - budget->refill_ns;
+        if (elapsed > (uint64_t)burst_ns * 100) {
+            elapsed = (uint64_t)burst_ns * 100;
+        }
+    }
+
+    budget->tokens_ns += (int64_t)(elapsed * budget->cfg.max_duty_pct / 100);
+    if (budget->tokens_ns > burst_ns) {
+        budget->tokens_ns = burst_ns;
+    }
+    budget->refill_ns = now;
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+uint64_t i2clcd_budget_acquire(i2clcd_t *ctx, size_t len)
+{
+    i2clcd_budget_t *budget = ctx->budget;
+    uint64_t gap_ns = (uint64_t)budget->cfg.min_gap_us * 1000;
+    int64_t cost, need;
+    uint64_t now, wait = 0, gap_end;
+
+    now = i2clcd_monotonic_ns(ctx);
+    refill(budget, now);
+
+    /* A chunk larger than the burst may run the bucket into debt */
+    cost = (int64_t)xfer_ns(budget, len);
+    need = cost;
+    if (need > (int64_t)budget->cfg.burst_us * 1000) {
+        need = (int64_t)budget->cfg.burst_us * 1000;
+    }
+
+    if (budget->tokens_ns < need) {
+        wait = (uint64_t)(need - budget->tokens_ns) * 100 /
+               budget->cfg.max_duty_pct;
+    }
+
+    /* A gap end further out than min_gap was stamped by another clock */
+    gap_end = budget->last_end_ns + gap_ns;
+    if (gap_end > now && gap_end - now <= gap_ns && gap_end - now > wait) {
+        wait = gap_end - now;
+    }
+
+    if (wait > 0) {
+        i2clcd_sleep_until_ns(ctx, now + wait);
+        refill(budget, i2clcd_monotonic_ns(ctx));
+        budget->stats.throttled_xfers++;
+        budget->stats.throttle_us += wait / 1000;
+    }
+
+    budget->tokens_ns -= cost;
+    budget->stats.xfers++;
+    budget->stats.bytes += len;
+    budget->stats.bus_time_us += (uint64_t)cost / 1000;
+
+    return wait;
+}
+
+bool i2clcd_budget_ready(i2clcd_t *ctx, size_t len)
+{
+    i2clcd_budget_t *budget = ctx->budget;
+    uint64_t gap_ns = (uint64_t)budget->cfg.min_gap_us * 1000;
+    uint64_t now = i2clcd_monotonic_ns(ctx);
+
+    refill(budget, now);
+
+    if (budget->tokens_ns < (int64_t)xfer_ns(budget, len)) {
+        return false;
+    }
+
+    return budget->last_end_ns + gap_ns <= now ||
+           budget->last_end_ns + gap_ns - now > gap_ns;
+}
+
+void i2clcd_budget_charge(i2clcd_t *ctx, size_t len)
+{
+    i2clcd_budget_t *budget = ctx->budget;
+    int64_t cost = (int64_t)(9 * (uint64_t)len * 1000000000ULL /
+                             budget->cfg.bus_hz);
+
+    budget->tokens_ns -= cost;
+    budget->stats.bytes += len;
+    budget->stats.bus_time_us += (uint64_t)cost / 1000;
+}
+
+void i2clcd_budget_release(i2clcd_t *ctx)
+{
+    ctx->budget->last_end_ns = i2clcd_monotonic_ns(ctx);
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_budget_create(const i2clcd_budget_config_t *config,
+                                  i2clcd_budget_t **budget)
+{
+    i2clcd_budget_t *b;
+
+    if (!config || !budget) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (config->bus_hz == 0 ||
+        config->max_duty_pct == 0 || config->max_duty_pct > 100) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    b = calloc(1, sizeof(*b));
+    if (!b) {
+        return I2CLCD_ERR_NOMEM;
+    }
+
+    b->cfg = *config;
+    /* Starts full; the clock is the first user's, so refill_ns waits */
+    b->tokens_ns = (int64_t)config->burst_us * 1000;
+
+    *budget = b;
+    return I2CLCD_OK;
+}
+
+void i2clcd_budget_destroy(i2clcd_budget_t *budget)
+{
+    free(budget);
+}
+
+i2clcd_err_t i2clcd_set_budget(i2clcd_t *handle, i2clcd_budget_t *budget)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    handle->budget = budget;
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_budget_stats(i2clcd_budget_t *budget,
+                                 i2clcd_budget_stats_t *stats)
+{
+    if (!budget || !stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    *stats = budget->stats;
+    return I2CLCD_OK;
+}
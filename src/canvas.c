@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * canvas.c - One character grid across many panels, flushed per bus
+ *
+ * The canvas holds no cells of its own: a write lands in the compositor
+ * back buffers of the panels it crosses, and each compositor diffs against
+ * its panel's shadow. A flush groups panels that share a bus, mux or
+ * budget, directly or through other panels, and hands each group to
+ * i2clcd_mux_flush() on its own thread.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+struct canvas_panel {
+    i2clcd_t *lcd;
+    uint16_t col;          /* Canvas position of the panel's (0, 0) */
+    uint16_t row;
+};
+
+/* Threads wait here until every bus is ready (sync flushes) */
+struct canvas_gate {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    bool     open;
+};
+
+struct canvas_bus {
+    i2clcd_t **lcds;       /* Slice of the flush's grouped handle list */
+    size_t   count;
+    struct canvas_gate *gate; /* NULL when not synchronized */
+    pthread_t thread;
+    bool     started;
+    i2clcd_err_t err;
+    uint64_t elapsed_ns;   /* Flush time on the first panel's clock */
+};
+
+struct i2clcd_canvas {
+    uint16_t cols;
+    uint16_t rows;
+    struct canvas_panel *panels; /* In attach order */
+    i2clcd_t **lcds;       /* Handles in panel order */
+    size_t   count;
+    i2clcd_canvas_stats_t stats;
+};
+
+/*---------------------------------------------------------------------------
+ * Bus Grouping
+ *---------------------------------------------------------------------------*/
+
+/* Handles that would contend for one bus if flushed concurrently */
+static bool same_bus(const i2clcd_t *a, const i2clcd_t *b)
+{
+    if (a == b) {
+        return true;
+    }
+    if (a->bus[0] != '\0' && strcmp(a->bus, b->bus) == 0) {
+        return true;
+    }
+    return (a->mux && a->mux == b->mux) ||
+           (a->budget && a->budget == b->budget);
+}
+
+/* Union-find root; a component is named by its first panel */
+static size_t group_of(size_t *link, size_t i)
+{
+    while (link[i] != i) {
+        link[i] = link[link[i]];
+        i = link[i];
+    }
+    return i;
+}
+
+/*
+ * Connect every pair that contends, so a chain such as mux M - budget Q
+ * puts both ends in one group even though they share nothing directly
+ */
+static void group_panels(const i2clcd_canvas_t *canvas, size_t *link)
+{
+    size_t i, j, a, b;
+
+    for (i = 0; i < canvas->count; i++) {
+        link[i] = i;
+    }
+
+    for (i = 1; i < canvas->count; i++) {
+        for (j = 0; j < i; j++) {
+            if (!same_bus(canvas->lcds[i], canvas->lcds[j])) {
+                continue;
+            }
+            a = group_of(link, i);
+            b = group_of(link, j);
+            if (a < b) {
+                link[b] = a;
+            } else {
+                link[a] = b;
+            }
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * Parallel Flush
+ *---------------------------------------------------------------------------*/
+
+static void *flush_bus(void *arg)
+{
+    struct canvas_bus *bus = arg;
+    struct canvas_gate *gate = bus->gate;
+    uint64_t t0;
+
+    if (gate) {
+        pthread_mutex_lock(&gate->lock);
+        while (!gate->open) {
+            pthread_cond_wait(&gate->cond, &gate->lock);
+        }
+        pthread_mutex_unlock(&gate->lock);
+    }
+
+    t0 = i2clcd_monotonic_ns(bus->lcds[0]);
+    bus->err = i2clcd_mux_flush(bus->lcds, bus->count);
+    bus->elapsed_ns = i2clcd_monotonic_ns(bus->lcds[0]) - t0;
+    return NULL;
+}
+
+/* Lay each group out contiguously in order, one bus per group */
+static size_t split_buses(i2clcd_canvas_t *canvas, struct canvas_bus *buses,
+                          i2clcd_t **order, size_t *link,
+                          struct canvas_gate *gate)
+{
+    size_t i, j, n = 0, at = 0;
+
+    group_panels(canvas, link);
+
+    for (i = 0; i < canvas->count; i++) {
+        if (group_of(link, i) != i) {
+            continue;
+        }
+        memset(&buses[n], 0, sizeof(buses[n]));
+        buses[n].lcds = &order[at];
+        buses[n].gate = gate;
+        for (j = i; j < canvas->count; j++) {
+            if (group_of(link, j) == i) {
+                order[at++] = canvas->lcds[j];
+                buses[n].count++;
+            }
+        }
+        n++;
+    }
+    return n;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_canvas_create(uint16_t cols, uint16_t rows,
+                                  i2clcd_canvas_t **canvas)
+{
+    if (!canvas) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (cols == 0 || rows == 0) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    *canvas = calloc(1, sizeof(**canvas));
+    if (!*canvas) {
+        return I2CLCD_ERR_NOMEM;
+    }
+
+    (*canvas)->cols = cols;
+    (*canvas)->rows = rows;
+    return I2CLCD_OK;
+}
+
+void i2clcd_canvas_destroy(i2clcd_canvas_t *canvas)
+{
+    if (canvas) {
+        free(canvas->panels);
+        free(canvas->lcds);
+        free(canvas);
+    }
+}
+
+i2clcd_err_t i2clcd_canvas_attach(i2clcd_canvas_t *canvas, i2clcd_t *handle,
+                                  uint16_t col, uint16_t row)
+{
+    struct canvas_panel panel = { handle, col, row };
+    struct canvas_panel *panels;
+    i2clcd_t **lcds;
+    const struct canvas_panel *p;
+    size_t i;
+
+    if (!canvas || !handle) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (!handle->compositor.enabled) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if ((uint32_t)col + handle->cols > canvas->cols ||
+        (uint32_t)row + handle->rows > canvas->rows) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    for (i = 0; i < canvas->count; i++) {
+        p = &canvas->panels[i];
+        if (p->lcd == handle ||
+            (col < p->col + p->lcd->cols && p->col < col + handle->cols &&
+             row < p->row + p->lcd->rows && p->row < row + handle->rows)) {
+            return I2CLCD_ERR_INVALID_ARG;
+        }
+    }
+
+    panels = realloc(canvas->panels, (canvas->count + 1) * sizeof(*panels));
+    if (!panels) {
+        return I2CLCD_ERR_NOMEM;
+    }
+    canvas->panels = panels;
+
+    lcds = realloc(canvas->lcds, (canvas->count + 1) * sizeof(*lcds));
+    if (!lcds) {
+        return I2CLCD_ERR_NOMEM;
+    }
+    canvas->lcds = lcds;
+
+    canvas->panels[canvas->count] = panel;
+    canvas->lcds[canvas->count] = handle;
+    canvas->count++;
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_canvas_write(i2clcd_canvas_t *canvas, uint16_t col,
+                                 uint16_t row, const char *text)
+{
+    const struct canvas_panel *p;
+    size_t len, i;
+    uint16_t first, last;
+
+    if (!canvas || !text) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (col >= canvas->cols || row >= canvas->rows) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    len = strnlen(text, (size_t)(canvas->cols - col));
+    if (len == 0) {
+        return I2CLCD_OK;
+    }
+
+    /* Hand each panel the part of the text that crosses it */
+    for (i = 0; i < canvas->count; i++) {
+        p = &canvas->panels[i];
+        if (row < p->row || row >= p->row + p->lcd->rows) {
+            continue;
+        }
+
+        first = col > p->col ? col : p->col;
+        last = (uint16_t)(col + len);
+        if (last > p->col + p->lcd->cols) {
+            last = (uint16_t)(p->col + p->lcd->cols);
+        }
+        if (first >= last) {
+            continue;
+        }
+
+        i2clcd_compositor_move(p->lcd, (uint8_t)(first - p->col),
+                               (uint8_t)(row - p->row));
+        i2clcd_compositor_write(p->lcd, text + (first - col),
+                                (size_t)(last - first));
+    }
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_canvas_clear(i2clcd_canvas_t *canvas)
+{
+    size_t i;
+
+    if (!canvas) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    for (i = 0; i < canvas->count; i++) {
+        i2clcd_compositor_clear(canvas->lcds[i], -1);
+    }
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_canvas_flush(i2clcd_canvas_t *canvas, bool sync)
+{
+    struct canvas_gate gate = { .open = false };
+    struct canvas_bus *buses;
+    i2clcd_t **order;
+    size_t *link;
+    i2clcd_err_t err = I2CLCD_OK;
+    uint64_t t0, window = 0;
+    size_t i, n;
+
+    if (!canvas) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (canvas->count == 0) {
+        return I2CLCD_OK;
+    }
+
+    /* Timed on the first panel's clock, like the bus windows */
+    t0 = i2clcd_monotonic_ns(canvas->lcds[0]);
+    buses = calloc(canvas->count, sizeof(*buses));
+    order = calloc(canvas->count, sizeof(*order));
+    link = calloc(canvas->count, sizeof(*link));
+    if (!buses || !order || !link) {
+        free(buses);
+        free(order);
+        free(link);
+        return i2clcd_stats_api(canvas->lcds[0], I2CLCD_API_CANVAS_FLUSH, t0,
+                                I2CLCD_ERR_NOMEM);
+    }
+
+    if (sync) {
+        pthread_mutex_init(&gate.lock, NULL);
+        pthread_cond_init(&gate.cond, NULL);
+    }
+    n = split_buses(canvas, buses, order, link, sync ? &gate : NULL);
+
+    /* A single bus has nothing to run alongside */
+    for (i = 0; n > 1 && i < n; i++) {
+        buses[i].started = pthread_create(&buses[i].thread, NULL,
+                                          flush_bus, &buses[i]) == 0;
+    }
+
+    if (sync) {
+        pthread_mutex_lock(&gate.lock);
+        gate.open = true;
+        pthread_cond_broadcast(&gate.cond);
+        pthread_mutex_unlock(&gate.lock);
+    }
+
+    /* Buses without a thread go from here, after the others have started */
+    for (i = 0; i < n; i++) {
+        if (!buses[i].started) {
+            flush_bus(&buses[i]);
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        if (buses[i].started) {
+            pthread_join(buses[i].thread, NULL);
+        }
+        if (buses[i].err != I2CLCD_OK && err == I2CLCD_OK) {
+            err = buses[i].err;
+        }
+        if (buses[i].elapsed_ns > window) {
+            window = buses[i].elapsed_ns;
+        }
+    }
+
+    if (sync) {
+        pthread_cond_destroy(&gate.cond);
+        pthread_mutex_destroy(&gate.lock);
+    }
+    free(buses);
+    free(order);
+    free(link);
+
+    canvas->stats.flushes++;
+    canvas->stats.buses = (uint32_t)n;
+    canvas->stats.window_last_ns = window;
+    if (window > canvas->stats.window_max_ns) {
+        canvas->stats.window_max_ns = window;
+    }
+
+    return i2clcd_stats_api(canvas->lcds[0], I2CLCD_API_CANVAS_FLUSH, t0, err);
+}
+
+i2clcd_err_t i2clcd_canvas_stats(i2clcd_canvas_t *canvas,
+                                 i2clcd_canvas_stats_t *stats)
+{
+    if (!canvas || !stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    *stats = canvas->stats;
+    return I2CLCD_OK;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * clock.c - Per-handle clock, delays and the virtual clock
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * System Clock
+ *---------------------------------------------------------------------------*/
+
+static uint64_t system_now_ns(void *user)
+{
+    struct timespec ts;
+
+    (void)user;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void system_sleep_until_ns(void *user, uint64_t deadline_ns)
+{
+    struct timespec ts;
+
+    (void)user;
+    ts.tv_sec = deadline_ns / 1000000000ULL;
+    ts.tv_nsec = deadline_ns % 1000000000ULL;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        /* Absolute deadline, so simply retry */
+    }
+}
+
+static const i2clcd_clock_t system_clock = {
+    .now_ns         = system_now_ns,
+    .sleep_until_ns = system_sleep_until_ns,
+    .user           = NULL,
+};
+
+/*---------------------------------------------------------------------------
+ * Virtual Clock
+ *---------------------------------------------------------------------------*/
+
+static uint64_t vclock_now_ns(void *user)
+{
+    return ((i2clcd_vclock_t *)user)->now_ns;
+}
+
+static void vclock_sleep_until_ns(void *user, uint64_t deadline_ns)
+{
+    i2clcd_vclock_t *vc = user;
+
+    vc->sleeps++;
+    if (deadline_ns > vc->now_ns) {
+        vc->slept_ns += deadline_ns - vc->now_ns;
+        vc->now_ns = deadline_ns;
+    }
+}
+
+void i2clcd_vclock_init(i2clcd_vclock_t *vc, i2clcd_clock_t *clock)
+{
+    memset(vc, 0, sizeof(*vc));
+
+    clock->now_ns = vclock_now_ns;
+    clock->sleep_until_ns = vclock_sleep_until_ns;
+    clock->user = vc;
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+uint64_t i2clcd_monotonic_ns(const i2clcd_t *ctx)
+{
+    return ctx->clock.now_ns(ctx->clock.user);
+}
+
+void i2clcd_sleep_until_ns(i2clcd_t *ctx, uint64_t deadline_ns)
+{
+    ctx->clock.sleep_until_ns(ctx->clock.user, deadline_ns);
+}
+
+void i2clcd_delay_us(i2clcd_t *ctx, unsigned int us)
+{
+    uint64_t t0 = i2clcd_monotonic_ns(ctx);
+
+    if (ctx->clock_syscalls) {
+        ctx->stats.syscalls++;
+    }
+    i2clcd_sleep_until_ns(ctx, t0 + (uint64_t)us * 1000);
+
+    ctx->stats.sleeps++;
+    ctx->stats.sleep_ns += i2clcd_monotonic_ns(ctx) - t0;
+}
+
+void i2clcd_delay_ms(i2clcd_t *ctx, unsigned int ms)
+{
+    i2clcd_delay_us(ctx, ms * 1000);
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_set_clock(i2clcd_t *handle, const i2clcd_clock_t *clock)
+{
+    struct i2clcd_compositor *comp;
+    uint64_t now;
+    int prio, row, slot;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (clock && (!clock->now_ns || !clock->sleep_until_ns)) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    handle->clock = clock ? *clock : system_clock;
+    handle->clock_syscalls = (handle->clock.now_ns == system_now_ns);
+
+    /* Timestamps from the old clock mean nothing on the new one */
+    comp = &handle->compositor;
+    now = i2clcd_monotonic_ns(handle);
+    if (comp->enabled) {
+        comp->deadline_ns = now + comp->period_ns;
+    }
+    for (prio = 0; prio < I2CLCD_PRIO_COUNT; prio++) {
+        for (row = 0; row < I2CLCD_MAX_ROWS; row++) {
+            if (comp->lanes[prio].since_ns[row] != 0) {
+                comp->lanes[prio].since_ns[row] = now;
+            }
+        }
+    }
+
+    handle->anim.epoch_ns = now;
+    for (slot = 0; slot < I2CLCD_GLYPH_SLOTS; slot++) {
+        handle->anim.slots[slot].next_ns =
+            now + handle->anim.slots[slot].period_ns;
+    }
+
+    return I2CLCD_OK;
+}
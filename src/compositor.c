@@ -0,0 +1,644 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * compositor.c - Back buffer, minimal-diff flush and frame pacing
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+#include "hd44780.h"
+
+/*---------------------------------------------------------------------------
+ * Back Buffer Writes
+ *---------------------------------------------------------------------------*/
+
+/* Shadow of a row's cell: on a 40x4 panel each controller has its own */
+static bool cell_known(const i2clcd_t *ctx, uint8_t row, uint8_t col,
+                       uint8_t *value)
+{
+    const struct i2clcd_shadow *sh = i2clcd_line_shadow(ctx, row);
+    uint8_t addr = ctx->line_addr[row] + col;
+
+    *value = sh->ddram[addr];
+    return (sh->ddram_valid[addr >> 3] >> (addr & 7)) & 1;
+}
+
+static bool cell_differs(const i2clcd_t *ctx, uint8_t row, uint8_t col)
+{
+    uint8_t value;
+
+    return !cell_known(ctx, row, col, &value) ||
+           value != ctx->compositor.back[row][col];
+}
+
+static void note_update(struct i2clcd_compositor *comp, uint8_t rows)
+{
+    comp->stats.updates++;
+    if (comp->dirty & rows) {
+        comp->stats.updates_coalesced++;
+    }
+    comp->dirty |= rows;
+}
+
+/*
+ * Store one cell at the current priority. A pending cell only yields to an
+ * equal or higher priority; whichever update loses is counted as superseded.
+ */
+static void put_cell(i2clcd_t *ctx, uint8_t row, uint8_t col, uint8_t c)
+{
+    struct i2clcd_compositor *comp = &ctx->compositor;
+    struct i2clcd_lane *lane = &comp->lanes[comp->prio];
+    uint8_t pending = comp->prio_map[row][col];
+
+    if (cell_differs(ctx, row, col)) {
+        if (pending > comp->prio) {
+            lane->stats.superseded++;
+            return;
+        }
+        if (pending < comp->prio) {
+            comp->lanes[pending].stats.superseded++;
+        }
+    }
+
+    comp->back[row][col] = c;
+    comp->prio_map[row][col] = (uint8_t)comp->prio;
+
+    if (lane->since_ns[row] == 0 && cell_differs(ctx, row, col)) {
+        lane->since_ns[row] = i2clcd_monotonic_ns(ctx);
+    }
+}
+
+void i2clcd_compositor_move(i2clcd_t *ctx, uint8_t col, uint8_t row)
+{
+    ctx->compositor.col = col;
+    ctx->compositor.row = row;
+}
+
+void i2clcd_compositor_write(i2clcd_t *ctx, const char *text, size_t len)
+{
+    struct i2clcd_compositor *comp = &ctx->compositor;
+    size_t i;
+
+    /* Text past the end of the row is dropped rather than wrapped */
+    for (i = 0; i < len && comp->col < ctx->cols; i++) {
+        put_cell(ctx, comp->row, comp->col++, (uint8_t)text[i]);
+    }
+
+    note_update(comp, (uint8_t)(1 << comp->row));
+}
+
+void i2clcd_compositor_set_line(i2clcd_t *ctx, uint8_t line, const char *text)
+{
+    struct i2clcd_compositor *comp = &ctx->compositor;
+    size_t len, i;
+
+    len = strlen(text);
+    for (i = 0; i < ctx->cols; i++) {
+        put_cell(ctx, line, (uint8_t)i, (uint8_t)((i < len) ? text[i] : ' '));
+    }
+
+    /* Match the immediate path, which leaves the cursor after the line */
+    comp->row = line;
+    comp->col = ctx->cols;
+
+    note_update(comp, (uint8_t)(1 << line));
+}
+
+void i2clcd_compositor_clear(i2clcd_t *ctx, int line)
+{
+    struct i2clcd_compositor *comp = &ctx->compositor;
+    uint8_t row, col;
+
+    if (line < 0) {
+        for (row = 0; row < ctx->rows; row++) {
+            for (col = 0; col < ctx->cols; col++) {
+                put_cell(ctx, row, col, ' ');
+            }
+        }
+        comp->row = 0;
+        comp->col = 0;
+        note_update(comp, (uint8_t)((1 << ctx->rows) - 1));
+    } else {
+        for (col = 0; col < ctx->cols; col++) {
+            put_cell(ctx, (uint8_t)line, col, ' ');
+        }
+        comp->row = (uint8_t)line;
+        comp->col = ctx->cols;
+        note_update(comp, (uint8_t)(1 << line));
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * Minimal-Diff Flush
+ *---------------------------------------------------------------------------*/
+
+/* Shadow validity bits for the cells of one row */
+static uint64_t row_known(const i2clcd_t *ctx, uint8_t row)
+{
+    const uint8_t *valid = i2clcd_line_shadow(ctx, row)->ddram_valid;
+    uint8_t addr = ctx->line_addr[row];
+    unsigned int i, first = addr >> 3;
+    uint64_t bits = 0;
+
+    /* 40 cells span at most 6 bitmap bytes, whatever the alignment */
+    for (i = 0; i < 7 && first + i < HD44780_DDRAM_SIZE / 8; i++) {
+        bits |= (uint64_t)valid[first + i] << (8 * i);
+    }
+
+    return (bits >> (addr & 7)) & (((uint64_t)1 << ctx->cols) - 1);
+}
+
+/* Cells of a row that differ from the glass, as a bitmask */
+static uint64_t row_changed(const i2clcd_t *ctx, uint8_t row)
+{
+    return i2clcd_diff_mask(i2clcd_line_shadow(ctx, row)->ddram +
+                            ctx->line_addr[row],
+                            ctx->compositor.back[row], ctx->cols) |
+           ~row_known(ctx, row);
+}
+
+static bool cell_in_lane(const i2clcd_t *ctx, uint8_t row, uint8_t col,
+                         i2clcd_prio_t prio, uint64_t changed)
+{
+    return ctx->compositor.prio_map[row][col] == prio &&
+           ((changed >> col) & 1);
+}
+
+static int set_ddram_addr(i2clcd_t *ctx, uint8_t addr)
+{
+    const struct i2clcd_shadow *sh = &ctx->shadow;
+
+    /* Skip the command when the address counter is already there */
+    if (sh->addr_valid && !sh->addr_cgram && sh->addr == addr) {
+        return 0;
+    }
+
+    return i2clcd_command(ctx, HD44780_CMD_SET_DDRAM | addr);
+}
+
+static void lane_flushed(struct i2clcd_compositor *comp, i2clcd_prio_t prio,
+                         uint8_t row, uint64_t now)
+{
+    struct i2clcd_lane *lane = &comp->lanes[prio];
+    uint64_t latency;
+
+    if (lane->since_ns[row] == 0) {
+        return;
+    }
+
+    latency = now - lane->since_ns[row];
+    lane->since_ns[row] = 0;
+
+    lane->stats.flushes++;
+    lane->stats.latency_last_ns = latency;
+    if (latency > lane->stats.latency_max_ns) {
+        lane->stats.latency_max_ns = latency;
+    }
+    lane->latency_sum_ns += latency;
+    lane->stats.latency_mean_ns = lane->latency_sum_ns / lane->stats.flushes;
+}
+
+/* Row order for a flush: on a 40x4 panel, rows of a controller still
+ * executing a slow instruction go last, so the other half is written
+ * while it finishes */
+static uint8_t row_order(const i2clcd_t *ctx, uint8_t order[I2CLCD_MAX_ROWS])
+{
+    uint8_t row, n = 0;
+    bool busy;
+    int pass;
+
+    if (ctx->ctrls < 2) {
+        for (row = 0; row < ctx->rows; row++) {
+            order[n++] = row;
+        }
+        return n;
+    }
+
+    for (pass = 0; pass < 2; pass++) {
+        for (row = 0; row < ctx->rows; row++) {
+            busy = i2clcd_busy_ns(ctx,
+                                  (uint8_t)(1u << ctx->line_ctrl[row])) > 0;
+            if (busy == (pass == 1)) {
+                order[n++] = row;
+            }
+        }
+    }
+    return n;
+}
+
+/* Send every pending cell of one priority lane, row by row */
+static int commit_lane(i2clcd_t *ctx, i2clcd_prio_t prio)
+{
+    struct i2clcd_compositor *comp = &ctx->compositor;
+    uint8_t order[I2CLCD_MAX_ROWS];
+    uint8_t i, n, row, col, end;
+    uint64_t changed;
+    int written = 0;
+
+    n = row_order(ctx, order);
+    for (i = 0; i < n; i++) {
+        row = order[i];
+        if (!(comp->dirty & (1 << row))) {
+            continue;
+        }
+
+        /* Writing a run only touches cells behind the scan */
+        changed = row_changed(ctx, row);
+
+        col = 0;
+        while (col < ctx->cols) {
+            if (!cell_in_lane(ctx, row, col, prio, changed)) {
+                col++;
+                continue;
+            }
+
+            /*
+             * Extend the run over changed cells. A single other cell costs
+             * the same as a new Set DDRAM command, so bridge it.
+             */
+            end = col + 1;
+            for (;;) {
+                while (end < ctx->cols &&
+                       cell_in_lane(ctx, row, end, prio, changed)) {
+                    end++;
+                }
+                if (end + 1 < ctx->cols &&
+                    cell_in_lane(ctx, row, end + 1, prio, changed)) {
+                    end += 2;
+                    continue;
+                }
+                break;
+            }
+
+            if (i2clcd_select_line(ctx, row) < 0 ||
+                set_ddram_addr(ctx, ctx->line_addr[row] + col) < 0) {
+                return -1;
+            }
+
+            if (i2clcd_data_run(ctx, &comp->back[row][col], end - col) < 0) {
+                return -1;
+            }
+            written += end - col;
+            col = end;
+        }
+
+        lane_flushed(comp, prio, row, i2clcd_monotonic_ns(ctx));
+    }
+
+    comp->lanes[prio].stats.cells += (uint64_t)written;
+    return written;
+}
+
+/* Send lanes from highest priority down to min_prio */
+static int commit_rows(i2clcd_t *ctx, i2clcd_prio_t min_prio)
+{
+    struct i2clcd_compositor *comp = &ctx->compositor;
+    int prio, ret, written = 0;
+
+    for (prio = I2CLCD_PRIO_COUNT - 1; prio >= (int)min_prio; prio--) {
+        ret = commit_lane(ctx, (i2clcd_prio_t)prio);
+        if (ret < 0) {
+            return -1;
+        }
+        written += ret;
+    }
+
+    if (min_prio == I2CLCD_PRIO_LOW) {
+        comp->dirty = 0;
+    }
+
+    /* A visible cursor belongs at the software cursor, not after the diff */
+    if (written > 0 &&
+        (ctx->display_ctrl & (HD44780_CURSOR_ON | HD44780_BLINK_ON)) &&
+        comp->row < ctx->rows && comp->col < ctx->cols) {
+        if (i2clcd_select_line(ctx, comp->row) < 0 ||
+            set_ddram_addr(ctx, ctx->line_addr[comp->row] + comp->col) < 0) {
+            return -1;
+        }
+    }
+
+    comp->stats.cells_written += (uint64_t)written;
+    return written;
+}
+
+int i2clcd_compositor_commit(i2clcd_t *ctx, i2clcd_prio_t min_prio)
+{
+    int written;
+
+    i2clcd_batch_begin(ctx);
+    written = commit_rows(ctx, min_prio);
+    if (i2clcd_batch_end(ctx) < 0) {
+        written = -1;
+    }
+
+    /* A failed batch discards the shadow, so every row needs a redraw */
+    if (written < 0) {
+        ctx->compositor.dirty = (uint8_t)((1 << ctx->rows) - 1);
+    }
+
+    return written;
+}
+
+i2clcd_err_t i2clcd_compositor_expedite(i2clcd_t *ctx)
+{
+    /* High priority does not wait for the frame clock */
+    if (ctx->compositor.prio < I2CLCD_PRIO_HIGH) {
+        return I2CLCD_OK;
+    }
+
+    if (i2clcd_compositor_commit(ctx, I2CLCD_PRIO_HIGH) < 0) {
+        return I2CLCD_ERR_WRITE;
+    }
+
+    return I2CLCD_OK;
+}
+
+/*---------------------------------------------------------------------------
+ * Frame Pacing
+ *---------------------------------------------------------------------------*/
+
+/* Earliest button read or animation frame, or the frame deadline */
+static uint64_t next_event_ns(const i2clcd_t *ctx)
+{
+    uint64_t next = ctx->compositor.deadline_ns;
+    uint64_t anim = i2clcd_anim_next_ns(ctx);
+
+    if (ctx->buttons.enabled && ctx->buttons.next_ns < next) {
+        next = ctx->buttons.next_ns;
+    }
+    return anim < next ? anim : next;
+}
+
+static i2clcd_err_t service_frame(i2clcd_t *ctx, uint64_t now)
+{
+    struct i2clcd_compositor *comp = &ctx->compositor;
+    uint64_t lateness, missed;
+    int ret;
+
+    lateness = now - comp->deadline_ns;
+    missed = lateness / comp->period_ns;
+
+    comp->stats.frames++;
+    comp->stats.frames_dropped += missed;
+    comp->stats.jitter_last_ns = lateness;
+    if (lateness > comp->stats.jitter_max_ns) {
+        comp->stats.jitter_max_ns = lateness;
+    }
+    comp->jitter_sum_ns += lateness;
+    comp->stats.jitter_mean_ns = comp->jitter_sum_ns / comp->stats.frames;
+
+    /* Skip missed frames instead of bursting to catch up */
+    comp->deadline_ns += (missed + 1) * comp->period_ns;
+
+    /* Idle frames are spare bus time for the scrubber */
+    if (!comp->dirty) {
+        return i2clcd_scrub_run(ctx) < 0 ? I2CLCD_ERR_WRITE : I2CLCD_OK;
+    }
+
+    ret = i2clcd_compositor_commit(ctx, I2CLCD_PRIO_LOW);
+    if (ret < 0) {
+        return I2CLCD_ERR_WRITE;
+    }
+    if (ret > 0) {
+        comp->stats.frames_flushed++;
+    }
+
+    return I2CLCD_OK;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_compositor_start(i2clcd_t *handle, unsigned int fps)
+{
+    struct i2clcd_compositor *comp;
+    i2clcd_prio_t prio;
+    uint8_t row, col, c;
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (fps == 0 || fps > 1000) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    comp = &handle->compositor;
+    prio = comp->prio;
+    memset(comp, 0, sizeof(*comp));
+    comp->prio = prio;
+
+    /* Seed the back buffer from what is known to be on screen */
+    for (row = 0; row < handle->rows; row++) {
+        for (col = 0; col < handle->cols; col++) {
+            if (cell_known(handle, row, col, &c)) {
+                comp->back[row][col] = c;
+            } else {
+                comp->back[row][col] = ' ';
+                comp->dirty |= (uint8_t)(1 << row);
+            }
+            comp->prio_map[row][col] = I2CLCD_PRIO_NORMAL;
+        }
+    }
+
+    comp->period_ns = 1000000000ULL / fps;
+    comp->deadline_ns = i2clcd_monotonic_ns(handle) + comp->period_ns;
+    comp->enabled = true;
+
+    return i2clcd_stats_api(handle, I2CLCD_API_COMPOSITOR_START, t0,
+                            I2CLCD_OK);
+}
+
+i2clcd_err_t i2clcd_compositor_stop(i2clcd_t *handle)
+{
+    struct i2clcd_compositor *comp;
+    i2clcd_err_t err;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    comp = &handle->compositor;
+    if (!comp->enabled) {
+        return I2CLCD_OK;
+    }
+
+    err = i2clcd_compositor_flush(handle);
+    if (err != I2CLCD_OK) {
+        return err;
+    }
+
+    comp->enabled = false;
+
+    /* Hand the software cursor back to the controller */
+    if (comp->row < handle->rows && comp->col < handle->cols) {
+        return i2clcd_set_cursor(handle, comp->col, comp->row);
+    }
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_compositor_flush(i2clcd_t *handle)
+{
+    i2clcd_err_t err = I2CLCD_OK;
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!handle->compositor.enabled) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    if (i2clcd_compositor_commit(handle, I2CLCD_PRIO_LOW) < 0) {
+        err = I2CLCD_ERR_WRITE;
+    }
+
+    return i2clcd_stats_api(handle, I2CLCD_API_COMPOSITOR_FLUSH, t0, err);
+}
+
+i2clcd_err_t i2clcd_compositor_wait(i2clcd_t *handle)
+{
+    i2clcd_err_t ret, err = I2CLCD_OK;
+    uint64_t t0, next;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!handle->compositor.enabled) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+
+    /* Read the buttons and turn animation frames on time while waiting */
+    while ((next = next_event_ns(handle)) < handle->compositor.deadline_ns) {
+        i2clcd_sleep_until_ns(handle, next);
+        i2clcd_buttons_run(handle);
+        if (i2clcd_anim_run(handle) < 0) {
+            err = I2CLCD_ERR_WRITE;
+        }
+    }
+
+    i2clcd_sleep_until_ns(handle, handle->compositor.deadline_ns);
+    if (i2clcd_anim_run(handle) < 0) {
+        err = I2CLCD_ERR_WRITE;
+    }
+
+    ret = service_frame(handle, i2clcd_monotonic_ns(handle));
+    return i2clcd_stats_api(handle, I2CLCD_API_COMPOSITOR_WAIT, t0,
+                            ret != I2CLCD_OK ? ret : err);
+}
+
+i2clcd_err_t i2clcd_compositor_poll(i2clcd_t *handle, bool *flushed)
+{
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0, now;
+
+    if (flushed) {
+        *flushed = false;
+    }
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!handle->compositor.enabled) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    i2clcd_buttons_run(handle);
+    if (i2clcd_anim_run(handle) < 0) {
+        ret = I2CLCD_ERR_WRITE;
+    } else if ((now = i2clcd_monotonic_ns(handle)) >=
+               handle->compositor.deadline_ns) {
+        if (flushed) {
+            *flushed = true;
+        }
+        ret = service_frame(handle, now);
+    }
+
+    return i2clcd_stats_api(handle, I2CLCD_API_COMPOSITOR_POLL, t0, ret);
+}
+
+i2clcd_err_t i2clcd_compositor_stats(i2clcd_t *handle,
+                                     i2clcd_compositor_stats_t *stats)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    *stats = handle->compositor.stats;
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_set_priority(i2clcd_t *handle, i2clcd_prio_t prio)
+{
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if ((int)prio < 0 || prio >= I2CLCD_PRIO_COUNT) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    handle->compositor.prio = prio;
+    return i2clcd_stats_api(handle, I2CLCD_API_SET_PRIORITY, t0, I2CLCD_OK);
+}
+
+i2clcd_err_t i2clcd_priority_stats(i2clcd_t *handle, i2clcd_prio_t prio,
+                                   i2clcd_prio_stats_t *stats)
+{
+    const struct i2clcd_compositor *comp;
+    uint8_t row, col;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if ((int)prio < 0 || prio >= I2CLCD_PRIO_COUNT) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    comp = &handle->compositor;
+    *stats = comp->lanes[prio].stats;
+
+    /* Queue depth is whatever in this lane still differs from the glass */
+    stats->depth = 0;
+    if (comp->enabled) {
+        for (row = 0; row < handle->rows; row++) {
+            uint64_t changed = row_changed(handle, row);
+
+            for (col = 0; col < handle->cols; col++) {
+                if (cell_in_lane(handle, row, col, prio, changed)) {
+                    stats->depth++;
+                }
+            }
+        }
+    }
+
+    return I2CLCD_OK;
+}
@@ -0,0 +1,805 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * emulator.c - In-memory PCF8574/MCP230xx + HD44780 model backend
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+#include "hd44780.h"
+
+/*---------------------------------------------------------------------------
+ * Emulator State
+ *---------------------------------------------------------------------------*/
+
+/* PCF8574 0x20-0x27 and PCF8574A 0x38-0x3F */
+#define EMU_PEERS  16
+
+/* One HD44780; a 40x4 panel has two on the same bus */
+struct emu_lcd {
+    i2clcd_emu_state_t st;
+    uint8_t  high_nibble;  /* First half of a 4-bit transfer */
+    uint8_t  shift;        /* Display shift within each 40-cell line */
+};
+
+struct emu_backend {
+    struct i2clcd_backend base;
+    uint8_t  pins;         /* PCF8574 output latch */
+    bool     unplugged;    /* Every transfer is NACKed */
+    struct emu_lcd lcd[2]; /* Controllers; the second strobes on E2 */
+    unsigned int nlcd;     /* Controllers on the panel */
+    struct i2clcd_wiring wiring; /* Backpack pins to the logical layout */
+    i2clcd_expander_t expander;
+    uint8_t  data8;        /* D7-D0 from MCP23017 GPB */
+    uint8_t  reg;          /* MCP230xx register pointer */
+    uint8_t  mcp[MCP23017_NREGS]; /* MCP230xx registers, power-on layout */
+    uint8_t  buttons;      /* Plate buttons held down */
+    i2clcd_mux_t *mux;     /* TCA9548A ahead of the expander, or NULL */
+    uint8_t  mux_mask;     /* Mux channel the expander sits on */
+    uint8_t  addr;         /* Own I2C address */
+    struct emu_backend *peers[EMU_PEERS]; /* Other backpacks on the bus */
+    struct emu_backend *view; /* Backpack the i2clcd_emu_*() calls inspect */
+};
+
+/* Power-on reset: clear, 8-bit interface, display off, increment */
+static void emu_reset(struct emu_backend *emu)
+{
+    struct emu_lcd *lcd;
+    unsigned int i;
+
+    for (i = 0; i < emu->nlcd; i++) {
+        lcd = &emu->lcd[i];
+        memset(lcd, 0, sizeof(*lcd));
+        memset(lcd->st.ddram, ' ', sizeof(lcd->st.ddram));
+        lcd->st.entry_mode = HD44780_ENTRY_INC;
+        lcd->st.function_set = HD44780_CMD_FUNCTION_SET | HD44780_8BIT_MODE;
+    }
+    emu->pins = emu->wiring.to_logical[0xFF];
+
+    /* MCP230xx: all pins inputs (pulled high), sequential addressing */
+    memset(emu->mcp, 0, sizeof(emu->mcp));
+    emu->mcp[MCP23017_IODIRA] = 0xFF;
+    if (emu->expander != I2CLCD_EXPANDER_PCF8574 &&
+        emu->expander != I2CLCD_EXPANDER_MCP23008) {
+        emu->mcp[MCP23017_IODIRA + 1] = 0xFF;
+    }
+    emu->data8 = 0xFF;
+    emu->reg = 0;
+}
+
+/*---------------------------------------------------------------------------
+ * HD44780 Model
+ *---------------------------------------------------------------------------*/
+
+static void emu_advance(struct emu_lcd *lcd, bool inc)
+{
+    i2clcd_emu_state_t *st = &lcd->st;
+    bool two_line = (st->function_set & HD44780_2LINE) != 0;
+    uint8_t bank, off;
+
+    if (st->ac_cgram) {
+        st->ac = (uint8_t)((st->ac + (inc ? 1 : -1)) &
+                           (HD44780_CGRAM_SIZE - 1));
+        return;
+    }
+
+    if (!two_line) {
+        /* One 80-cell line */
+        st->ac = (uint8_t)((st->ac + (inc ? 1 : 79)) % 80);
+        return;
+    }
+
+    /* Two 40-cell lines at 0x00 and 0x40 */
+    bank = st->ac & HD44780_LINE1_ADDR;
+    off = st->ac & ~HD44780_LINE1_ADDR;
+    if (inc) {
+        if (++off == HD44780_DDRAM_LINE_LEN) {
+            off = 0;
+            bank ^= HD44780_LINE1_ADDR;
+        }
+    } else {
+        if (off-- == 0) {
+            off = HD44780_DDRAM_LINE_LEN - 1;
+            bank ^= HD44780_LINE1_ADDR;
+        }
+    }
+    st->ac = bank | off;
+}
+
+static void emu_shift(struct emu_lcd *lcd, bool left)
+{
+    uint8_t step = left ? 1 : HD44780_DDRAM_LINE_LEN - 1;
+
+    lcd->shift = (uint8_t)((lcd->shift + step) % HD44780_DDRAM_LINE_LEN);
+}
+
+static void emu_instruction(struct emu_lcd *lcd, uint8_t cmd)
+{
+    i2clcd_emu_state_t *st = &lcd->st;
+
+    st->instructions++;
+
+    if (cmd & HD44780_CMD_SET_DDRAM) {
+        st->ac = cmd & (HD44780_DDRAM_SIZE - 1);
+        st->ac_cgram = false;
+    } else if (cmd & HD44780_CMD_SET_CGRAM) {
+        st->ac = cmd & (HD44780_CGRAM_SIZE - 1);
+        st->ac_cgram = true;
+    } else if (cmd & HD44780_CMD_FUNCTION_SET) {
+        st->function_set = cmd;
+        st->four_bit = !(cmd & HD44780_8BIT_MODE);
+        st->nibble_pending = false;
+    } else if (cmd & HD44780_CMD_SHIFT) {
+        bool right = (cmd & 0x04) != 0;
+        if (cmd & 0x08) {
+            /* Display shift: right moves content right, so offset drops */
+            emu_shift(lcd, !right);
+        } else {
+            emu_advance(lcd, right);
+        }
+    } else if (cmd & HD44780_CMD_DISPLAY_CTRL) {
+        st->display_ctrl = cmd & 0x07;
+    } else if (cmd & HD44780_CMD_ENTRY_MODE) {
+        st->entry_mode = cmd & 0x03;
+    } else if (cmd & HD44780_CMD_HOME) {
+        st->ac = 0;
+        st->ac_cgram = false;
+        lcd->shift = 0;
+    } else if (cmd & HD44780_CMD_CLEAR) {
+        memset(st->ddram, ' ', sizeof(st->ddram));
+        st->ac = 0;
+        st->ac_cgram = false;
+        st->entry_mode |= HD44780_ENTRY_INC;
+        lcd->shift = 0;
+    }
+}
+
+static void emu_data(struct emu_lcd *lcd, uint8_t data)
+{
+    i2clcd_emu_state_t *st = &lcd->st;
+
+    st->data_writes++;
+
+    if (st->ac_cgram) {
+        st->cgram[st->ac] = data & 0x1F;
+    } else {
+        st->ddram[st->ac] = data;
+    }
+
+    emu_advance(lcd, (st->entry_mode & HD44780_ENTRY_INC) != 0);
+    if (!st->ac_cgram && (st->entry_mode & HD44780_ENTRY_SHIFT)) {
+        emu_shift(lcd, (st->entry_mode & HD44780_ENTRY_INC) != 0);
+    }
+}
+
+/* Enable falling edge: latch D7-D4 (D3-D0 are only wired on an MCP23017) */
+static void emu_strobe(struct emu_backend *emu, struct emu_lcd *lcd,
+                       uint8_t pins)
+{
+    i2clcd_emu_state_t *st = &lcd->st;
+    bool rs = (pins & PCF8574_PIN_RS) != 0;
+    uint8_t nibble = pins & PCF8574_DATA_MASK;
+    uint8_t byte;
+
+    if (emu->expander == I2CLCD_EXPANDER_MCP23017) {
+        nibble = emu->data8;
+    }
+
+    st->strobes++;
+
+    /* A read cycle ends; data reads move the address counter */
+    if (pins & PCF8574_PIN_RW) {
+        if (st->four_bit && !st->nibble_pending) {
+            st->nibble_pending = true;
+            return;
+        }
+        st->nibble_pending = false;
+        if (rs) {
+            st->data_reads++;
+            emu_advance(lcd, (st->entry_mode & HD44780_ENTRY_INC) != 0);
+        }
+        return;
+    }
+
+    if (!st->four_bit) {
+        byte = nibble;
+    } else if (!st->nibble_pending) {
+        lcd->high_nibble = nibble;
+        st->nibble_pending = true;
+        return;
+    } else {
+        byte = lcd->high_nibble | (nibble >> 4);
+        st->nibble_pending = false;
+    }
+
+    if (rs) {
+        emu_data(lcd, byte);
+    } else {
+        emu_instruction(lcd, byte);
+    }
+}
+
+/* New levels on the control pins (and D7-D4 on a 4-bit bus). On a 40x4
+ * panel the RW port is E2: RW itself is tied low, so both controllers
+ * only ever see writes. */
+static void emu_pins(struct emu_backend *emu, uint8_t level)
+{
+    uint8_t prev = emu->pins;
+    uint8_t pins = emu->wiring.to_logical[level];
+    unsigned int i;
+
+    emu->pins = pins;
+    for (i = 0; i < emu->nlcd; i++) {
+        emu->lcd[i].st.backlight = (pins & PCF8574_PIN_BL) != 0;
+    }
+
+    if (emu->nlcd < 2) {
+        if ((prev & PCF8574_PIN_EN) && !(pins & PCF8574_PIN_EN)) {
+            emu_strobe(emu, &emu->lcd[0], prev);
+        }
+        return;
+    }
+
+    if ((prev & PCF8574_PIN_EN) && !(pins & PCF8574_PIN_EN)) {
+        emu_strobe(emu, &emu->lcd[0], prev & (uint8_t)~PCF8574_PIN_RW);
+    }
+    if ((prev & PCF8574_PIN_RW) && !(pins & PCF8574_PIN_RW)) {
+        emu_strobe(emu, &emu->lcd[1], prev & (uint8_t)~PCF8574_PIN_RW);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * MCP230xx Model
+ *---------------------------------------------------------------------------*/
+
+static bool emu_wide(const struct emu_backend *emu)
+{
+    return emu->expander == I2CLCD_EXPANDER_MCP23017 ||
+           emu->expander == I2CLCD_EXPANDER_RGB_PLATE;
+}
+
+static bool emu_bank1(const struct emu_backend *emu)
+{
+    return emu_wide(emu) &&
+           (emu->mcp[MCP23017_IOCON] & MCP23017_IOCON_BANK) != 0;
+}
+
+/* Register file index (power-on layout) of a bus address, or -1 */
+static int mcp_index(const struct emu_backend *emu, uint8_t reg)
+{
+    if (!emu_wide(emu)) {
+        return reg < MCP23008_NREGS ? reg : -1;
+    }
+    if (emu_bank1(emu)) {
+        if ((reg & 0x0F) >= MCP23017_NREGS / 2 || reg >= 0x20) {
+            return -1;
+        }
+        return (reg & 0x0F) * 2 + (reg >> 4);
+    }
+    return reg < MCP23017_NREGS ? reg : -1;
+}
+
+/* Pin level of one port: output latch where driven, inputs elsewhere
+ * (pulled high unless a plate button holds them low) */
+static uint8_t mcp_level(const struct emu_backend *emu, unsigned int port)
+{
+    uint8_t olat = emu->mcp[emu_wide(emu) ? MCP23017_OLATA + port :
+                                            MCP23008_OLAT];
+    uint8_t iodir = emu->mcp[port];
+    uint8_t in = 0xFF;
+
+    if (emu->expander == I2CLCD_EXPANDER_RGB_PLATE && port == 0) {
+        in = (uint8_t)~emu->buttons;
+    }
+    return (uint8_t)((olat & ~iodir) | (in & iodir));
+}
+
+static uint8_t mcp_next(const struct emu_backend *emu, uint8_t reg)
+{
+    bool seqop = (emu->mcp[emu_wide(emu) ? MCP23017_IOCON : MCP23008_IOCON] &
+                  MCP230XX_IOCON_SEQOP) != 0;
+
+    if (!emu_wide(emu)) {
+        return seqop ? reg : (uint8_t)((reg + 1) % MCP23008_NREGS);
+    }
+    if (emu_bank1(emu)) {
+        if (seqop) {
+            return reg;
+        }
+        reg++;
+        return mcp_index(emu, reg) < 0 ? (uint8_t)((reg & 0x10) ^ 0x10) : reg;
+    }
+    return seqop ? (uint8_t)(reg ^ 1) : (uint8_t)((reg + 1) % MCP23017_NREGS);
+}
+
+static void mcp_store(struct emu_backend *emu, uint8_t reg, uint8_t value)
+{
+    unsigned int port = reg & 1;
+
+    if (!emu_wide(emu)) {
+        if (reg == MCP23008_GPIO) {
+            reg = MCP23008_OLAT;
+        }
+        emu->mcp[reg] = value;
+        if (reg == MCP23008_OLAT || reg == MCP23008_IODIR) {
+            emu_pins(emu, mcp_level(emu, 0));
+        }
+        return;
+    }
+
+    /* GPIO writes land in the output latch; IOCON is mirrored */
+    if (reg == MCP23017_GPIOA + port) {
+        reg = (uint8_t)(MCP23017_OLATA + port);
+    }
+    if ((reg & ~1) == MCP23017_IOCON) {
+        emu->mcp[MCP23017_IOCON] = emu->mcp[MCP23017_IOCON + 1] = value;
+        return;
+    }
+    emu->mcp[reg] = value;
+
+    if (reg != MCP23017_OLATA + port && reg != MCP23017_IODIRA + port) {
+        return;
+    }
+
+    /* The plate has the LCD on GPB; the 8-bit wiring has control on GPA */
+    if (emu->expander == I2CLCD_EXPANDER_RGB_PLATE) {
+        if (port) {
+            emu_pins(emu, mcp_level(emu, 1));
+        }
+    } else if (port) {
+        emu->data8 = mcp_level(emu, 1);
+    } else {
+        emu_pins(emu, mcp_level(emu, 0));
+    }
+}
+
+static uint8_t mcp_load(const struct emu_backend *emu, uint8_t reg)
+{
+    if (!emu_wide(emu)) {
+        return reg == MCP23008_GPIO ? mcp_level(emu, 0) : emu->mcp[reg];
+    }
+    if ((reg & ~1) == MCP23017_GPIOA) {
+        return mcp_level(emu, reg & 1);
+    }
+    return emu->mcp[reg];
+}
+
+/* Lit channels: the plate's red and green sit on GPA, blue is the LCD
+ * port's backlight pin */
+static uint8_t emu_color(const struct emu_backend *emu)
+{
+    uint8_t color, gpa;
+
+    if (emu->expander != I2CLCD_EXPANDER_RGB_PLATE) {
+        return emu->lcd[0].st.backlight ? I2CLCD_COLOR_WHITE : 0;
+    }
+
+    gpa = mcp_level(emu, 0);
+    color = emu->lcd[0].st.backlight ? I2CLCD_COLOR_BLUE : 0;
+    if (!(gpa & PLATE_RED)) {
+        color |= I2CLCD_COLOR_RED;
+    }
+    if (!(gpa & PLATE_GREEN)) {
+        color |= I2CLCD_COLOR_GREEN;
+    }
+    return color;
+}
+
+/*---------------------------------------------------------------------------
+ * Backend Operations
+ *---------------------------------------------------------------------------*/
+
+/* Behind a mux, the expander only answers while its channel is open */
+static bool emu_absent(const struct emu_backend *emu)
+{
+    return emu->unplugged ||
+           (emu->mux && !(emu->mux->emu_reg & emu->mux_mask));
+}
+
+static int emu_write(struct i2clcd_backend *be, const uint8_t *buf, size_t len)
+{
+    struct emu_backend *emu = (struct emu_backend *)be;
+    int idx;
+    size_t i;
+
+    if (emu_absent(emu)) {
+        errno = ENXIO;
+        return -1;
+    }
+
+    if (emu->expander == I2CLCD_EXPANDER_PCF8574) {
+        for (i = 0; i < len; i++) {
+            emu_pins(emu, buf[i]);
+        }
+        return 0;
+    }
+
+    /* Register address, then data for consecutive registers */
+    if (len == 0 || mcp_index(emu, buf[0]) < 0) {
+        errno = EIO;
+        return -1;
+    }
+    emu->reg = buf[0];
+    for (i = 1; i < len; i++) {
+        /* A BANK switch can leave the pointer outside the new layout */
+        idx = mcp_index(emu, emu->reg);
+        if (idx < 0) {
+            errno = EIO;
+            return -1;
+        }
+        mcp_store(emu, (uint8_t)idx, buf[i]);
+        emu->reg = mcp_next(emu, emu->reg);
+    }
+
+    return 0;
+}
+
+/* Level on D7-D4 while the controller drives them during a read */
+static uint8_t emu_drive(const struct emu_backend *emu)
+{
+    const i2clcd_emu_state_t *st = &emu->lcd[0].st;
+    uint8_t byte;
+
+    if (emu->pins & PCF8574_PIN_RS) {
+        byte = st->ac_cgram ? st->cgram[st->ac] : st->ddram[st->ac];
+    } else {
+        byte = st->ac;     /* Busy flag is always clear */
+    }
+
+    if (st->four_bit && st->nibble_pending) {
+        byte = (uint8_t)(byte << 4);
+    }
+    return byte & PCF8574_DATA_MASK;
+}
+
+static int emu_read(struct i2clcd_backend *be, uint8_t *buf, size_t len)
+{
+    struct emu_backend *emu = (struct emu_backend *)be;
+    uint8_t pins = emu->pins;
+
+    if (emu_absent(emu)) {
+        errno = ENXIO;
+        return -1;
+    }
+
+    if (emu->expander != I2CLCD_EXPANDER_PCF8574) {
+        size_t i;
+        int idx;
+
+        for (i = 0; i < len; i++) {
+            idx = mcp_index(emu, emu->reg);
+            buf[i] = idx < 0 ? 0xFF : mcp_load(emu, (uint8_t)idx);
+            emu->reg = mcp_next(emu, emu->reg);
+        }
+        return 0;
+    }
+
+    /* Quasi-bidirectional pins: released (high) data pins follow the LCD
+     * (on a 40x4 panel RW is E2, so the controllers never drive them) */
+    if (emu->nlcd < 2 && (pins & PCF8574_PIN_RW) && (pins & PCF8574_PIN_EN)) {
+        pins &= (uint8_t)(emu_drive(emu) | ~PCF8574_DATA_MASK);
+    }
+
+    memset(buf, emu->wiring.to_physical[pins], len);
+    return 0;
+}
+
+/* The backpack at an address, made like this one on first use */
+static struct emu_backend *emu_peer(struct emu_backend *emu, uint8_t addr)
+{
+    struct emu_backend *peer;
+    int idx;
+
+    if (addr == emu->addr) {
+        return emu;
+    }
+
+    if (addr >= 0x20 && addr <= 0x27) {
+        idx = addr - 0x20;
+    } else if (addr >= 0x38 && addr <= 0x3F) {
+        idx = addr - 0x38 + 8;
+    } else {
+        return NULL;
+    }
+
+    if (!emu->peers[idx]) {
+        peer = calloc(1, sizeof(*peer));
+        if (!peer) {
+            return NULL;
+        }
+        peer->base.ops = emu->base.ops;
+        peer->wiring = emu->wiring;
+        peer->expander = emu->expander;
+        peer->nlcd = emu->nlcd;
+        peer->mux = emu->mux;
+        peer->mux_mask = emu->mux_mask;
+        peer->addr = addr;
+        emu_reset(peer);
+        emu->peers[idx] = peer;
+    }
+    return emu->peers[idx];
+}
+
+static int emu_write_to(struct i2clcd_backend *be, uint8_t addr,
+                        const uint8_t *buf, size_t len)
+{
+    struct emu_backend *emu = (struct emu_backend *)be;
+    struct emu_backend *peer;
+
+    /* The mux control register takes the last byte written */
+    if (emu->mux && addr == emu->mux->addr) {
+        if (len > 0) {
+            emu->mux->emu_reg = buf[len - 1];
+        }
+        return 0;
+    }
+
+    peer = emu_peer(emu, addr);
+    if (!peer) {
+        errno = ENXIO;
+        return -1;
+    }
+    return emu_write(&peer->base, buf, len);
+}
+
+/* Like I2C_RDWR, the transfer stops at the first NACK; the count of
+ * messages sent before it is what an adapter with short counts reports */
+static int emu_write_many(struct i2clcd_backend *be, const uint8_t *addrs,
+                          size_t naddrs, const uint8_t *buf, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < naddrs; i++) {
+        if (emu_write_to(be, addrs[i], buf, len) < 0) {
+            return (int)i;
+        }
+    }
+    return (int)naddrs;
+}
+
+static void emu_destroy(struct i2clcd_backend *be)
+{
+    struct emu_backend *emu = (struct emu_backend *)be;
+    unsigned int i;
+
+    for (i = 0; i < EMU_PEERS; i++) {
+        free(emu->peers[i]);
+    }
+    free(emu);
+}
+
+static const struct i2clcd_backend_ops emu_ops = {
+    .name    = "emulator",
+    .write   = emu_write,
+    .read    = emu_read,
+    .write_to = emu_write_to,
+    .write_many = emu_write_many,
+    .destroy = emu_destroy,
+};
+
+i2clcd_err_t i2clcd_backend_emu_create(const i2clcd_config_t *config,
+                                       struct i2clcd_backend **be)
+{
+    struct emu_backend *emu;
+
+    emu = calloc(1, sizeof(*emu));
+    if (!emu) {
+        return I2CLCD_ERR_NOMEM;
+    }
+
+    if (i2clcd_wiring_build(&emu->wiring, i2clcd_config_pinmap(config)) < 0) {
+        free(emu);
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    emu->base.ops = &emu_ops;
+    emu->expander = config->expander;
+    emu->nlcd = config->size == I2CLCD_40X4 ? 2 : 1;
+    emu->mux = config->mux;
+    emu->mux_mask = (uint8_t)(1u << (config->mux_channel & 7));
+    emu->addr = config->i2c_addr;
+    emu_reset(emu);
+
+    *be = &emu->base;
+    return I2CLCD_OK;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+static struct emu_backend *find_emu(i2clcd_t *handle)
+{
+    struct emu_backend *emu;
+
+    emu = (struct emu_backend *)i2clcd_backend_find(handle, &emu_ops);
+    return (emu && emu->view) ? emu->view : emu;
+}
+
+i2clcd_err_t i2clcd_emu_state(i2clcd_t *handle, i2clcd_emu_state_t *state)
+{
+    struct emu_backend *emu;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!state) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    emu = find_emu(handle);
+    if (!emu) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    *state = emu->lcd[0].st;
+    state->color = emu_color(emu);
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_emu_controller(i2clcd_t *handle, uint8_t ctrl,
+                                   i2clcd_emu_state_t *state)
+{
+    struct emu_backend *emu;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!state) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    emu = find_emu(handle);
+    if (!emu) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    if (ctrl >= emu->nlcd) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    *state = emu->lcd[ctrl].st;
+    state->color = emu_color(emu);
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_emu_line(i2clcd_t *handle, uint8_t line,
+                             char *buf, size_t size)
+{
+    struct emu_backend *emu;
+    const struct emu_lcd *lcd;
+    uint8_t base, off, c;
+    size_t i;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!buf || size == 0) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (line >= handle->rows) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    emu = find_emu(handle);
+    if (!emu) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    lcd = &emu->lcd[handle->line_ctrl[line]];
+    base = handle->line_addr[line] & HD44780_LINE1_ADDR;
+    for (i = 0; i < handle->cols && i + 1 < size; i++) {
+        off = (uint8_t)(((handle->line_addr[line] & ~HD44780_LINE1_ADDR) +
+                         i + lcd->shift) % HD44780_DDRAM_LINE_LEN);
+        c = lcd->st.ddram[base | off];
+
+        if (!(lcd->st.display_ctrl & HD44780_DISPLAY_ON)) {
+            c = ' ';
+        } else if (c == 0) {
+            /* CGRAM slot 0 is reported as its alias so the string ends */
+            c = 0x08;
+        }
+        buf[i] = (char)c;
+    }
+    buf[i] = '\0';
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_emu_power(i2clcd_t *handle, bool on)
+{
+    struct emu_backend *emu;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    emu = find_emu(handle);
+    if (!emu) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    if (on) {
+        emu_reset(emu);
+    }
+    emu->unplugged = !on;
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_emu_glitch(i2clcd_t *handle, bool cgram, uint8_t addr,
+                               uint8_t value)
+{
+    struct emu_backend *emu;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (addr >= (cgram ? HD44780_CGRAM_SIZE : HD44780_DDRAM_SIZE)) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    emu = find_emu(handle);
+    if (!emu) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    if (cgram) {
+        emu->lcd[0].st.cgram[addr] = value;
+    } else {
+        emu->lcd[0].st.ddram[addr] = value;
+    }
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_emu_buttons(i2clcd_t *handle, uint8_t pressed)
+{
+    struct emu_backend *emu;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    emu = find_emu(handle);
+    if (!emu) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    emu->buttons = pressed & PLATE_BUTTONS;
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_emu_view(i2clcd_t *handle, uint8_t addr)
+{
+    struct emu_backend *emu, *peer;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    emu = (struct emu_backend *)i2clcd_backend_find(handle, &emu_ops);
+    if (!emu) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    peer = emu_peer(emu, addr);
+    if (!peer) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    emu->view = (peer == emu) ? NULL : peer;
+    return I2CLCD_OK;
+}
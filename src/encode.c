@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * encode.c - Bulk PCF8574 encoding and buffer diffing
+ *
+ * Rows of cells are expanded 16 at a time with SSE2 (x86-64) or NEON
+ * (arm64) when the data pins are four consecutive ports, which covers the
+ * built-in pin maps. Other wirings, other targets and row tails use the
+ * per-byte tables in struct i2clcd_wiring. The 8-bit encoder only
+ * interleaves bytes with fixed control values, so it is always vectorized.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ENCODE_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ENCODE_NEON 1
+#endif
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * Encoder
+ *---------------------------------------------------------------------------*/
+
+#if defined(ENCODE_SSE2)
+
+static size_t encode_simd(const struct i2clcd_wiring *w, uint8_t ctl,
+                          const uint8_t *src, size_t n, uint8_t *out)
+{
+    const __m128i mask = _mm_set1_epi8((char)w->data);
+    const __m128i low = _mm_set1_epi8(0x0F);
+    const __m128i c = _mm_set1_epi8((char)ctl);
+    const __m128i en = _mm_set1_epi8((char)w->en);
+    const __m128i hshift = _mm_cvtsi32_si128(4 - w->data_shift);
+    const __m128i lshift = _mm_cvtsi32_si128(w->data_shift);
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16, out += 64) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i hi, lo, a, b;
+
+        /* 16-bit shifts; the mask drops bits from the neighboring byte */
+        hi = _mm_or_si128(_mm_and_si128(_mm_srl_epi16(x, hshift), mask), c);
+        lo = _mm_or_si128(_mm_sll_epi16(_mm_and_si128(x, low), lshift), c);
+
+        /* Interleave to EN-high/EN-low pairs, then pairs to 4-byte groups */
+        a = _mm_unpacklo_epi8(_mm_or_si128(hi, en), hi);
+        b = _mm_unpacklo_epi8(_mm_or_si128(lo, en), lo);
+        _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(a, b));
+        _mm_storeu_si128((__m128i *)(out + 16), _mm_unpackhi_epi16(a, b));
+
+        a = _mm_unpackhi_epi8(_mm_or_si128(hi, en), hi);
+        b = _mm_unpackhi_epi8(_mm_or_si128(lo, en), lo);
+        _mm_storeu_si128((__m128i *)(out + 32), _mm_unpacklo_epi16(a, b));
+        _mm_storeu_si128((__m128i *)(out + 48), _mm_unpackhi_epi16(a, b));
+    }
+
+    return i;
+}
+
+#elif defined(ENCODE_NEON)
+
+static size_t encode_simd(const struct i2clcd_wiring *w, uint8_t ctl,
+                          const uint8_t *src, size_t n, uint8_t *out)
+{
+    const int8x16_t hshift = vdupq_n_s8((int8_t)(w->data_shift - 4));
+    const int8x16_t lshift = vdupq_n_s8((int8_t)w->data_shift);
+    const uint8x16_t mask = vdupq_n_u8(w->data);
+    const uint8x16_t low = vdupq_n_u8(0x0F);
+    const uint8x16_t c = vdupq_n_u8(ctl);
+    const uint8x16_t en = vdupq_n_u8(w->en);
+    uint8x16x4_t v;
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16, out += 64) {
+        uint8x16_t x = vld1q_u8(src + i);
+
+        /* Negative shift counts shift right */
+        v.val[1] = vorrq_u8(vandq_u8(vshlq_u8(x, hshift), mask), c);
+        v.val[3] = vorrq_u8(vshlq_u8(vandq_u8(x, low), lshift), c);
+        v.val[0] = vorrq_u8(v.val[1], en);
+        v.val[2] = vorrq_u8(v.val[3], en);
+
+        /* The interleaving store writes 4-byte groups directly */
+        vst4q_u8(out, v);
+    }
+
+    return i;
+}
+
+#endif
+
+#if defined(ENCODE_SSE2)
+
+static size_t encode8_simd(uint8_t ctl, uint8_t en, const uint8_t *src,
+                           size_t n, uint8_t *out)
+{
+    const __m128i c = _mm_set1_epi8((char)ctl);
+    const __m128i ce = _mm_set1_epi8((char)(ctl | en));
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16, out += 64) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i a, b;
+
+        a = _mm_unpacklo_epi8(ce, x);
+        b = _mm_unpacklo_epi8(c, x);
+        _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(a, b));
+        _mm_storeu_si128((__m128i *)(out + 16), _mm_unpackhi_epi16(a, b));
+
+        a = _mm_unpackhi_epi8(ce, x);
+        b = _mm_unpackhi_epi8(c, x);
+        _mm_storeu_si128((__m128i *)(out + 32), _mm_unpacklo_epi16(a, b));
+        _mm_storeu_si128((__m128i *)(out + 48), _mm_unpackhi_epi16(a, b));
+    }
+
+    return i;
+}
+
+#elif defined(ENCODE_NEON)
+
+static size_t encode8_simd(uint8_t ctl, uint8_t en, const uint8_t *src,
+                           size_t n, uint8_t *out)
+{
+    uint8x16x4_t v;
+    size_t i;
+
+    v.val[0] = vdupq_n_u8((uint8_t)(ctl | en));
+    v.val[2] = vdupq_n_u8(ctl);
+
+    for (i = 0; i + 16 <= n; i += 16, out += 64) {
+        v.val[1] = vld1q_u8(src + i);
+        v.val[3] = v.val[1];
+        vst4q_u8(out, v);
+    }
+
+    return i;
+}
+
+#endif
+
+void i2clcd_encode8(const struct i2clcd_wiring *w, bool rs, bool backlight,
+                    const uint8_t *src, size_t n, uint8_t *out)
+{
+    uint8_t ctl = (uint8_t)((rs ? w->rs : 0) | w->bl[backlight]);
+    size_t i = 0;
+
+    /* Control port with EN high, data port; control with EN low, data */
+#if defined(ENCODE_SSE2) || defined(ENCODE_NEON)
+    i = encode8_simd(ctl, w->en, src, n, out);
+#endif
+
+    for (; i < n; i++) {
+        out[4 * i] = ctl | w->en;
+        out[4 * i + 1] = src[i];
+        out[4 * i + 2] = ctl;
+        out[4 * i + 3] = src[i];
+    }
+}
+
+void i2clcd_encode(const struct i2clcd_wiring *w, bool rs, bool backlight,
+                   const uint8_t *src, size_t n, uint8_t *out)
+{
+    const uint8_t (*table)[4] = w->encode[rs][backlight];
+    size_t i = 0;
+
+#if defined(ENCODE_SSE2) || defined(ENCODE_NEON)
+    if (w->data_shift >= 0) {
+        i = encode_simd(w, (uint8_t)((rs ? w->rs : 0) | w->bl[backlight]),
+                        src, n, out);
+    }
+#endif
+
+    for (; i < n; i++) {
+        memcpy(out + 4 * i, table[src[i]], 4);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * Diff
+ *---------------------------------------------------------------------------*/
+
+uint64_t i2clcd_diff_mask(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    uint64_t mask = 0;
+    size_t i = 0;
+
+#if defined(ENCODE_SSE2)
+    for (; i + 16 <= n; i += 16) {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)),
+                                    _mm_loadu_si128((const __m128i *)(b + i)));
+
+        mask |= (uint64_t)(~_mm_movemask_epi8(eq) & 0xFFFF) << i;
+    }
+#elif defined(ENCODE_NEON)
+    static const uint8_t weight[16] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128,
+    };
+    const uint8x16_t wv = vld1q_u8(weight);
+
+    /* No movemask: weight each differing lane by its bit and add */
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t ne = vmvnq_u8(vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+        uint8x16_t bits = vandq_u8(ne, wv);
+
+        mask |= ((uint64_t)vaddv_u8(vget_low_u8(bits)) |
+                 (uint64_t)vaddv_u8(vget_high_u8(bits)) << 8) << i;
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (a[i] != b[i]) {
+            mask |= (uint64_t)1 << i;
+        }
+    }
+
+    return mask;
+}
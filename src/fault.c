@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * fault.c - Fault-injection backend layer for recovery testing
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * Fault Layer
+ *---------------------------------------------------------------------------*/
+
+struct fault_backend {
+    struct i2clcd_backend base;
+    i2clcd_t *ctx;         /* Handle whose clock times latency spikes */
+    i2clcd_fault_config_t cfg;
+    i2clcd_fault_stats_t  stats;
+    uint32_t rng[2];       /* xorshift32 state: normal, recovery traffic */
+    uint64_t run;          /* Recovery run rng[1] was seeded for (1-based) */
+    uint8_t  buf[I2CLCD_TX_BUF_SIZE];
+};
+
+/*
+ * Each recovery run draws from its own stream, seeded from the run's index.
+ * The faults the application's transactions see, and the faults at the
+ * n-th transaction of the k-th recovery, then do not depend on how long
+ * earlier replays were.
+ */
+static uint32_t fault_rand(struct fault_backend *fb)
+{
+    uint32_t *rng = &fb->rng[0];
+    uint32_t x;
+
+    if (fb->ctx->recovering) {
+        rng = &fb->rng[1];
+        if (fb->run != fb->ctx->stats.recoveries + 1) {
+            fb->run = fb->ctx->stats.recoveries + 1;
+            *rng = (fb->cfg.seed ^ (uint32_t)fb->run * 0x9E3779B9u) | 1;
+        }
+    }
+
+    x = *rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *rng = x;
+    return x;
+}
+
+static bool fault_hit(struct fault_backend *fb, uint32_t ppm)
+{
+    return ppm > 0 && fault_rand(fb) % 1000000 < ppm;
+}
+
+/* Fail the whole transaction before anything reaches the device */
+static int fault_fail(uint64_t *counter, int err)
+{
+    (*counter)++;
+    errno = err;
+    return -1;
+}
+
+static int fault_write(struct i2clcd_backend *be, const uint8_t *buf,
+                       size_t len)
+{
+    struct fault_backend *fb = (struct fault_backend *)be;
+    struct i2clcd_backend *inner = be->inner;
+    size_t i, part, step;
+    uint8_t en;
+
+    fb->stats.xfers++;
+
+    if (fault_hit(fb, fb->cfg.spike_ppm)) {
+        fb->stats.spikes++;
+        i2clcd_sleep_until_ns(fb->ctx, i2clcd_monotonic_ns(fb->ctx) +
+                              (uint64_t)fb->cfg.spike_us * 1000);
+    }
+
+    if (fault_hit(fb, fb->cfg.nack_ppm)) {
+        return fault_fail(&fb->stats.nacks, ENXIO);
+    }
+    if (fault_hit(fb, fb->cfg.eremoteio_ppm)) {
+        return fault_fail(&fb->stats.eremoteio, EREMOTEIO);
+    }
+    if (fault_hit(fb, fb->cfg.etimedout_ppm)) {
+        return fault_fail(&fb->stats.etimedout, ETIMEDOUT);
+    }
+
+    if (len > 1 && fault_hit(fb, fb->cfg.short_ppm)) {
+        fb->stats.short_writes++;
+        part = 1 + fault_rand(fb) % (len - 1);
+        inner->ops->write(inner, buf, part);
+        errno = EIO;
+        return -1;
+    }
+
+    if (fb->cfg.drop_nibble_ppm == 0 || len > sizeof(fb->buf)) {
+        return inner->ops->write(inner, buf, len);
+    }
+
+    /* A lost enable pulse: the controller never latches that nibble (on a
+     * 40x4 panel E2 is the RW pin). An 8-bit bus sends control/data port
+     * pairs; only the control byte carries EN, and the same bit of the
+     * data byte is a data line. */
+    en = fb->ctx->wiring.en;
+    if (fb->ctx->ctrls > 1) {
+        en |= fb->ctx->wiring.rw;
+    }
+    step = fb->ctx->eight_bit ? 2 : 1;
+    memcpy(fb->buf, buf, len);
+    for (i = 0; i < len; i += step) {
+        if ((fb->buf[i] & en) && fault_hit(fb, fb->cfg.drop_nibble_ppm)) {
+            fb->buf[i] &= (uint8_t)~en;
+            fb->stats.dropped_nibbles++;
+        }
+    }
+
+    return inner->ops->write(inner, fb->buf, len);
+}
+
+static int fault_read(struct i2clcd_backend *be, uint8_t *buf, size_t len)
+{
+    struct fault_backend *fb = (struct fault_backend *)be;
+
+    fb->stats.xfers++;
+
+    if (fault_hit(fb, fb->cfg.nack_ppm)) {
+        return fault_fail(&fb->stats.nacks, ENXIO);
+    }
+    if (fault_hit(fb, fb->cfg.etimedout_ppm)) {
+        return fault_fail(&fb->stats.etimedout, ETIMEDOUT);
+    }
+
+    return be->inner->ops->read(be->inner, buf, len);
+}
+
+static void fault_destroy(struct i2clcd_backend *be)
+{
+    free(be);
+}
+
+static const struct i2clcd_backend_ops fault_ops = {
+    .name    = "fault",
+    .write   = fault_write,
+    .read    = fault_read,
+    .destroy = fault_destroy,
+};
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_fault_start(i2clcd_t *handle,
+                                const i2clcd_fault_config_t *config)
+{
+    struct fault_backend *fb;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!config) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    fb = (struct fault_backend *)i2clcd_backend_find(handle, &fault_ops);
+    if (!fb) {
+        fb = calloc(1, sizeof(*fb));
+        if (!fb) {
+            return I2CLCD_ERR_NOMEM;
+        }
+        fb->base.ops = &fault_ops;
+        fb->ctx = handle;
+        i2clcd_backend_push(handle, &fb->base);
+    }
+
+    fb->cfg = *config;
+    fb->rng[0] = config->seed ? config->seed : 1;
+    fb->run = 0;
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_fault_stop(i2clcd_t *handle)
+{
+    struct i2clcd_backend *be;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    be = i2clcd_backend_find(handle, &fault_ops);
+    if (!be) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    i2clcd_backend_remove(handle, be);
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_fault_stats(i2clcd_t *handle,
+                                i2clcd_fault_stats_t *stats)
+{
+    struct fault_backend *fb;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    fb = (struct fault_backend *)i2clcd_backend_find(handle, &fault_ops);
+    if (!fb) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    *stats = fb->stats;
+    return I2CLCD_OK;
+}
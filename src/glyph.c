@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * glyph.c - CGRAM glyph cache with least-recently-used slot allocation
+ *
+ * The cache keeps no bitmaps of its own: the CGRAM shadow is the truth,
+ * and a slot's hash only narrows the search. A hit is confirmed against
+ * every controller's shadow, so a slot rewritten by i2clcd_create_char()
+ * or lost to a reset is never reported as holding the old glyph. A slot
+ * whose code shows in any known cell, on the panel or in the compositor
+ * back buffer, is never evicted: rewriting it would change the screen.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * Slot Selection
+ *---------------------------------------------------------------------------*/
+
+/* FNV-1a over the eight pattern rows */
+static uint32_t glyph_hash(const uint8_t charmap[8])
+{
+    uint32_t h = 2166136261u;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        h = (h ^ charmap[i]) * 16777619u;
+    }
+    return h;
+}
+
+/* Codes 0x00-0x0F show CGRAM; 0x08-0x0F alias slots 0-7 */
+static void mark_code(uint8_t *shown, uint8_t code)
+{
+    if (code < 2 * I2CLCD_GLYPH_SLOTS) {
+        *shown |= (uint8_t)(1u << (code & (I2CLCD_GLYPH_SLOTS - 1)));
+    }
+}
+
+/* Slots some visible cell shows now or after the next flush */
+static uint8_t slots_shown(const i2clcd_t *ctx)
+{
+    const struct i2clcd_shadow *sh;
+    uint8_t shown = 0;
+    uint8_t row, col, addr;
+
+    for (row = 0; row < ctx->rows; row++) {
+        sh = i2clcd_line_shadow(ctx, row);
+        for (col = 0; col < ctx->cols; col++) {
+            addr = (uint8_t)(ctx->line_addr[row] + col);
+            if ((sh->ddram_valid[addr >> 3] >> (addr & 7)) & 1) {
+                mark_code(&shown, sh->ddram[addr]);
+            }
+            if (ctx->compositor.enabled) {
+                mark_code(&shown, ctx->compositor.back[row][col]);
+            }
+        }
+    }
+    return shown;
+}
+
+static int find_cached(i2clcd_t *ctx, uint32_t hash, const uint8_t charmap[8])
+{
+    const struct i2clcd_glyphs *g = &ctx->glyphs;
+    int i;
+
+    /* Slots never requested may still hold it from i2clcd_create_char();
+     * an animated slot only holds it until its next frame */
+    for (i = 0; i < I2CLCD_GLYPH_SLOTS; i++) {
+        if (((ctx->anim.active >> i) & 1) == 0 &&
+            (g->hash[i] == hash || g->used[i] == 0) &&
+            i2clcd_cgram_holds(ctx, (uint8_t)i, charmap)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Least recently requested slot neither on screen nor animated, or -1 */
+static int find_victim(const i2clcd_t *ctx)
+{
+    const struct i2clcd_glyphs *g = &ctx->glyphs;
+    uint8_t taken = slots_shown(ctx) | ctx->anim.active;
+    int i, victim = -1;
+
+    for (i = 0; i < I2CLCD_GLYPH_SLOTS; i++) {
+        if ((taken >> i) & 1) {
+            continue;
+        }
+        if (victim < 0 || g->used[i] < g->used[victim]) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+/* Slot holding the pattern, uploading it on a miss */
+static i2clcd_err_t glyph_get(i2clcd_t *handle, const uint8_t charmap[8],
+                              uint8_t *slot)
+{
+    struct i2clcd_glyphs *g;
+    uint32_t hash;
+    i2clcd_err_t err;
+    int i;
+
+    g = &handle->glyphs;
+    hash = glyph_hash(charmap);
+
+    i = find_cached(handle, hash, charmap);
+    if (i >= 0) {
+        g->hash[i] = hash;
+        g->used[i] = ++g->tick;
+        g->stats.hits++;
+        *slot = (uint8_t)i;
+        return I2CLCD_OK;
+    }
+
+    i = find_victim(handle);
+    if (i < 0) {
+        g->stats.full++;
+        return I2CLCD_ERR_RANGE;
+    }
+
+    err = i2clcd_create_char(handle, (uint8_t)i, charmap);
+    if (err != I2CLCD_OK) {
+        /* The slot may hold part of the pattern */
+        g->used[i] = 0;
+        return err;
+    }
+
+    if (g->used[i] != 0) {
+        g->stats.evictions++;
+    }
+    g->hash[i] = hash;
+    g->used[i] = ++g->tick;
+    g->stats.misses++;
+    *slot = (uint8_t)i;
+    return I2CLCD_OK;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_glyph(i2clcd_t *handle, const uint8_t charmap[8],
+                          uint8_t *slot)
+{
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!charmap || !slot) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    return i2clcd_stats_api(handle, I2CLCD_API_GLYPH, t0,
+                            glyph_get(handle, charmap, slot));
+}
+
+i2clcd_err_t i2clcd_glyph_stats(i2clcd_t *handle, i2clcd_glyph_stats_t *stats)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    *stats = handle->glyphs.stats;
+    return I2CLCD_OK;
+}
@@ -49,6 +49,17 @@
 #define HD44780_LINE2_ADDR          0x14  /* For 20x4 displays */
 #define HD44780_LINE3_ADDR          0x54  /* For 20x4 displays */
 
+/*---------------------------------------------------------------------------
+ * Controller Memory
+ *---------------------------------------------------------------------------*/
+
+#define HD44780_DDRAM_SIZE          0x80  /* Addressable DDRAM range */
+#define HD44780_CGRAM_SIZE          0x40  /* 8 glyphs x 8 rows */
+#define HD44780_DDRAM_LINE_LEN      0x28  /* 40 cells per line (2-line mode) */
+
+/* Cell exists in 2-line mode (0x00-0x27 and 0x40-0x67) */
+#define HD44780_DDRAM_EXISTS(addr)  (((addr) & 0x3F) < HD44780_DDRAM_LINE_LEN)
+
 /*---------------------------------------------------------------------------
  * Timing Constants (in microseconds)
  *---------------------------------------------------------------------------*/
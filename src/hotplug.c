@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * hotplug.c - Disconnect and brown-out detection with state restore
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*
+ * The library never leaves EN or RW high between transactions. After a
+ * power-on reset the PCF8574 latch is all ones, so either pin reading back
+ * high means the panel lost power since the last write.
+ */
+#define HOTPLUG_IDLE_LOW    (PCF8574_PIN_EN | PCF8574_PIN_RW)
+
+static void notify(i2clcd_t *ctx, i2clcd_link_event_t event)
+{
+    if (ctx->hotplug.callback) {
+        ctx->hotplug.callback(ctx, event, ctx->hotplug.user);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+void i2clcd_link_lost(i2clcd_t *ctx)
+{
+    if (ctx->link_down) {
+        return;
+    }
+
+    ctx->link_down = true;
+    ctx->nack_count = 0;
+    ctx->stats.disconnects++;
+
+    /* The restore re-initializes the controller from scratch */
+    ctx->resync_pending = false;
+
+    notify(ctx, I2CLCD_LINK_LOST);
+}
+
+/* Re-initialize and replay; the link stays down if the device drops again */
+static int restore(i2clcd_t *ctx, i2clcd_link_event_t event)
+{
+    bool was_down = ctx->link_down;
+
+    ctx->link_down = false;
+    if (i2clcd_recovery_run(ctx, true) < 0) {
+        if (was_down || ctx->link_down) {
+            ctx->link_down = true;
+        } else {
+            i2clcd_link_lost(ctx);
+        }
+        return -1;
+    }
+
+    ctx->stats.reconnects++;
+    notify(ctx, event);
+    return 0;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_set_hotplug(i2clcd_t *handle,
+                                const i2clcd_hotplug_config_t *config)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!config) {
+        handle->hotplug_on = false;
+        handle->link_down = false;
+        return I2CLCD_OK;
+    }
+
+    if (config->nack_streak == 0) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    handle->hotplug = *config;
+    handle->hotplug_on = true;
+    handle->nack_count = 0;
+
+    /* Probe on the first poll */
+    handle->probe_ns = i2clcd_monotonic_ns(handle) -
+                       (uint64_t)config->probe_interval_ms * 1000000;
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_poll(i2clcd_t *handle, bool *up)
+{
+    uint64_t now;
+    uint8_t pins;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!handle->hotplug_on) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    now = i2clcd_monotonic_ns(handle);
+    if (now - handle->probe_ns >=
+        (uint64_t)handle->hotplug.probe_interval_ms * 1000000) {
+        handle->probe_ns = now;
+
+        /* One address byte plus one data byte on the bus */
+        if (i2clcd_bus_read(handle, &pins, 1) < 0) {
+            if (!handle->link_down &&
+                ++handle->nack_count >= handle->hotplug.nack_streak) {
+                i2clcd_link_lost(handle);
+            }
+        } else {
+            handle->nack_count = 0;
+
+            if (handle->link_down) {
+                restore(handle, I2CLCD_LINK_RESTORED);
+            } else if (handle->wiring.to_logical[pins] & HOTPLUG_IDLE_LOW) {
+                restore(handle, I2CLCD_LINK_BROWNOUT);
+            }
+        }
+
+        /* Mirror members that missed updates catch up at the same pace */
+        i2clcd_mirror_heal(handle);
+    }
+
+    if (up) {
+        *up = !handle->link_down;
+    }
+
+    return I2CLCD_OK;
+}
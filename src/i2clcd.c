@@ -5,18 +5,13 @@
  * i2clcd.c - HD44780 LCD control via PCF8574 I2C backpack
  */
 
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
-#include <unistd.h>
-#include <fcntl.h>
 #include <errno.h>
-#include <time.h>
-#include <sys/ioctl.h>
-#include <linux/i2c-dev.h>
 
 #include "i2clcd.h"
 #include "i2clcd_internal.h"
@@ -34,6 +29,11 @@ static const char *error_strings[] = {
     "Invalid argument",
     "LCD not initialized",
     "Value out of range",
+    "Out of memory",
+    "Not supported by backend",
+    "File I/O or format error",
+    "No device at address",
+    "Replay may differ from the recording",
 };
 
 const char *i2clcd_strerror(i2clcd_err_t err)
@@ -46,39 +46,532 @@ const char *i2clcd_strerror(i2clcd_err_t err)
 }
 
 /*---------------------------------------------------------------------------
- * Timing Functions
+ * Shadow State
  *---------------------------------------------------------------------------*/
 
-void i2clcd_delay_us(unsigned int us)
+void i2clcd_shadow_reset(i2clcd_t *ctx)
 {
-    struct timespec ts;
+    memset(&ctx->shadow, 0, sizeof(ctx->shadow));
+    memset(&ctx->shadow_alt, 0, sizeof(ctx->shadow_alt));
+}
+
+struct i2clcd_shadow *i2clcd_shadow_of(i2clcd_t *ctx, uint8_t ctrl)
+{
+    return ctrl == ctx->sel ? &ctx->shadow : &ctx->shadow_alt;
+}
+
+const struct i2clcd_shadow *i2clcd_line_shadow(const i2clcd_t *ctx,
+                                               uint8_t line)
+{
+    return ctx->line_ctrl[line] == ctx->sel ? &ctx->shadow : &ctx->shadow_alt;
+}
+
+/* Both controllers of a 40x4 panel take the bytes now going out */
+static bool broadcast(const i2clcd_t *ctx)
+{
+    return ctx->target == I2CLCD_CTRL_ALL;
+}
+
+static void shadow_advance(i2clcd_t *ctx, struct i2clcd_shadow *sh)
+{
+    bool inc = (ctx->entry_mode & HD44780_ENTRY_INC) != 0;
+
+    if (sh->addr_cgram) {
+        sh->addr = (uint8_t)((sh->addr + (inc ? 1 : -1)) & (HD44780_CGRAM_SIZE - 1));
+        return;
+    }
+
+    /* In 2-line mode DDRAM is two 40-cell banks at 0x00 and 0x40 */
+    if (inc) {
+        sh->addr++;
+        if (sh->addr == HD44780_LINE0_ADDR + HD44780_DDRAM_LINE_LEN) {
+            sh->addr = HD44780_LINE1_ADDR;
+        } else if (sh->addr == HD44780_LINE1_ADDR + HD44780_DDRAM_LINE_LEN) {
+            sh->addr = HD44780_LINE0_ADDR;
+        }
+    } else {
+        if (sh->addr == HD44780_LINE0_ADDR) {
+            sh->addr = HD44780_LINE1_ADDR + HD44780_DDRAM_LINE_LEN - 1;
+        } else if (sh->addr == HD44780_LINE1_ADDR) {
+            sh->addr = HD44780_LINE0_ADDR + HD44780_DDRAM_LINE_LEN - 1;
+        } else {
+            sh->addr--;
+        }
+    }
+}
+
+static void shadow_command_one(i2clcd_t *ctx, struct i2clcd_shadow *sh,
+                               uint8_t cmd)
+{
+    if (cmd & HD44780_CMD_SET_DDRAM) {
+        sh->addr = cmd & (HD44780_DDRAM_SIZE - 1);
+        sh->addr_cgram = false;
+        sh->addr_valid = true;
+    } else if (cmd & HD44780_CMD_SET_CGRAM) {
+        sh->addr = cmd & (HD44780_CGRAM_SIZE - 1);
+        sh->addr_cgram = true;
+        sh->addr_valid = true;
+    } else if (cmd == HD44780_CMD_CLEAR) {
+        /* Clear fills DDRAM with spaces and forces increment mode */
+        memset(sh->ddram, ' ', sizeof(sh->ddram));
+        memset(sh->ddram_valid, 0xFF, sizeof(sh->ddram_valid));
+        sh->addr = 0;
+        sh->addr_cgram = false;
+        sh->addr_valid = true;
+        ctx->entry_mode |= HD44780_ENTRY_INC;
+    } else if ((cmd & ~1) == HD44780_CMD_HOME) {
+        sh->addr = 0;
+        sh->addr_cgram = false;
+        sh->addr_valid = true;
+    }
+}
 
-    ts.tv_sec = us / 1000000;
-    ts.tv_nsec = (us % 1000000) * 1000;
+static void shadow_data_one(i2clcd_t *ctx, struct i2clcd_shadow *sh,
+                            uint8_t data)
+{
+    if (!sh->addr_valid) {
+        return;
+    }
+
+    if (sh->addr_cgram) {
+        sh->cgram[sh->addr] = data;
+        sh->cgram_valid[sh->addr >> 3] |= (uint8_t)(1 << (sh->addr & 7));
+    } else {
+        sh->ddram[sh->addr] = data;
+        sh->ddram_valid[sh->addr >> 3] |= (uint8_t)(1 << (sh->addr & 7));
+    }
+
+    shadow_advance(ctx, sh);
+}
 
-    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
-        /* Retry if interrupted by signal */
+static void shadow_command(i2clcd_t *ctx, uint8_t cmd)
+{
+    shadow_command_one(ctx, &ctx->shadow, cmd);
+    if (broadcast(ctx)) {
+        shadow_command_one(ctx, &ctx->shadow_alt, cmd);
     }
 }
 
-void i2clcd_delay_ms(unsigned int ms)
+static void shadow_data(i2clcd_t *ctx, uint8_t data)
 {
-    i2clcd_delay_us(ms * 1000);
+    shadow_data_one(ctx, &ctx->shadow, data);
+    if (broadcast(ctx)) {
+        shadow_data_one(ctx, &ctx->shadow_alt, data);
+    }
+}
+
+static void shadow_invalidate(struct i2clcd_shadow *sh)
+{
+    memset(sh->ddram_valid, 0, sizeof(sh->ddram_valid));
+    memset(sh->cgram_valid, 0, sizeof(sh->cgram_valid));
+    sh->addr_valid = false;
+}
+
+/*---------------------------------------------------------------------------
+ * Controller Selection (40x4 panels)
+ *---------------------------------------------------------------------------*/
+
+void i2clcd_select(i2clcd_t *ctx, uint8_t target)
+{
+    const struct i2clcd_wiring *w = &ctx->wiring;
+    struct i2clcd_shadow tmp;
+
+    target &= (uint8_t)((1u << ctx->ctrls) - 1);
+    ctx->target = target;
+    ctx->en_sel = (uint8_t)(((target & I2CLCD_CTRL_E1) ? w->en : 0) |
+                            ((target & I2CLCD_CTRL_E2) ? w->rw : 0));
+
+    /* Commands and data update ctx->shadow; swap in the new target's */
+    if (target != I2CLCD_CTRL_ALL && (target >> 1) != ctx->sel) {
+        tmp = ctx->shadow;
+        ctx->shadow = ctx->shadow_alt;
+        ctx->shadow_alt = tmp;
+        ctx->sel = (uint8_t)(target >> 1);
+    }
+}
+
+int i2clcd_select_line(i2clcd_t *ctx, uint8_t line)
+{
+    uint8_t ctrl = ctx->line_ctrl[line];
+    bool moved = ctx->sel != ctrl || broadcast(ctx);
+
+    i2clcd_select(ctx, (uint8_t)(1u << ctrl));
+
+    /* The cursor belongs to one controller at a time */
+    if (moved && ctx->ctrls > 1 &&
+        (ctx->display_ctrl & (HD44780_CURSOR_ON | HD44780_BLINK_ON))) {
+        return i2clcd_update_display_ctrl(ctx);
+    }
+    return 0;
+}
+
+uint64_t i2clcd_busy_ns(const i2clcd_t *ctx, uint8_t target)
+{
+    uint64_t ready = 0, now;
+    unsigned int c;
+
+    for (c = 0; c < ctx->ctrls; c++) {
+        if (((target >> c) & 1) && ctx->busy_ns[c] > ready) {
+            ready = ctx->busy_ns[c];
+        }
+    }
+
+    now = i2clcd_monotonic_ns(ctx);
+    return ready > now ? ready - now : 0;
+}
+
+void i2clcd_settle(i2clcd_t *ctx, unsigned int us)
+{
+    uint64_t until;
+    unsigned int c;
+
+    if (ctx->ctrls < 2) {
+        i2clcd_delay_us(ctx, us);
+        return;
+    }
+
+    until = i2clcd_monotonic_ns(ctx) + (uint64_t)us * 1000;
+    for (c = 0; c < ctx->ctrls; c++) {
+        if ((ctx->target >> c) & 1) {
+            ctx->busy_ns[c] = until;
+        }
+    }
 }
 
 /*---------------------------------------------------------------------------
  * Low-Level I2C Functions
  *---------------------------------------------------------------------------*/
 
-int i2clcd_i2c_write_byte(i2clcd_t *ctx, uint8_t byte)
+static void batch_note_lag(i2clcd_t *ctx, uint64_t lag_ns)
+{
+    i2clcd_budget_stats_t *st = &ctx->budget->stats;
+
+    st->lag_last_us = lag_ns / 1000;
+    if (st->lag_last_us > st->lag_max_us) {
+        st->lag_max_us = st->lag_last_us;
+    }
+}
+
+/* One transaction, retried with exponential backoff */
+static int write_chunk(i2clcd_t *ctx, const uint8_t *buf, size_t len)
+{
+    uint32_t backoff = ctx->recovery.backoff_us;
+    unsigned int attempt;
+    uint64_t t0;
+    int ret, err;
+
+    for (attempt = 0; ; attempt++) {
+        t0 = i2clcd_monotonic_ns(ctx);
+        ret = ctx->backend->ops->write(ctx->backend, buf, len);
+        err = errno;
+        ctx->stats.bus_ns += i2clcd_monotonic_ns(ctx) - t0;
+        if (ctx->bus_syscalls) {
+            ctx->stats.syscalls++;
+        }
+
+        if (ret == 0) {
+            ctx->nack_count = 0;
+            return 0;
+        }
+
+        ctx->stats.errors++;
+
+        /* A run of NACKs means nobody is there to retry for */
+        if (err == ENXIO && ctx->hotplug_on &&
+            ++ctx->nack_count >= ctx->hotplug.nack_streak) {
+            i2clcd_link_lost(ctx);
+            errno = err;
+            return -1;
+        }
+
+        /* Only an address NACK guarantees nothing reached the device */
+        if (err != ENXIO || attempt >= ctx->recovery.retries) {
+            ctx->resync_pending = true;
+        }
+
+        if (attempt >= ctx->recovery.retries) {
+            errno = err;
+            return -1;
+        }
+
+        ctx->stats.retries++;
+        if (backoff > 0) {
+            i2clcd_delay_us(ctx, backoff);
+            backoff = (backoff > ctx->recovery.backoff_max_us / 2) ?
+                      ctx->recovery.backoff_max_us : backoff * 2;
+        }
+    }
+}
+
+/* With resync enabled, bus errors are repaired once the operation ends */
+static bool defer_errors(const i2clcd_t *ctx)
+{
+    return ctx->recovery.resync && !ctx->recovering;
+}
+
+int i2clcd_bus_write(i2clcd_t *ctx, const uint8_t *buf, size_t len)
+{
+    size_t chunk, max_chunk = len;
+    uint64_t lag_ns = 0, wait_ns;
+    int ret;
+
+    if (ctx->budget && ctx->budget->cfg.max_xfer_bytes > 0) {
+        max_chunk = ctx->budget->cfg.max_xfer_bytes;
+        /* Keep chunks aligned to whole characters (4 bus bytes), or at
+         * least to control/data pairs on an 8-bit bus */
+        if (max_chunk >= 4) {
+            max_chunk &= ~(size_t)3;
+        } else if (ctx->eight_bit) {
+            max_chunk = 2;
+        }
+    }
+
+    /* Short enough that a due button poll never waits past its bound */
+    if (ctx->buttons.enabled && ctx->buttons.max_xfer < max_chunk) {
+        max_chunk = ctx->buttons.max_xfer;
+    }
+
+    /* The shadow keeps the intended state until the device is restored;
+     * a restore that runs into the missing device has to fail */
+    if (ctx->link_down) {
+        return ctx->recovering ? -1 : 0;
+    }
+
+    while (len > 0) {
+        chunk = (len < max_chunk) ? len : max_chunk;
+
+        if (ctx->budget) {
+            wait_ns = i2clcd_budget_acquire(ctx, chunk);
+            if (wait_ns > 0) {
+                ctx->stats.sleeps++;
+                ctx->stats.sleep_ns += wait_ns;
+                ctx->stats.syscalls++;
+                lag_ns += wait_ns;
+            }
+        }
+
+        ret = write_chunk(ctx, buf, chunk);
+
+        if (ctx->budget) {
+            i2clcd_budget_release(ctx);
+        }
+
+        if (ret < 0) {
+            return (ctx->link_down && !ctx->recovering) ? 0 : -1;
+        }
+
+        ctx->stats.xfers++;
+        ctx->stats.bytes += chunk;
+
+        buf += chunk;
+        len -= chunk;
+
+        /* Gaps between transactions are where the buttons get read */
+        if (ctx->buttons.enabled) {
+            i2clcd_buttons_run(ctx);
+        }
+    }
+
+    if (ctx->budget) {
+        if (ctx->batch_depth > 0) {
+            ctx->batch_lag_ns += lag_ns;
+        } else {
+            batch_note_lag(ctx, lag_ns);
+        }
+    }
+
+    return 0;
+}
+
+int i2clcd_bus_read(i2clcd_t *ctx, uint8_t *buf, size_t len)
+{
+    uint64_t t0, wait_ns;
+    int ret;
+
+    if (ctx->budget) {
+        wait_ns = i2clcd_budget_acquire(ctx, len);
+        if (wait_ns > 0) {
+            ctx->stats.sleeps++;
+            ctx->stats.sleep_ns += wait_ns;
+            ctx->stats.syscalls++;
+        }
+    }
+
+    t0 = i2clcd_monotonic_ns(ctx);
+    ret = ctx->backend->ops->read(ctx->backend, buf, len);
+    ctx->stats.bus_ns += i2clcd_monotonic_ns(ctx) - t0;
+    if (ctx->bus_syscalls) {
+        ctx->stats.syscalls++;
+    }
+
+    if (ctx->budget) {
+        i2clcd_budget_release(ctx);
+    }
+
+    if (ret < 0) {
+        ctx->stats.errors++;
+        return -1;
+    }
+
+    ctx->stats.xfers++;
+    ctx->stats.bytes += len;
+    return 0;
+}
+
+static int layer_xfer(i2clcd_t *ctx, struct i2clcd_backend *be,
+                      uint8_t *rbuf, const uint8_t *wbuf, size_t len)
+{
+    uint64_t wait_ns;
+    int ret;
+
+    if (ctx->budget) {
+        wait_ns = i2clcd_budget_acquire(ctx, len);
+        if (wait_ns > 0) {
+            ctx->stats.sleeps++;
+            ctx->stats.sleep_ns += wait_ns;
+            ctx->stats.syscalls++;
+        }
+    }
+
+    ret = rbuf ? be->ops->read(be, rbuf, len) : be->ops->write(be, wbuf, len);
+    if (ctx->bus_syscalls) {
+        ctx->stats.syscalls++;
+    }
+
+    if (ctx->budget) {
+        i2clcd_budget_release(ctx);
+    }
+
+    /* The caller's transfer times and counts the failure */
+    if (ret < 0) {
+        return -1;
+    }
+
+    ctx->stats.xfers++;
+    ctx->stats.bytes += len;
+    return 0;
+}
+
+int i2clcd_layer_write(i2clcd_t *ctx, struct i2clcd_backend *be,
+                       const uint8_t *buf, size_t len)
+{
+    return layer_xfer(ctx, be, NULL, buf, len);
+}
+
+int i2clcd_layer_read(i2clcd_t *ctx, struct i2clcd_backend *be,
+                      uint8_t *buf, size_t len)
+{
+    return layer_xfer(ctx, be, buf, NULL, len);
+}
+
+void i2clcd_layer_extra(i2clcd_t *ctx, size_t len)
 {
-    ssize_t ret;
+    if (ctx->budget) {
+        i2clcd_budget_charge(ctx, len);
+    }
+    ctx->stats.bytes += len;
+}
+
+static int batch_flush(i2clcd_t *ctx)
+{
+    int ret = 0;
+
+    if (ctx->tx_len > 0) {
+        ret = i2clcd_bus_write(ctx, ctx->tx, ctx->tx_len);
+        ctx->tx_len = 0;
+    }
+
+    if (ret < 0) {
+        ctx->batch_failed = true;
+
+        /* Some queued bytes may not have arrived; trust nothing */
+        if (!defer_errors(ctx)) {
+            shadow_invalidate(&ctx->shadow);
+            if (ctx->ctrls > 1) {
+                shadow_invalidate(&ctx->shadow_alt);
+            }
+        }
+    }
+
+    return ret;
+}
+
+void i2clcd_batch_begin(i2clcd_t *ctx)
+{
+    if (ctx->batch_depth++ == 0) {
+        ctx->batch_failed = false;
+        ctx->batch_lag_ns = 0;
+    }
+}
+
+int i2clcd_batch_end(i2clcd_t *ctx)
+{
+    if (ctx->batch_depth == 0 || --ctx->batch_depth > 0) {
+        return 0;
+    }
+
+    batch_flush(ctx);
+
+    if (ctx->budget) {
+        batch_note_lag(ctx, ctx->batch_lag_ns);
+    }
+
+    /* A successful replay leaves the display as if nothing had failed */
+    if (ctx->resync_pending && defer_errors(ctx)) {
+        ctx->batch_failed = i2clcd_recovery_run(ctx, false) < 0;
+    }
+
+    return ctx->batch_failed ? -1 : 0;
+}
+
+int i2clcd_i2c_write(i2clcd_t *ctx, const uint8_t *buf, size_t len)
+{
+    if (ctx->batch_depth > 0) {
+        if (ctx->tx_len + len > sizeof(ctx->tx) && batch_flush(ctx) < 0 &&
+            !defer_errors(ctx)) {
+            return -1;
+        }
+        memcpy(ctx->tx + ctx->tx_len, buf, len);
+        ctx->tx_len += len;
+        return 0;
+    }
 
-    ret = write(ctx->fd, &byte, 1);
-    if (ret != 1) {
+    if (i2clcd_bus_write(ctx, buf, len) < 0 && !defer_errors(ctx)) {
         return -1;
     }
+    return 0;
+}
+
+int i2clcd_write_pins(i2clcd_t *ctx, uint8_t pins)
+{
+    uint8_t pair[2] = { pins, 0 };
+
+    if (!ctx->eight_bit) {
+        return i2clcd_i2c_write_byte(ctx, pins);
+    }
+
+    ctx->pins = pins;
+    return i2clcd_i2c_write(ctx, pair, sizeof(pair));
+}
 
+int i2clcd_i2c_write_byte(i2clcd_t *ctx, uint8_t byte)
+{
+    ctx->pins = byte;
+
+    /* When errors are deferred, keep going so the shadow holds the whole
+     * intended update for the replay */
+    if (ctx->batch_depth > 0) {
+        if (ctx->tx_len == sizeof(ctx->tx) && batch_flush(ctx) < 0 &&
+            !defer_errors(ctx)) {
+            return -1;
+        }
+        ctx->tx[ctx->tx_len++] = byte;
+        return 0;
+    }
+
+    if (i2clcd_bus_write(ctx, &byte, 1) < 0 && !defer_errors(ctx)) {
+        return -1;
+    }
     return 0;
 }
 
@@ -86,8 +579,61 @@ int i2clcd_i2c_write_byte(i2clcd_t *ctx, uint8_t byte)
  * LCD Write Functions (4-bit mode)
  *---------------------------------------------------------------------------*/
 
+/* On a 40x4 panel, bytes for a controller still executing a slow
+ * instruction wait; anything queued for the other goes out first */
+static void wait_ready(i2clcd_t *ctx)
+{
+    uint64_t wait_ns;
+
+    if (ctx->ctrls < 2 || i2clcd_busy_ns(ctx, ctx->target) == 0) {
+        return;
+    }
+
+    batch_flush(ctx);
+    wait_ns = i2clcd_busy_ns(ctx, ctx->target);
+    if (wait_ns > 0) {
+        i2clcd_delay_us(ctx, (unsigned int)((wait_ns + 999) / 1000));
+    }
+}
+
+/* Point the enable bits of encoded bytes (EN high, low, high, low) at
+ * the target controllers */
+static void retarget(const i2clcd_t *ctx, uint8_t *seq, size_t n)
+{
+    uint8_t flip = ctx->en_sel ^ ctx->wiring.en;
+    size_t i;
+
+    if (flip == 0) {
+        return;
+    }
+    for (i = 0; i < n; i += 2) {
+        seq[i] ^= flip;
+    }
+}
+
+/* One strobe per byte: EN rises with the data port set, then falls */
+static int write_byte8(i2clcd_t *ctx, uint8_t byte, bool rs)
+{
+    uint8_t seq[4];
+
+    i2clcd_encode8(&ctx->wiring, rs, ctx->backlight, &byte, 1, seq);
+    ctx->pins = seq[2];
+
+    /* One transaction, so the bus itself paces the enable pulse */
+    if (i2clcd_i2c_write(ctx, seq, sizeof(seq)) < 0) {
+        return -1;
+    }
+
+    if (ctx->batch_depth == 0) {
+        i2clcd_delay_us(ctx, HD44780_DELAY_CMD_US);
+    }
+
+    return 0;
+}
+
 int i2clcd_write_nibble(i2clcd_t *ctx, uint8_t nibble, bool rs)
 {
+    const struct i2clcd_wiring *w = &ctx->wiring;
     uint8_t data;
     int ret;
 
@@ -96,21 +642,28 @@ int i2clcd_write_nibble(i2clcd_t *ctx, uint8_t nibble, bool rs)
      * - RS bit set based on command/data
      * - Backlight bit preserved
      */
-    data = (nibble & PCF8574_DATA_MASK);
-    if (rs) {
-        data |= PCF8574_PIN_RS;
+    /* On an 8-bit bus a lone nibble goes out as a byte with D3-D0 low */
+    if (ctx->eight_bit) {
+        return write_byte8(ctx, nibble & 0xF0, rs);
     }
-    if (ctx->backlight) {
-        data |= PCF8574_PIN_BL;
+
+    data = w->nibble[nibble >> 4] | w->bl[ctx->backlight];
+    if (rs) {
+        data |= w->rs;
     }
 
+    wait_ready(ctx);
+
     /* Write data with Enable HIGH */
-    ret = i2clcd_i2c_write_byte(ctx, data | PCF8574_PIN_EN);
+    ret = i2clcd_i2c_write_byte(ctx, data | ctx->en_sel);
     if (ret < 0) {
         return ret;
     }
 
-    i2clcd_delay_us(HD44780_DELAY_ENABLE_US);
+    /* Batched transfers are paced by the bus itself */
+    if (ctx->batch_depth == 0) {
+        i2clcd_delay_us(ctx, HD44780_DELAY_ENABLE_US);
+    }
 
     /* Write data with Enable LOW (falling edge latches data) */
     ret = i2clcd_i2c_write_byte(ctx, data);
@@ -118,7 +671,9 @@ int i2clcd_write_nibble(i2clcd_t *ctx, uint8_t nibble, bool rs)
         return ret;
     }
 
-    i2clcd_delay_us(HD44780_DELAY_CMD_US);
+    if (ctx->batch_depth == 0) {
+        i2clcd_settle(ctx, HD44780_DELAY_CMD_US);
+    }
 
     return 0;
 }
@@ -127,6 +682,22 @@ int i2clcd_write_byte(i2clcd_t *ctx, uint8_t byte, bool rs)
 {
     int ret;
 
+    if (ctx->eight_bit) {
+        return write_byte8(ctx, byte, rs);
+    }
+
+    /* Batched: the four bus bytes come straight from the wiring table */
+    wait_ready(ctx);
+    if (ctx->batch_depth > 0 &&
+        ctx->tx_len + 4 <= sizeof(ctx->tx)) {
+        memcpy(ctx->tx + ctx->tx_len,
+               ctx->wiring.encode[rs][ctx->backlight][byte], 4);
+        retarget(ctx, ctx->tx + ctx->tx_len, 4);
+        ctx->tx_len += 4;
+        ctx->pins = ctx->tx[ctx->tx_len - 1];
+        return 0;
+    }
+
     /* High nibble first */
     ret = i2clcd_write_nibble(ctx, byte & 0xF0, rs);
     if (ret < 0) {
@@ -138,19 +709,170 @@ int i2clcd_write_byte(i2clcd_t *ctx, uint8_t byte, bool rs)
     return ret;
 }
 
+/* Outside a batch, each complete byte is a point where recovery can run */
+static int finish_unbatched(i2clcd_t *ctx)
+{
+    if (ctx->batch_depth == 0 && ctx->resync_pending && defer_errors(ctx)) {
+        return i2clcd_recovery_run(ctx, false);
+    }
+    return 0;
+}
+
 int i2clcd_command(i2clcd_t *ctx, uint8_t cmd)
 {
-    return i2clcd_write_byte(ctx, cmd, false);
+    int ret;
+
+    i2clcd_stats_command(ctx, cmd, false);
+    ret = i2clcd_write_byte(ctx, cmd, false);
+    if (ret < 0) {
+        /* A partial write leaves the address counter in an unknown place */
+        ctx->shadow.addr_valid = false;
+        if (broadcast(ctx)) {
+            ctx->shadow_alt.addr_valid = false;
+        }
+        return ret;
+    }
+
+    shadow_command(ctx, cmd);
+    return finish_unbatched(ctx);
 }
 
 int i2clcd_data(i2clcd_t *ctx, uint8_t data)
 {
-    return i2clcd_write_byte(ctx, data, true);
+    int ret;
+
+    i2clcd_stats_command(ctx, data, true);
+    ret = i2clcd_write_byte(ctx, data, true);
+    if (ret < 0) {
+        /* The target cell may or may not have been written */
+        if (ctx->shadow.addr_valid && !ctx->shadow.addr_cgram) {
+            ctx->shadow.ddram_valid[ctx->shadow.addr >> 3] &=
+                (uint8_t)~(1 << (ctx->shadow.addr & 7));
+        }
+        ctx->shadow.addr_valid = false;
+        if (broadcast(ctx)) {
+            ctx->shadow_alt.addr_valid = false;
+        }
+        return ret;
+    }
+
+    shadow_data(ctx, data);
+    return finish_unbatched(ctx);
+}
+
+int i2clcd_data_run(i2clcd_t *ctx, const uint8_t *data, size_t len)
+{
+    size_t i, j, n;
+
+    for (i = 0; i < len; i += n) {
+        n = (sizeof(ctx->tx) - ctx->tx_len) / 4;
+        if (n > len - i) {
+            n = len - i;
+        }
+
+        /* Unbatched bytes are paced one by one; a full buffer flushes */
+        if (ctx->batch_depth == 0 || n == 0) {
+            if (i2clcd_data(ctx, data[i]) < 0) {
+                return -1;
+            }
+            n = 1;
+            continue;
+        }
+
+        if (ctx->eight_bit) {
+            i2clcd_encode8(&ctx->wiring, true, ctx->backlight, data + i, n,
+                           ctx->tx + ctx->tx_len);
+        } else {
+            wait_ready(ctx);
+            i2clcd_encode(&ctx->wiring, true, ctx->backlight, data + i, n,
+                          ctx->tx + ctx->tx_len);
+            retarget(ctx, ctx->tx + ctx->tx_len, 4 * n);
+        }
+        ctx->tx_len += 4 * n;
+        ctx->pins = ctx->tx[ctx->tx_len - 1];
+
+        ctx->stats.commands[I2CLCD_CMD_DATA] += n;
+        for (j = 0; j < n; j++) {
+            shadow_data(ctx, data[i + j]);
+        }
+    }
+
+    return 0;
+}
+
+uint8_t i2clcd_function_set(const i2clcd_t *ctx)
+{
+    return HD44780_CMD_FUNCTION_SET |
+           (ctx->eight_bit ? HD44780_8BIT_MODE : HD44780_4BIT_MODE) |
+           HD44780_2LINE | HD44780_5X8_DOTS;
+}
+
+int i2clcd_command_all(i2clcd_t *ctx, uint8_t cmd)
+{
+    uint8_t target = ctx->target;
+    int ret;
+
+    i2clcd_select(ctx, I2CLCD_CTRL_ALL);
+    ret = i2clcd_command(ctx, cmd);
+    i2clcd_select(ctx, target);
+    return ret;
 }
 
 int i2clcd_update_display_ctrl(i2clcd_t *ctx)
 {
-    return i2clcd_command(ctx, HD44780_CMD_DISPLAY_CTRL | ctx->display_ctrl);
+    uint8_t cursor = HD44780_CURSOR_ON | HD44780_BLINK_ON;
+    uint8_t target = ctx->target, sel = ctx->sel;
+    int ret;
+
+    if (ctx->ctrls < 2 || !(ctx->display_ctrl & cursor)) {
+        return i2clcd_command_all(ctx, HD44780_CMD_DISPLAY_CTRL |
+                                       ctx->display_ctrl);
+    }
+
+    /* Only the controller holding the cursor shows it */
+    i2clcd_select(ctx, (uint8_t)(I2CLCD_CTRL_ALL & ~(1u << sel)));
+    ret = i2clcd_command(ctx, HD44780_CMD_DISPLAY_CTRL |
+                              (ctx->display_ctrl & ~cursor));
+    i2clcd_select(ctx, (uint8_t)(1u << sel));
+    if (ret == 0) {
+        ret = i2clcd_command(ctx, HD44780_CMD_DISPLAY_CTRL | ctx->display_ctrl);
+    }
+    i2clcd_select(ctx, target);
+    return ret;
+}
+
+/* Close a batch opened by a public API call and merge its result */
+static i2clcd_err_t batch_result(i2clcd_t *ctx, i2clcd_err_t ret)
+{
+    if (i2clcd_batch_end(ctx) < 0 && ret == I2CLCD_OK) {
+        ret = I2CLCD_ERR_WRITE;
+    }
+    return ret;
+}
+
+/* Write a whole line, padding with spaces; the caller opens the batch */
+static i2clcd_err_t write_line(i2clcd_t *handle, uint8_t line, const char *text)
+{
+    uint8_t row[I2CLCD_MAX_COLS];
+    size_t len;
+
+    /* Position cursor at start of line */
+    if (i2clcd_select_line(handle, line) < 0 ||
+        i2clcd_command(handle,
+                       HD44780_CMD_SET_DDRAM | handle->line_addr[line]) < 0) {
+        return I2CLCD_ERR_WRITE;
+    }
+
+    /* Write text, padding with spaces if shorter than line width */
+    len = strnlen(text, handle->cols);
+    memcpy(row, text, len);
+    memset(row + len, ' ', handle->cols - len);
+
+    if (i2clcd_data_run(handle, row, handle->cols) < 0) {
+        return I2CLCD_ERR_WRITE;
+    }
+
+    return I2CLCD_OK;
 }
 
 /*---------------------------------------------------------------------------
@@ -159,6 +881,8 @@ int i2clcd_update_display_ctrl(i2clcd_t *ctx)
 
 i2clcd_err_t i2clcd_open(const i2clcd_config_t *config, i2clcd_t **handle)
 {
+    i2clcd_err_t err;
+    uint64_t t0;
     i2clcd_t *ctx;
 
     /* Validate arguments */
@@ -169,9 +893,17 @@ i2clcd_err_t i2clcd_open(const i2clcd_config_t *config, i2clcd_t **handle)
     /* Allocate context */
     ctx = calloc(1, sizeof(*ctx));
     if (!ctx) {
-        return I2CLCD_ERR_OPEN;
+        return I2CLCD_ERR_NOMEM;
     }
 
+    /* Timing goes through the handle's clock from here on */
+    err = i2clcd_set_clock(ctx, config->clock);
+    if (err != I2CLCD_OK) {
+        free(ctx);
+        return err;
+    }
+    t0 = i2clcd_monotonic_ns(ctx);
+
     /* Store configuration */
     ctx->i2c_addr = config->i2c_addr;
     ctx->backlight = config->backlight;
@@ -190,43 +922,131 @@ i2clcd_err_t i2clcd_open(const i2clcd_config_t *config, i2clcd_t **handle)
         ctx->cols = config->cols;
         ctx->rows = config->rows;
         break;
+    case I2CLCD_40X4:
+        ctx->cols = 40;
+        ctx->rows = 4;
+        break;
     default:
         free(ctx);
         return I2CLCD_ERR_INVALID_ARG;
     }
 
+    if (ctx->cols == 0 || ctx->cols > I2CLCD_MAX_COLS ||
+        ctx->rows == 0 || ctx->rows > I2CLCD_MAX_ROWS) {
+        free(ctx);
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
     /* Set line addresses (DDRAM offsets) */
     ctx->line_addr[0] = HD44780_LINE0_ADDR;
     ctx->line_addr[1] = HD44780_LINE1_ADDR;
     ctx->line_addr[2] = HD44780_LINE2_ADDR;
     ctx->line_addr[3] = HD44780_LINE3_ADDR;
+    ctx->ctrls = 1;
+
+    /* 40x4: each controller drives two 40-cell lines */
+    if (config->size == I2CLCD_40X4) {
+        ctx->line_addr[2] = HD44780_LINE0_ADDR;
+        ctx->line_addr[3] = HD44780_LINE1_ADDR;
+        ctx->line_ctrl[2] = ctx->line_ctrl[3] = 1;
+        ctx->ctrls = 2;
+    }
+
+    if ((unsigned int)config->expander > I2CLCD_EXPANDER_RGB_PLATE) {
+        free(ctx);
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    /* E2 takes the RW pin, which the 8-bit wiring has on its control port
+     * but the panel would need as a data line too */
+    if (ctx->ctrls > 1 && config->expander == I2CLCD_EXPANDER_MCP23017) {
+        free(ctx);
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (config->mux && config->mux_channel >= TCA9548A_CHANNELS) {
+        free(ctx);
+        return I2CLCD_ERR_INVALID_ARG;
+    }
 
-    /* Open I2C device */
-    ctx->fd = open(config->i2c_device, O_RDWR);
-    if (ctx->fd < 0) {
+    /* Compile the backpack wiring */
+    if (i2clcd_wiring_build(&ctx->wiring, i2clcd_config_pinmap(config)) < 0) {
         free(ctx);
-        return I2CLCD_ERR_OPEN;
+        return I2CLCD_ERR_INVALID_ARG;
     }
+    i2clcd_select(ctx, I2CLCD_CTRL_E1);
 
-    /* Set I2C slave address */
-    if (ioctl(ctx->fd, I2C_SLAVE, ctx->i2c_addr) < 0) {
-        close(ctx->fd);
+    /* Open the bus backend (I2C device or emulator) */
+    err = i2clcd_backend_create(config, &ctx->backend);
+    if (err != I2CLCD_OK) {
         free(ctx);
-        return I2CLCD_ERR_IOCTL;
+        return err;
+    }
+    ctx->bus_syscalls = ctx->backend->ops->kernel;
+    if (config->backend == I2CLCD_BACKEND_I2CDEV) {
+        snprintf(ctx->bus, sizeof(ctx->bus), "%s", config->i2c_device);
+    }
+
+    /* Behind a TCA9548A, every transaction first makes sure of the channel */
+    ctx->mux = config->mux;
+    ctx->mux_channel = config->mux_channel;
+    if (ctx->mux) {
+        struct i2clcd_backend *sel;
+
+        err = i2clcd_backend_mux_create(ctx, &sel);
+        if (err != I2CLCD_OK) {
+            i2clcd_backend_destroy_all(ctx);
+            free(ctx);
+            return err;
+        }
+        i2clcd_backend_push(ctx, sel);
+    }
+
+    /* MCP230xx backpacks need a register layer above the transport */
+    ctx->expander = config->expander;
+    ctx->eight_bit = (config->expander == I2CLCD_EXPANDER_MCP23017);
+    if (config->expander != I2CLCD_EXPANDER_PCF8574) {
+        struct i2clcd_backend *mcp;
+
+        err = i2clcd_backend_mcp_create(ctx, config->expander, &mcp);
+        if (err != I2CLCD_OK) {
+            i2clcd_backend_destroy_all(ctx);
+            free(ctx);
+            return err;
+        }
+        i2clcd_backend_push(ctx, mcp);
+    }
+
+    /* Fail here rather than on the first write */
+    if (config->probe) {
+        uint8_t latch;
+
+        if (ctx->backend->ops->read(ctx->backend, &latch, 1) < 0) {
+            i2clcd_backend_destroy_all(ctx);
+            free(ctx);
+            return I2CLCD_ERR_NODEV;
+        }
     }
 
     /* Set default state for already-initialized display */
     ctx->display_ctrl = HD44780_DISPLAY_ON;
     ctx->entry_mode = HD44780_ENTRY_INC;
+    ctx->compositor.prio = I2CLCD_PRIO_NORMAL;
+    ctx->color = I2CLCD_COLOR_WHITE;
+    ctx->recovery = (i2clcd_recovery_config_t)I2CLCD_RECOVERY_CONFIG_DEFAULT;
+
+    /* open() and ioctl() */
+    if (ctx->bus_syscalls) {
+        ctx->stats.syscalls += 2;
+    }
 
     *handle = ctx;
-    return I2CLCD_OK;
+    return i2clcd_stats_api(ctx, I2CLCD_API_OPEN, t0, I2CLCD_OK);
 }
 
 i2clcd_err_t i2clcd_init(const i2clcd_config_t *config, i2clcd_t **handle)
 {
     i2clcd_err_t err;
-    i2clcd_t *ctx;
 
     /* Open I2C connection first */
     err = i2clcd_open(config, handle);
@@ -234,67 +1054,97 @@ i2clcd_err_t i2clcd_init(const i2clcd_config_t *config, i2clcd_t **handle)
         return err;
     }
 
-    ctx = *handle;
+    err = i2clcd_reinit(*handle);
+    if (err != I2CLCD_OK) {
+        i2clcd_deinit(*handle);
+        *handle = NULL;
+    }
+
+    return err;
+}
+
+int i2clcd_init_sequence(i2clcd_t *ctx)
+{
+    int ret = 0;
 
     /*-----------------------------------------------------------------------
      * HD44780 Initialization for 4-bit mode (from datasheet)
      * This sequence is required even if the display was already in 4-bit mode
      *-----------------------------------------------------------------------*/
 
+    /* Both controllers of a 40x4 panel take the same sequence */
+    i2clcd_select(ctx, I2CLCD_CTRL_ALL);
+
     /* Wait >40ms after power-on */
-    i2clcd_delay_ms(HD44780_DELAY_INIT_MS);
+    i2clcd_delay_ms(ctx, HD44780_DELAY_INIT_MS);
 
     /* Start with backlight state, all control pins low */
-    i2clcd_i2c_write_byte(ctx, ctx->backlight ? PCF8574_PIN_BL : 0);
-    i2clcd_delay_ms(1);
+    ret |= i2clcd_write_pins(ctx, ctx->wiring.bl[ctx->backlight]);
+    i2clcd_delay_ms(ctx, 1);
 
     /*
      * Step 1: Send 0x30 (Function Set, 8-bit) three times
      * This ensures the controller is in a known state regardless of
      * whether it was in 4-bit or 8-bit mode before
      */
-    i2clcd_write_nibble(ctx, 0x30, false);  /* 8-bit mode */
-    i2clcd_delay_ms(5);                      /* Wait >4.1ms */
+    ret |= i2clcd_write_nibble(ctx, 0x30, false);  /* 8-bit mode */
+    i2clcd_delay_ms(ctx, 5);                        /* Wait >4.1ms */
 
-    i2clcd_write_nibble(ctx, 0x30, false);  /* 8-bit mode again */
-    i2clcd_delay_us(150);                    /* Wait >100us */
+    ret |= i2clcd_write_nibble(ctx, 0x30, false);  /* 8-bit mode again */
+    i2clcd_delay_us(ctx, 150);                      /* Wait >100us */
 
-    i2clcd_write_nibble(ctx, 0x30, false);  /* 8-bit mode third time */
-    i2clcd_delay_us(150);
+    ret |= i2clcd_write_nibble(ctx, 0x30, false);  /* 8-bit mode third time */
+    i2clcd_delay_us(ctx, 150);
 
-    /* Step 2: Set 4-bit mode */
-    i2clcd_write_nibble(ctx, 0x20, false);
-    i2clcd_delay_us(HD44780_DELAY_CMD_US);
+    /* Step 2: Set 4-bit mode (an 8-bit bus stays in 8-bit mode) */
+    if (!ctx->eight_bit) {
+        ret |= i2clcd_write_nibble(ctx, 0x20, false);
+        i2clcd_delay_us(ctx, HD44780_DELAY_CMD_US);
+    }
 
     /* Now we can use normal byte-write functions */
 
-    /* Step 3: Function set (4-bit, 2-line, 5x8 dots) */
-    i2clcd_command(ctx, HD44780_CMD_FUNCTION_SET |
-                        HD44780_4BIT_MODE |
-                        HD44780_2LINE |
-                        HD44780_5X8_DOTS);
+    /* Step 3: Function set (bus width, 2-line, 5x8 dots) */
+    ret |= i2clcd_command(ctx, i2clcd_function_set(ctx));
 
     /* Step 4: Display off */
     ctx->display_ctrl = 0;
-    i2clcd_command(ctx, HD44780_CMD_DISPLAY_CTRL);
+    ret |= i2clcd_command(ctx, HD44780_CMD_DISPLAY_CTRL);
 
     /* Step 5: Entry mode set (increment, no shift) */
     ctx->entry_mode = HD44780_ENTRY_INC;
-    i2clcd_command(ctx, HD44780_CMD_ENTRY_MODE | ctx->entry_mode);
+    ret |= i2clcd_command(ctx, HD44780_CMD_ENTRY_MODE | ctx->entry_mode);
 
     /* Step 6: Display on (cursor and blink off by default) */
     ctx->display_ctrl = HD44780_DISPLAY_ON;
-    i2clcd_command(ctx, HD44780_CMD_DISPLAY_CTRL | ctx->display_ctrl);
+    ret |= i2clcd_command(ctx, HD44780_CMD_DISPLAY_CTRL | ctx->display_ctrl);
 
-    return I2CLCD_OK;
+    i2clcd_select(ctx, I2CLCD_CTRL_E1);
+    return ret < 0 ? -1 : 0;
+}
+
+i2clcd_err_t i2clcd_reinit(i2clcd_t *ctx)
+{
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
+    if (!ctx) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    t0 = i2clcd_monotonic_ns(ctx);
+
+    if (i2clcd_init_sequence(ctx) < 0) {
+        ret = I2CLCD_ERR_WRITE;
+    }
+
+    return i2clcd_stats_api(ctx, I2CLCD_API_INIT, t0, ret);
 }
 
 void i2clcd_deinit(i2clcd_t *handle)
 {
     if (handle) {
-        if (handle->fd >= 0) {
-            close(handle->fd);
-        }
+        i2clcd_backend_destroy_all(handle);
         free(handle);
     }
 }
@@ -303,24 +1153,46 @@ void i2clcd_deinit(i2clcd_t *handle)
  * Display Control
  *---------------------------------------------------------------------------*/
 
+/* Clear or home on every controller, leaving the cursor on line 0 */
+static int clear_home(i2clcd_t *ctx, uint8_t cmd)
+{
+    i2clcd_select(ctx, I2CLCD_CTRL_ALL);
+    if (i2clcd_command(ctx, cmd) < 0) {
+        i2clcd_select(ctx, I2CLCD_CTRL_E1);
+        return -1;
+    }
+    i2clcd_settle(ctx, HD44780_DELAY_CLEAR_US);
+
+    /* The cursor only needs moving if it showed on the other controller */
+    i2clcd_select(ctx, (uint8_t)(1u << ctx->sel));
+    return i2clcd_select_line(ctx, 0);
+}
+
 i2clcd_err_t i2clcd_clear(i2clcd_t *handle)
 {
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
     }
 
-    if (i2clcd_command(handle, HD44780_CMD_CLEAR) < 0) {
-        return I2CLCD_ERR_WRITE;
+    t0 = i2clcd_monotonic_ns(handle);
+
+    if (handle->compositor.enabled) {
+        i2clcd_compositor_clear(handle, -1);
+        ret = i2clcd_compositor_expedite(handle);
+    } else if (clear_home(handle, HD44780_CMD_CLEAR) < 0) {
+        ret = I2CLCD_ERR_WRITE;
     }
 
-    i2clcd_delay_us(HD44780_DELAY_CLEAR_US);
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_CLEAR, t0, ret);
 }
 
 i2clcd_err_t i2clcd_clear_line(i2clcd_t *handle, uint8_t line)
 {
     i2clcd_err_t ret;
-    uint8_t i;
+    uint64_t t0;
 
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
@@ -330,42 +1202,51 @@ i2clcd_err_t i2clcd_clear_line(i2clcd_t *handle, uint8_t line)
         return I2CLCD_ERR_RANGE;
     }
 
-    /* Position cursor at start of line */
-    ret = i2clcd_set_cursor(handle, 0, line);
-    if (ret != I2CLCD_OK) {
-        return ret;
-    }
+    t0 = i2clcd_monotonic_ns(handle);
 
-    /* Fill line with spaces */
-    for (i = 0; i < handle->cols; i++) {
-        if (i2clcd_data(handle, ' ') < 0) {
-            return I2CLCD_ERR_WRITE;
-        }
+    if (handle->compositor.enabled) {
+        i2clcd_compositor_clear(handle, line);
+        ret = i2clcd_compositor_expedite(handle);
+    } else {
+        /* Fill line with spaces */
+        i2clcd_batch_begin(handle);
+        ret = batch_result(handle, write_line(handle, line, ""));
     }
 
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_CLEAR_LINE, t0, ret);
 }
 
 i2clcd_err_t i2clcd_home(i2clcd_t *handle)
 {
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
     }
 
-    if (i2clcd_command(handle, HD44780_CMD_HOME) < 0) {
-        return I2CLCD_ERR_WRITE;
+    t0 = i2clcd_monotonic_ns(handle);
+
+    if (handle->compositor.enabled) {
+        i2clcd_compositor_move(handle, 0, 0);
+    } else if (clear_home(handle, HD44780_CMD_HOME) < 0) {
+        ret = I2CLCD_ERR_WRITE;
     }
 
-    i2clcd_delay_us(HD44780_DELAY_CLEAR_US);
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_HOME, t0, ret);
 }
 
 i2clcd_err_t i2clcd_display(i2clcd_t *handle, bool on)
 {
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
     }
 
+    t0 = i2clcd_monotonic_ns(handle);
+
     if (on) {
         handle->display_ctrl |= HD44780_DISPLAY_ON;
     } else {
@@ -373,10 +1254,10 @@ i2clcd_err_t i2clcd_display(i2clcd_t *handle, bool on)
     }
 
     if (i2clcd_update_display_ctrl(handle) < 0) {
-        return I2CLCD_ERR_WRITE;
+        ret = I2CLCD_ERR_WRITE;
     }
 
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_DISPLAY, t0, ret);
 }
 
 /*---------------------------------------------------------------------------
@@ -385,6 +1266,8 @@ i2clcd_err_t i2clcd_display(i2clcd_t *handle, bool on)
 
 i2clcd_err_t i2clcd_set_cursor(i2clcd_t *handle, uint8_t col, uint8_t row)
 {
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
     uint8_t addr;
 
     if (!handle) {
@@ -395,23 +1278,35 @@ i2clcd_err_t i2clcd_set_cursor(i2clcd_t *handle, uint8_t col, uint8_t row)
         return I2CLCD_ERR_RANGE;
     }
 
-    /* Calculate DDRAM address */
-    addr = handle->line_addr[row] + col;
+    t0 = i2clcd_monotonic_ns(handle);
 
-    /* Send Set DDRAM Address command */
-    if (i2clcd_command(handle, HD44780_CMD_SET_DDRAM | addr) < 0) {
-        return I2CLCD_ERR_WRITE;
+    if (handle->compositor.enabled) {
+        i2clcd_compositor_move(handle, col, row);
+    } else {
+        /* Calculate DDRAM address */
+        addr = handle->line_addr[row] + col;
+
+        /* Send Set DDRAM Address command */
+        if (i2clcd_select_line(handle, row) < 0 ||
+            i2clcd_command(handle, HD44780_CMD_SET_DDRAM | addr) < 0) {
+            ret = I2CLCD_ERR_WRITE;
+        }
     }
 
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_SET_CURSOR, t0, ret);
 }
 
 i2clcd_err_t i2clcd_cursor(i2clcd_t *handle, bool visible)
 {
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
     }
 
+    t0 = i2clcd_monotonic_ns(handle);
+
     if (visible) {
         handle->display_ctrl |= HD44780_CURSOR_ON;
     } else {
@@ -419,18 +1314,23 @@ i2clcd_err_t i2clcd_cursor(i2clcd_t *handle, bool visible)
     }
 
     if (i2clcd_update_display_ctrl(handle) < 0) {
-        return I2CLCD_ERR_WRITE;
+        ret = I2CLCD_ERR_WRITE;
     }
 
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_CURSOR, t0, ret);
 }
 
 i2clcd_err_t i2clcd_blink(i2clcd_t *handle, bool blink)
 {
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
     }
 
+    t0 = i2clcd_monotonic_ns(handle);
+
     if (blink) {
         handle->display_ctrl |= HD44780_BLINK_ON;
     } else {
@@ -438,10 +1338,10 @@ i2clcd_err_t i2clcd_blink(i2clcd_t *handle, bool blink)
     }
 
     if (i2clcd_update_display_ctrl(handle) < 0) {
-        return I2CLCD_ERR_WRITE;
+        ret = I2CLCD_ERR_WRITE;
     }
 
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_BLINK, t0, ret);
 }
 
 /*---------------------------------------------------------------------------
@@ -450,19 +1350,46 @@ i2clcd_err_t i2clcd_blink(i2clcd_t *handle, bool blink)
 
 i2clcd_err_t i2clcd_putc(i2clcd_t *handle, char c)
 {
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
     }
 
-    if (i2clcd_data(handle, (uint8_t)c) < 0) {
-        return I2CLCD_ERR_WRITE;
+    t0 = i2clcd_monotonic_ns(handle);
+
+    if (handle->compositor.enabled) {
+        i2clcd_compositor_write(handle, &c, 1);
+        ret = i2clcd_compositor_expedite(handle);
+    } else if (i2clcd_data(handle, (uint8_t)c) < 0) {
+        ret = I2CLCD_ERR_WRITE;
     }
 
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_PUTC, t0, ret);
+}
+
+static i2clcd_err_t write_str(i2clcd_t *handle, const char *str)
+{
+    if (handle->compositor.enabled) {
+        i2clcd_compositor_write(handle, str, strlen(str));
+        return i2clcd_compositor_expedite(handle);
+    }
+
+    i2clcd_batch_begin(handle);
+    while (*str) {
+        if (i2clcd_data(handle, (uint8_t)*str++) < 0) {
+            break;
+        }
+    }
+
+    return batch_result(handle, *str ? I2CLCD_ERR_WRITE : I2CLCD_OK);
 }
 
 i2clcd_err_t i2clcd_puts(i2clcd_t *handle, const char *str)
 {
+    uint64_t t0;
+
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
     }
@@ -471,19 +1398,16 @@ i2clcd_err_t i2clcd_puts(i2clcd_t *handle, const char *str)
         return I2CLCD_ERR_INVALID_ARG;
     }
 
-    while (*str) {
-        if (i2clcd_data(handle, (uint8_t)*str++) < 0) {
-            return I2CLCD_ERR_WRITE;
-        }
-    }
-
-    return I2CLCD_OK;
+    t0 = i2clcd_monotonic_ns(handle);
+    return i2clcd_stats_api(handle, I2CLCD_API_PUTS, t0,
+                            write_str(handle, str));
 }
 
 i2clcd_err_t i2clcd_printf(i2clcd_t *handle, const char *fmt, ...)
 {
     char buf[128];
     va_list ap;
+    uint64_t t0;
 
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
@@ -493,17 +1417,20 @@ i2clcd_err_t i2clcd_printf(i2clcd_t *handle, const char *fmt, ...)
         return I2CLCD_ERR_INVALID_ARG;
     }
 
+    t0 = i2clcd_monotonic_ns(handle);
+
     va_start(ap, fmt);
     vsnprintf(buf, sizeof(buf), fmt, ap);
     va_end(ap);
 
-    return i2clcd_puts(handle, buf);
+    return i2clcd_stats_api(handle, I2CLCD_API_PRINTF, t0,
+                            write_str(handle, buf));
 }
 
 i2clcd_err_t i2clcd_set_line(i2clcd_t *handle, uint8_t line, const char *text)
 {
     i2clcd_err_t ret;
-    size_t len, i;
+    uint64_t t0;
 
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
@@ -517,22 +1444,17 @@ i2clcd_err_t i2clcd_set_line(i2clcd_t *handle, uint8_t line, const char *text)
         return I2CLCD_ERR_RANGE;
     }
 
-    /* Position cursor at start of line */
-    ret = i2clcd_set_cursor(handle, 0, line);
-    if (ret != I2CLCD_OK) {
-        return ret;
-    }
+    t0 = i2clcd_monotonic_ns(handle);
 
-    /* Write text, padding with spaces if shorter than line width */
-    len = strlen(text);
-    for (i = 0; i < handle->cols; i++) {
-        char c = (i < len) ? text[i] : ' ';
-        if (i2clcd_data(handle, (uint8_t)c) < 0) {
-            return I2CLCD_ERR_WRITE;
-        }
+    if (handle->compositor.enabled) {
+        i2clcd_compositor_set_line(handle, line, text);
+        ret = i2clcd_compositor_expedite(handle);
+    } else {
+        i2clcd_batch_begin(handle);
+        ret = batch_result(handle, write_line(handle, line, text));
     }
 
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_SET_LINE, t0, ret);
 }
 
 /*---------------------------------------------------------------------------
@@ -541,18 +1463,23 @@ i2clcd_err_t i2clcd_set_line(i2clcd_t *handle, uint8_t line, const char *text)
 
 i2clcd_err_t i2clcd_backlight(i2clcd_t *handle, bool on)
 {
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
     }
 
+    t0 = i2clcd_monotonic_ns(handle);
+
     handle->backlight = on;
 
     /* Send a no-op I2C write to update backlight state */
-    if (i2clcd_i2c_write_byte(handle, on ? PCF8574_PIN_BL : 0) < 0) {
-        return I2CLCD_ERR_WRITE;
+    if (i2clcd_write_pins(handle, handle->wiring.bl[on]) < 0) {
+        ret = I2CLCD_ERR_WRITE;
     }
 
-    return I2CLCD_OK;
+    return i2clcd_stats_api(handle, I2CLCD_API_BACKLIGHT, t0, ret);
 }
 
 i2clcd_err_t i2clcd_backlight_get(i2clcd_t *handle, bool *on)
@@ -573,10 +1500,146 @@ i2clcd_err_t i2clcd_backlight_get(i2clcd_t *handle, bool *on)
  * Custom Characters (CGRAM)
  *---------------------------------------------------------------------------*/
 
+bool i2clcd_cgram_holds(i2clcd_t *ctx, uint8_t slot, const uint8_t charmap[8])
+{
+    const struct i2clcd_shadow *sh;
+    uint8_t c;
+
+    for (c = 0; c < ctx->ctrls; c++) {
+        sh = i2clcd_shadow_of(ctx, c);
+        if (sh->cgram_valid[slot] != 0xFF ||
+            memcmp(&sh->cgram[slot << 3], charmap, 8) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Every controller's shadow knows the row and it holds the value */
+static bool cgram_row_holds(i2clcd_t *ctx, uint8_t addr, uint8_t value)
+{
+    const struct i2clcd_shadow *sh;
+    uint8_t c;
+
+    for (c = 0; c < ctx->ctrls; c++) {
+        sh = i2clcd_shadow_of(ctx, c);
+        if (!((sh->cgram_valid[addr >> 3] >> (addr & 7)) & 1) ||
+            sh->cgram[addr] != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* One address command, then rows[first..last] in the counter's direction */
+static int write_cgram_run(i2clcd_t *ctx, uint8_t base, const uint8_t *rows,
+                           size_t first, size_t last)
+{
+    bool inc = (ctx->entry_mode & HD44780_ENTRY_INC) != 0;
+    size_t i;
+
+    if (i2clcd_command(ctx, HD44780_CMD_SET_CGRAM |
+                            (base + (inc ? first : last))) < 0) {
+        return -1;
+    }
+    for (i = 0; i <= last - first; i++) {
+        if (i2clcd_data(ctx, rows[inc ? first + i : last - i]) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Write the rows that differ from the shadow, from CGRAM address base on,
+ * and return the number of rows sent. Two or more unchanged rows are
+ * skipped with a new address command; one costs the same as the command,
+ * so it is rewritten instead.
+ */
+static int write_cgram_rows(i2clcd_t *ctx, uint8_t base, const uint8_t *rows,
+                            size_t len)
+{
+    size_t i, first = 0, last = 0;
+    bool open = false;
+    int sent = 0;
+
+    for (i = 0; i < len; i++) {
+        if (cgram_row_holds(ctx, (uint8_t)(base + i), rows[i])) {
+            continue;
+        }
+        if (open && i - last > 2) {
+            if (write_cgram_run(ctx, base, rows, first, last) < 0) {
+                return -1;
+            }
+            sent += (int)(last - first + 1);
+            open = false;
+        }
+        if (!open) {
+            first = i;
+            open = true;
+        }
+        last = i;
+    }
+
+    if (open) {
+        if (write_cgram_run(ctx, base, rows, first, last) < 0) {
+            return -1;
+        }
+        sent += (int)(last - first + 1);
+    }
+    return sent;
+}
+
+/*
+ * Every controller of a 40x4 panel gets the rows in the same strobes.
+ * Afterwards each controller's address counter goes back to the DDRAM
+ * address it held, so a following putc lands where it would have.
+ */
+int i2clcd_cgram_write(i2clcd_t *handle, uint8_t base, const uint8_t *rows,
+                       size_t len)
+{
+    const struct i2clcd_shadow *sh;
+    uint8_t target = handle->target;
+    uint8_t ddram[2] = { 0, 0 };
+    uint8_t c;
+    int sent;
+
+    for (c = 0; c < handle->ctrls; c++) {
+        sh = i2clcd_shadow_of(handle, c);
+        if (sh->addr_valid && !sh->addr_cgram) {
+            ddram[c] = sh->addr;
+        }
+    }
+
+    i2clcd_select(handle, I2CLCD_CTRL_ALL);
+    sent = write_cgram_rows(handle, base, rows, len);
+    if (sent == 0) {
+        i2clcd_select(handle, target);
+        return 0;
+    }
+
+    if (handle->ctrls == 1 || ddram[0] == ddram[1]) {
+        if (i2clcd_command(handle, HD44780_CMD_SET_DDRAM | ddram[0]) < 0) {
+            sent = -1;
+        }
+    } else {
+        for (c = 0; c < handle->ctrls; c++) {
+            i2clcd_select(handle, (uint8_t)(1u << c));
+            if (i2clcd_command(handle, HD44780_CMD_SET_DDRAM | ddram[c]) < 0) {
+                sent = -1;
+            }
+        }
+    }
+
+    i2clcd_select(handle, target);
+    return sent;
+}
+
 i2clcd_err_t i2clcd_create_char(i2clcd_t *handle, uint8_t location,
                                 const uint8_t charmap[8])
 {
-    int i;
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
 
     if (!handle) {
         return I2CLCD_ERR_NOT_INIT;
@@ -590,24 +1653,44 @@ i2clcd_err_t i2clcd_create_char(i2clcd_t *handle, uint8_t location,
         return I2CLCD_ERR_RANGE;
     }
 
-    /* Set CGRAM address */
-    if (i2clcd_command(handle, HD44780_CMD_SET_CGRAM | (location << 3)) < 0) {
-        return I2CLCD_ERR_WRITE;
+    t0 = i2clcd_monotonic_ns(handle);
+
+    i2clcd_batch_begin(handle);
+    if (i2clcd_cgram_write(handle, (uint8_t)(location << 3), charmap, 8) < 0) {
+        ret = I2CLCD_ERR_WRITE;
     }
+    return i2clcd_stats_api(handle, I2CLCD_API_CREATE_CHAR, t0,
+                            batch_result(handle, ret));
+}
 
-    /* Write character pattern (8 bytes) */
-    for (i = 0; i < 8; i++) {
-        if (i2clcd_data(handle, charmap[i]) < 0) {
-            return I2CLCD_ERR_WRITE;
-        }
+i2clcd_err_t i2clcd_create_chars(i2clcd_t *handle, uint8_t first,
+                                 uint8_t count, const uint8_t charmaps[][8])
+{
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
     }
 
-    /* Return to DDRAM mode */
-    if (i2clcd_command(handle, HD44780_CMD_SET_DDRAM) < 0) {
-        return I2CLCD_ERR_WRITE;
+    if (!charmaps && count > 0) {
+        return I2CLCD_ERR_INVALID_ARG;
     }
 
-    return I2CLCD_OK;
+    if (first > 7 || count > 8 - first) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+
+    i2clcd_batch_begin(handle);
+    if (count > 0 &&
+        i2clcd_cgram_write(handle, (uint8_t)(first << 3), &charmaps[0][0],
+                           (size_t)count * 8) < 0) {
+        ret = I2CLCD_ERR_WRITE;
+    }
+    return i2clcd_stats_api(handle, I2CLCD_API_CREATE_CHARS, t0,
+                            batch_result(handle, ret));
 }
 
 /*---------------------------------------------------------------------------
@@ -10,15 +10,19 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "i2clcd.h"
+#include "hd44780.h"
 
 /*---------------------------------------------------------------------------
  * PCF8574 Pin Mapping for HD44780
- * Common backpack configuration (active high enable, active high backlight)
+ * Common backpack configuration (active high enable, active high backlight).
+ * Other wirings are translated through struct i2clcd_wiring; this layout
+ * is also the logical one the emulator models internally.
  *---------------------------------------------------------------------------*/
 
 #define PCF8574_PIN_RS              (1 << 0)  /* P0: Register Select */
-#define PCF8574_PIN_RW              (1 << 1)  /* P1: Read/Write (tie low) */
+#define PCF8574_PIN_RW              (1 << 1)  /* P1: Read/Write */
 #define PCF8574_PIN_EN              (1 << 2)  /* P2: Enable */
 #define PCF8574_PIN_BL              (1 << 3)  /* P3: Backlight */
 #define PCF8574_PIN_D4              (1 << 4)  /* P4: Data bit 4 */
@@ -29,12 +33,275 @@
 /* Data nibble mask (upper 4 bits of PCF8574) */
 #define PCF8574_DATA_MASK           0xF0
 
+/*---------------------------------------------------------------------------
+ * MCP230xx Registers (MCP23017 with IOCON.BANK = 0, the power-on layout)
+ *---------------------------------------------------------------------------*/
+
+#define MCP23008_IODIR              0x00
+#define MCP23008_IOCON              0x05
+#define MCP23008_GPIO               0x09
+#define MCP23008_OLAT               0x0A
+#define MCP23008_NREGS              0x0B
+
+#define MCP23017_IODIRA             0x00
+#define MCP23017_IOCON              0x0A  /* Also at 0x0B */
+#define MCP23017_GPIOA              0x12
+#define MCP23017_OLATA              0x14
+#define MCP23017_NREGS              0x16
+
+/* Byte mode: the address pointer stays put (MCP23008) or toggles between
+ * the A and B register of a pair (MCP23017) */
+#define MCP230XX_IOCON_SEQOP        0x20
+
+/* IOCON.BANK = 1: port A registers at 0x00-0x0A, port B at 0x10-0x1A, and
+ * in byte mode the pointer stays put. IOCON is 0x05 here and GPINTENB
+ * (reset value 0) in the power-on layout, so writing 0 there selects
+ * BANK = 0 from either layout. */
+#define MCP23017_IOCON_BANK         0x80
+#define MCP23017_BANK1_IOCON        0x05
+#define MCP23017_BANK1_GPPUA        0x06
+#define MCP23017_BANK1_GPIOA        0x09
+#define MCP23017_BANK1_IODIRB       0x10
+#define MCP23017_BANK1_GPIOB        0x19
+#define MCP23017_BANK1_OLATB        0x1A
+
+/* RGB LCD plate: buttons (active low) and red/green (inverted) on GPA,
+ * blue (inverted) on GPB next to the LCD */
+#define PLATE_BUTTONS               0x1F
+#define PLATE_RED                   0x40
+#define PLATE_GREEN                 0x80
+#define PLATE_BLUE                  0x01
+
+/*---------------------------------------------------------------------------
+ * Backpack Wiring Tables
+ *---------------------------------------------------------------------------*/
+
+struct i2clcd_wiring {
+    uint8_t rs, rw, en;            /* Pin masks */
+    uint8_t bl[2];                 /* Backlight pin bits for off, on */
+    uint8_t data;                  /* D4-D7 pin mask */
+    int8_t  data_shift;            /* D4 port if D4-D7 are P(n)-P(n+3),
+                                      else -1 (no vector encoding) */
+    uint8_t nibble[16];            /* D7-D4 value to data pin bits */
+    uint8_t to_logical[256];       /* Pin levels to the default layout */
+    uint8_t to_physical[256];      /* Default layout to pin levels */
+    uint8_t encode[2][2][256][4];  /* [rs][backlight][byte]: EN high/low for
+                                      the high nibble, then the low nibble */
+};
+
+/* Compile a pin map (NULL for the default); returns -1 if it is invalid */
+int i2clcd_wiring_build(struct i2clcd_wiring *w, const i2clcd_pinmap_t *map);
+
+/* Pin map a configuration selects (NULL for the default) */
+const i2clcd_pinmap_t *i2clcd_config_pinmap(const i2clcd_config_t *config);
+
+/* Expand n HD44780 bytes into 4n PCF8574 bytes */
+void i2clcd_encode(const struct i2clcd_wiring *w, bool rs, bool backlight,
+                   const uint8_t *src, size_t n, uint8_t *out);
+
+/* Expand n bytes into 4n bytes of control/data port pairs (8-bit bus) */
+void i2clcd_encode8(const struct i2clcd_wiring *w, bool rs, bool backlight,
+                    const uint8_t *src, size_t n, uint8_t *out);
+
+/* Bit i set where a[i] != b[i]; n is at most 64 */
+uint64_t i2clcd_diff_mask(const uint8_t *a, const uint8_t *b, size_t n);
+
+/*---------------------------------------------------------------------------
+ * Bus Backends
+ * Backends form a stack: wrappers (such as tracing) forward to the backend
+ * below them, and the bottom one talks to hardware or to a model.
+ *---------------------------------------------------------------------------*/
+
+struct i2clcd_backend;
+
+struct i2clcd_backend_ops {
+    const char *name;
+    bool kernel;           /* Each transfer is a system call */
+    /* Write one transaction; 0 on success, -1 with errno set on failure */
+    int  (*write)(struct i2clcd_backend *be, const uint8_t *buf, size_t len);
+    /* Read one transaction; 0 on success, -1 with errno set on failure */
+    int  (*read)(struct i2clcd_backend *be, uint8_t *buf, size_t len);
+    /* Optional: write one transaction to another address on the same bus */
+    int  (*write_to)(struct i2clcd_backend *be, uint8_t addr,
+                     const uint8_t *buf, size_t len);
+    /* Optional: write the same bytes to several addresses in one combined
+     * transfer; returns how many leading addresses got them (naddrs on
+     * success), or -1 with errno set when the adapter cannot say */
+    int  (*write_many)(struct i2clcd_backend *be, const uint8_t *addrs,
+                       size_t naddrs, const uint8_t *buf, size_t len);
+    /* Optional: adapter timeout and retry count; 0 leaves a setting alone */
+    int  (*set_adapter)(struct i2clcd_backend *be, unsigned int timeout_ms,
+                        unsigned int retries);
+    /* Release this layer only (not the layers below it) */
+    void (*destroy)(struct i2clcd_backend *be);
+};
+
+/* Embedded as the first member of each backend's private structure */
+struct i2clcd_backend {
+    const struct i2clcd_backend_ops *ops;
+    struct i2clcd_backend *inner;  /* Wrapped backend, NULL at the bottom */
+};
+
+/*---------------------------------------------------------------------------
+ * Shadow State
+ * Copy of controller memory, maintained as commands and data go out
+ *---------------------------------------------------------------------------*/
+
+struct i2clcd_shadow {
+    uint8_t  ddram[HD44780_DDRAM_SIZE];           /* DDRAM contents */
+    uint8_t  ddram_valid[HD44780_DDRAM_SIZE / 8]; /* Known DDRAM cells */
+    uint8_t  cgram[HD44780_CGRAM_SIZE];           /* CGRAM contents */
+    uint8_t  cgram_valid[HD44780_CGRAM_SIZE / 8]; /* Known CGRAM rows */
+    uint8_t  addr;         /* Address counter */
+    bool     addr_cgram;   /* Address counter points into CGRAM */
+    bool     addr_valid;   /* Address counter position is known */
+};
+
+/* Controller target masks; a 40x4 panel has a second controller on E2 */
+#define I2CLCD_CTRL_E1              0x01
+#define I2CLCD_CTRL_E2              0x02
+#define I2CLCD_CTRL_ALL             0x03
+
+/*---------------------------------------------------------------------------
+ * Compositor State
+ * Back buffer plus frame pacing for coalesced updates
+ *---------------------------------------------------------------------------*/
+
+/* Per-priority bookkeeping */
+struct i2clcd_lane {
+    uint64_t since_ns[I2CLCD_MAX_ROWS]; /* Oldest unflushed write per row */
+    uint64_t latency_sum_ns;            /* Sum of latencies for the mean */
+    i2clcd_prio_stats_t stats;
+};
+
+struct i2clcd_compositor {
+    bool     enabled;      /* Text writes go to the back buffer */
+    uint8_t  back[I2CLCD_MAX_ROWS][I2CLCD_MAX_COLS]; /* Back buffer */
+    uint8_t  prio_map[I2CLCD_MAX_ROWS][I2CLCD_MAX_COLS]; /* Cell priority */
+    i2clcd_prio_t prio;    /* Priority of new writes */
+    struct i2clcd_lane lanes[I2CLCD_PRIO_COUNT];
+    uint8_t  dirty;        /* Rows modified since the last flush */
+    uint8_t  col;          /* Software cursor column */
+    uint8_t  row;          /* Software cursor row */
+    uint64_t period_ns;    /* Frame period */
+    uint64_t deadline_ns;  /* Next absolute frame deadline */
+    i2clcd_compositor_stats_t stats;
+    uint64_t jitter_sum_ns; /* Sum of flush lateness for the mean */
+};
+
+/*---------------------------------------------------------------------------
+ * Transmit Batching
+ *
+ * Between i2clcd_batch_begin() and i2clcd_batch_end(), PCF8574 bytes are
+ * collected and sent as multi-byte transactions. The per-nibble settle
+ * delays are skipped: at 400 kHz or slower, the two bus bytes between one
+ * enable falling edge and the next already exceed the 37 us execution time.
+ *---------------------------------------------------------------------------*/
+
+#define I2CLCD_TX_BUF_SIZE          256
+
+/*---------------------------------------------------------------------------
+ * Bus Budget (token bucket)
+ *---------------------------------------------------------------------------*/
+
+struct i2clcd_budget {
+    i2clcd_budget_config_t cfg;
+    int64_t  tokens_ns;    /* Bus time available; may go negative */
+    uint64_t refill_ns;    /* Time of last refill */
+    uint64_t last_end_ns;  /* End of the previous chunk */
+    i2clcd_budget_stats_t stats;
+};
+
+/*---------------------------------------------------------------------------
+ * I2C Multiplexer
+ *---------------------------------------------------------------------------*/
+
+#define TCA9548A_ADDR_MIN  0x70
+#define TCA9548A_ADDR_MAX  0x77
+#define TCA9548A_CHANNELS  8
+
+struct i2clcd_mux {
+    uint8_t  addr;         /* TCA9548A I2C address */
+    uint8_t  reg;          /* Channel mask last written */
+    bool     known;        /* reg matches the chip */
+    uint8_t  emu_reg;      /* Control register of an emulated chip */
+    i2clcd_mux_stats_t stats;
+};
+
+/*---------------------------------------------------------------------------
+ * Glyph Cache
+ *---------------------------------------------------------------------------*/
+
+#define I2CLCD_GLYPH_SLOTS  8
+
+struct i2clcd_glyphs {
+    uint32_t hash[I2CLCD_GLYPH_SLOTS]; /* Bitmap hash of the cached glyph */
+    uint64_t used[I2CLCD_GLYPH_SLOTS]; /* Tick of the last request, 0 = none */
+    uint64_t tick;         /* Request counter */
+    i2clcd_glyph_stats_t stats;
+};
+
+/*---------------------------------------------------------------------------
+ * Glyph Animation State
+ *---------------------------------------------------------------------------*/
+
+struct i2clcd_anim_slot {
+    uint8_t  frames[I2CLCD_ANIM_FRAMES_MAX][8];
+    uint8_t  count;        /* Frames in the sequence */
+    uint8_t  frame;        /* Frame last sent to CGRAM */
+    bool     loop;
+    uint64_t period_ns;    /* Time each frame is shown */
+    uint64_t next_ns;      /* Absolute deadline of the next frame */
+};
+
+struct i2clcd_anim {
+    struct i2clcd_anim_slot slots[I2CLCD_GLYPH_SLOTS];
+    uint8_t  active;       /* Mask of animated slots */
+    uint64_t epoch_ns;     /* Timeline origin shared by every slot */
+    i2clcd_anim_stats_t stats;
+};
+
+/*---------------------------------------------------------------------------
+ * Scrubber State
+ *---------------------------------------------------------------------------*/
+
+struct i2clcd_scrub {
+    i2clcd_scrub_config_t cfg;
+    bool     enabled;
+    uint16_t pos;          /* Next cell: CGRAM rows, then DDRAM */
+    uint64_t next_ns;      /* Earliest time for the next step */
+    i2clcd_scrub_stats_t stats;
+};
+
+/*---------------------------------------------------------------------------
+ * Button Polling State
+ *---------------------------------------------------------------------------*/
+
+#define I2CLCD_BUTTON_QUEUE         16
+#define I2CLCD_BUTTON_COUNT         5
+
+struct i2clcd_buttons {
+    i2clcd_buttons_config_t cfg;
+    bool     enabled;
+    bool     seeded;       /* First read done; held is meaningful */
+    size_t   max_xfer;     /* Longest display transaction, in bytes */
+    uint64_t next_ns;      /* When the next poll is due */
+    uint8_t  raw;          /* Pressed buttons in the last read */
+    uint8_t  held;         /* Debounced pressed buttons */
+    uint64_t since_ns[I2CLCD_BUTTON_COUNT]; /* Last raw change per button */
+    i2clcd_button_event_t queue[I2CLCD_BUTTON_QUEUE];
+    unsigned head;         /* Oldest queued event */
+    unsigned count;        /* Events queued */
+    i2clcd_buttons_stats_t stats;
+};
+
 /*---------------------------------------------------------------------------
  * LCD Context Structure (internal state)
  *---------------------------------------------------------------------------*/
 
 struct i2clcd_ctx {
-    int      fd;           /* I2C file descriptor */
+    struct i2clcd_backend *backend; /* Top of the backend stack */
+    bool     bus_syscalls; /* Bus transfers are system calls */
     uint8_t  i2c_addr;     /* PCF8574 I2C address */
     uint8_t  cols;         /* Number of columns */
     uint8_t  rows;         /* Number of rows */
@@ -42,15 +309,174 @@ struct i2clcd_ctx {
     uint8_t  entry_mode;   /* Entry mode register state */
     bool     backlight;    /* Current backlight state */
     uint8_t  line_addr[4]; /* DDRAM address for each line */
+    uint8_t  line_ctrl[4]; /* Controller driving each line */
+    uint8_t  ctrls;        /* Controllers on the panel (2 on a 40x4) */
+    uint8_t  target;       /* Controllers strobed (I2CLCD_CTRL_* mask) */
+    uint8_t  sel;          /* Controller whose shadow is in shadow */
+    uint8_t  en_sel;       /* Enable pins of the target controllers */
+    uint64_t busy_ns[2];   /* Per controller: end of the last instruction */
+    struct i2clcd_shadow     shadow;     /* Controller memory shadow */
+    struct i2clcd_shadow     shadow_alt; /* Other controller's (40x4) */
+    struct i2clcd_compositor compositor; /* Back buffer and pacing */
+    uint8_t  tx[I2CLCD_TX_BUF_SIZE]; /* Pending batched bytes */
+    size_t   tx_len;       /* Bytes in tx */
+    unsigned batch_depth;  /* Nesting level of i2clcd_batch_begin() */
+    bool     batch_failed; /* A batched transfer failed */
+    uint64_t batch_lag_ns; /* Budget delay added to the current batch */
+    i2clcd_budget_t *budget; /* Optional bus budget */
+    i2clcd_mux_t *mux;     /* Optional TCA9548A ahead of the backpack */
+    uint8_t  mux_channel;  /* Channel behind the mux */
+    char     bus[64];      /* i2c-dev path, groups handles in a mux flush */
+    i2clcd_clock_t clock;  /* Time source for delays and timestamps */
+    bool     clock_syscalls; /* Sleeps are system calls */
+    i2clcd_recovery_config_t recovery; /* Retry and resync policy */
+    bool     resync_pending; /* Controller may be out of step with shadow */
+    bool     recovering;   /* Inside a resync and replay */
+    i2clcd_hotplug_config_t hotplug; /* Disconnect detection policy */
+    bool     hotplug_on;   /* Hot-plug detection enabled */
+    bool     link_down;    /* Device stopped answering */
+    uint8_t  nack_count;   /* NACKed attempts in a row */
+    uint64_t probe_ns;     /* Time of the last probe */
+    uint8_t  pins;         /* Last byte written to the PCF8574 */
+    struct i2clcd_scrub scrub; /* Background refresh */
+    struct i2clcd_glyphs glyphs; /* CGRAM slot cache */
+    struct i2clcd_anim anim; /* CGRAM slot animations */
+    struct i2clcd_wiring wiring; /* Backpack pin map tables */
+    i2clcd_expander_t expander; /* I/O expander type */
+    bool     eight_bit;    /* 8-bit bus: bytes go out as port pairs */
+    uint8_t  color;        /* RGB plate backlight channels */
+    struct i2clcd_buttons buttons; /* RGB plate button polling */
+    i2clcd_stats_t stats;  /* Instrumentation counters */
 };
 
 /*---------------------------------------------------------------------------
  * Internal Function Prototypes
  *---------------------------------------------------------------------------*/
 
-/* Low-level I2C write */
+/* Create the backend selected by a configuration */
+i2clcd_err_t i2clcd_backend_create(const i2clcd_config_t *config,
+                                   struct i2clcd_backend **be);
+
+/* Create the in-memory expander + HD44780 model for a configuration */
+i2clcd_err_t i2clcd_backend_emu_create(const i2clcd_config_t *config,
+                                       struct i2clcd_backend **be);
+
+/* Create the MCP230xx register layer (on top of the current stack) */
+i2clcd_err_t i2clcd_backend_mcp_create(i2clcd_t *ctx,
+                                       i2clcd_expander_t expander,
+                                       struct i2clcd_backend **be);
+
+/* Create the TCA9548A channel-select layer (directly above the transport) */
+i2clcd_err_t i2clcd_backend_mux_create(i2clcd_t *ctx,
+                                       struct i2clcd_backend **be);
+
+/* Every controller's shadow holds this pattern in a CGRAM slot */
+bool i2clcd_cgram_holds(i2clcd_t *ctx, uint8_t slot, const uint8_t charmap[8]);
+
+/* Write the CGRAM rows from base on that differ from the shadow, then put
+ * the address counter back; returns the rows written or -1 */
+int i2clcd_cgram_write(i2clcd_t *ctx, uint8_t base, const uint8_t *rows,
+                       size_t len);
+
+/* Re-init and replay diverged mirror members; -1 if any is still out */
+int i2clcd_mirror_heal(i2clcd_t *ctx);
+
+/* RGB plate: cache the lit backlight channels; with defer, red and green
+ * wait for the next input read instead of going out now */
+int i2clcd_mcp_color(i2clcd_t *ctx, uint8_t color, bool defer);
+
+/* RGB plate: write the cached red/green latch and read the pressed
+ * buttons, in two transactions */
+int i2clcd_mcp_inputs(i2clcd_t *ctx, uint8_t *pressed);
+
+/* Wrap the current backend stack with a new layer */
+void i2clcd_backend_push(i2clcd_t *ctx, struct i2clcd_backend *be);
+
+/* Find the layer using the given ops, or NULL */
+struct i2clcd_backend *i2clcd_backend_find(i2clcd_t *ctx,
+                                           const struct i2clcd_backend_ops *ops);
+
+/* Wrap only the transport (the bottom of the stack) with a new layer */
+void i2clcd_backend_push_bottom(i2clcd_t *ctx, struct i2clcd_backend *be);
+
+/* Unlink one layer from the stack and destroy it */
+void i2clcd_backend_remove(i2clcd_t *ctx, struct i2clcd_backend *be);
+
+/* Destroy the whole backend stack */
+void i2clcd_backend_destroy_all(i2clcd_t *ctx);
+
+/* Resync (or re-init after power loss) and replay shadow state; returns -1
+ * if it could not complete */
+int i2clcd_recovery_run(i2clcd_t *ctx, bool power_on);
+
+/* Mark the device as disconnected and notify the application */
+void i2clcd_link_lost(i2clcd_t *ctx);
+
+/* HD44780 power-on initialization sequence; -1 if a write failed */
+int i2clcd_init_sequence(i2clcd_t *ctx);
+
+/* Low-level I2C write (queued while batching) */
 int i2clcd_i2c_write_byte(i2clcd_t *ctx, uint8_t byte);
 
+/* Queue or send bytes that must share one transaction */
+int i2clcd_i2c_write(i2clcd_t *ctx, const uint8_t *buf, size_t len);
+
+/* Set the control pins (and, on an 8-bit bus, the data port) */
+int i2clcd_write_pins(i2clcd_t *ctx, uint8_t pins);
+
+/* Send bytes to the PCF8574, chunked and paced by the budget */
+int i2clcd_bus_write(i2clcd_t *ctx, const uint8_t *buf, size_t len);
+
+/* Read bytes from the PCF8574 (one transaction, paced by the budget) */
+int i2clcd_bus_read(i2clcd_t *ctx, uint8_t *buf, size_t len);
+
+/* A transaction a backend layer sends on its own through the layer below:
+ * paced by the budget and counted in the handle's stats like any other */
+int i2clcd_layer_write(i2clcd_t *ctx, struct i2clcd_backend *be,
+                       const uint8_t *buf, size_t len);
+int i2clcd_layer_read(i2clcd_t *ctx, struct i2clcd_backend *be,
+                      uint8_t *buf, size_t len);
+
+/* Count len bytes a layer adds to a transaction that is already paid for */
+void i2clcd_layer_extra(i2clcd_t *ctx, size_t len);
+
+/* True if the backpack can read controller memory (PCF8574, one controller) */
+bool i2clcd_can_read(const i2clcd_t *ctx);
+
+/* Read controller memory through the RW pin; len bytes from addr on */
+int i2clcd_mem_read(i2clcd_t *ctx, bool cgram, uint8_t addr, uint8_t *buf,
+                    size_t len);
+
+/* Start collecting bus bytes into multi-byte transactions */
+void i2clcd_batch_begin(i2clcd_t *ctx);
+
+/* Send collected bytes; returns -1 if any batched transfer failed */
+int i2clcd_batch_end(i2clcd_t *ctx);
+
+/* Wait until a chunk of len bytes may go out; returns time waited */
+uint64_t i2clcd_budget_acquire(i2clcd_t *ctx, size_t len);
+
+/* Account for a chunk that has just finished */
+void i2clcd_budget_release(i2clcd_t *ctx);
+
+/* Pay for len more bytes inside a chunk already acquired */
+void i2clcd_budget_charge(i2clcd_t *ctx, size_t len);
+
+/* Check without waiting whether a chunk of len bytes may go out now */
+bool i2clcd_budget_ready(i2clcd_t *ctx, size_t len);
+
+/* Run a scrub step if one is due; returns -1 on bus failure */
+int i2clcd_scrub_run(i2clcd_t *ctx);
+
+/* Read the buttons if a poll is due; read errors only reach the stats */
+void i2clcd_buttons_run(i2clcd_t *ctx);
+
+/* Turn the animation frames that are due; returns -1 on bus failure */
+int i2clcd_anim_run(i2clcd_t *ctx);
+
+/* Deadline of the next animation frame, or UINT64_MAX if none */
+uint64_t i2clcd_anim_next_ns(const i2clcd_t *ctx);
+
 /* Write a nibble to the LCD (4-bit mode) */
 int i2clcd_write_nibble(i2clcd_t *ctx, uint8_t nibble, bool rs);
 
@@ -63,13 +489,72 @@ int i2clcd_command(i2clcd_t *ctx, uint8_t cmd);
 /* Send data to LCD */
 int i2clcd_data(i2clcd_t *ctx, uint8_t data);
 
+/* Send a run of data bytes; inside a batch they are encoded in bulk */
+int i2clcd_data_run(i2clcd_t *ctx, const uint8_t *data, size_t len);
+
+/* Function set command for the handle's bus width (2-line, 5x8 dots) */
+uint8_t i2clcd_function_set(const i2clcd_t *ctx);
+
 /* Update display control register */
 int i2clcd_update_display_ctrl(i2clcd_t *ctx);
 
-/* Microsecond delay (portable) */
-void i2clcd_delay_us(unsigned int us);
+/* Send a command to every controller, whatever the current target */
+int i2clcd_command_all(i2clcd_t *ctx, uint8_t cmd);
+
+/* Strobe a mask of controllers from now on; a single target's shadow
+ * becomes ctx->shadow */
+void i2clcd_select(i2clcd_t *ctx, uint8_t target);
+
+/* Target the controller driving a line, moving a visible cursor there */
+int i2clcd_select_line(i2clcd_t *ctx, uint8_t line);
+
+/* Shadow of one controller */
+struct i2clcd_shadow *i2clcd_shadow_of(i2clcd_t *ctx, uint8_t ctrl);
+
+/* Shadow of the controller driving a line */
+const struct i2clcd_shadow *i2clcd_line_shadow(const i2clcd_t *ctx,
+                                               uint8_t line);
+
+/* Let the instruction just sent execute: a single controller is waited
+ * for now, a dual panel's only when it is next strobed */
+void i2clcd_settle(i2clcd_t *ctx, unsigned int us);
+
+/* Time until the target controllers are all free (0 if they are now) */
+uint64_t i2clcd_busy_ns(const i2clcd_t *ctx, uint8_t target);
+
+/* Microsecond delay on the handle's clock */
+void i2clcd_delay_us(i2clcd_t *ctx, unsigned int us);
 
 /* Millisecond delay */
-void i2clcd_delay_ms(unsigned int ms);
+void i2clcd_delay_ms(i2clcd_t *ctx, unsigned int ms);
+
+/* Monotonic time in nanoseconds on the handle's clock */
+uint64_t i2clcd_monotonic_ns(const i2clcd_t *ctx);
+
+/* Sleep until an absolute deadline on the handle's clock */
+void i2clcd_sleep_until_ns(i2clcd_t *ctx, uint64_t deadline_ns);
+
+/* Forget everything known about controller memory */
+void i2clcd_shadow_reset(i2clcd_t *ctx);
+
+/* Record one call of a public entry point started at t0; returns ret */
+i2clcd_err_t i2clcd_stats_api(i2clcd_t *ctx, i2clcd_api_t api, uint64_t t0,
+                              i2clcd_err_t ret);
+
+/* Count one instruction or data byte sent to the controller */
+void i2clcd_stats_command(i2clcd_t *ctx, uint8_t cmd, bool rs);
+
+/* Write back buffer lanes down to min_prio to the display (minimal diff) */
+int i2clcd_compositor_commit(i2clcd_t *ctx, i2clcd_prio_t min_prio);
+
+/* Flush high-priority cells immediately if writing at high priority */
+i2clcd_err_t i2clcd_compositor_expedite(i2clcd_t *ctx);
+
+/* Back buffer writes used by the text API while compositing */
+void i2clcd_compositor_move(i2clcd_t *ctx, uint8_t col, uint8_t row);
+void i2clcd_compositor_write(i2clcd_t *ctx, const char *text, size_t len);
+void i2clcd_compositor_set_line(i2clcd_t *ctx, uint8_t line,
+                                const char *text);
+void i2clcd_compositor_clear(i2clcd_t *ctx, int line);
 
 #endif /* I2CLCD_INTERNAL_H */
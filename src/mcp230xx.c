@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * mcp230xx.c - MCP23008/MCP23017 register layer
+ *
+ * Everything above this layer writes port levels as a PCF8574 would take
+ * them (control/data pairs on the MCP23017). This layer sets the expander
+ * up and prefixes each transaction with the GPIO register address. In byte
+ * mode the pointer then stays on GPIO (MCP23008) or alternates GPIOA and
+ * GPIOB (MCP23017), so a transaction can carry any number of updates.
+ *
+ * The RGB plate runs its MCP23017 with IOCON.BANK = 1 so the pointer stays
+ * on GPIOB, the LCD port. The layer owns the backlight colour: it clears
+ * blue in LCD bytes when blue is off, and keeps red and green in the GPIOA
+ * latch, which it rewrites when the colour or the backlight changes.
+ *
+ * Register setup, latch reads and colour updates are transactions of this
+ * layer's own; they and the register prefix are charged to the handle's
+ * budget and stats like the port bytes from above.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+struct mcp_backend {
+    struct i2clcd_backend base;
+    i2clcd_t *ctx;         /* Handle charged for the layer's own traffic */
+    bool     wide;         /* MCP23017 */
+    bool     plate;        /* RGB plate: LCD on GPB, BANK = 1 */
+    bool     ready;        /* Registers set up since the last power-on */
+    uint8_t  color;        /* Lit channels (I2CLCD_COLOR_*) */
+    bool     lit;          /* Backlight on in the last LCD byte */
+    uint8_t  gpa;          /* GPIOA latch last written (plate) */
+    bool     defer;        /* Red/green wait for the next input read */
+    uint8_t  buf[1 + I2CLCD_TX_BUF_SIZE];
+};
+
+static int reg_write(struct mcp_backend *mcp, uint8_t reg, uint8_t value)
+{
+    uint8_t msg[2] = { reg, value };
+
+    return i2clcd_layer_write(mcp->ctx, mcp->base.inner, msg, sizeof(msg));
+}
+
+/* Red and green are inverted; inputs ignore their latch bits */
+static uint8_t plate_gpa(const struct mcp_backend *mcp)
+{
+    uint8_t gpa = PLATE_RED | PLATE_GREEN;
+
+    if (mcp->lit && (mcp->color & I2CLCD_COLOR_RED)) {
+        gpa &= (uint8_t)~PLATE_RED;
+    }
+    if (mcp->lit && (mcp->color & I2CLCD_COLOR_GREEN)) {
+        gpa &= (uint8_t)~PLATE_GREEN;
+    }
+    return gpa;
+}
+
+static int plate_setup(struct mcp_backend *mcp)
+{
+    uint8_t gpa = plate_gpa(mcp);
+
+    /* GPA0-4 are pulled-up button inputs, everything else drives */
+    if (reg_write(mcp, MCP23017_BANK1_IOCON, 0x00) < 0 ||
+        reg_write(mcp, MCP23017_IOCON,
+                  MCP23017_IOCON_BANK | MCP230XX_IOCON_SEQOP) < 0 ||
+        reg_write(mcp, MCP23017_IODIRA, PLATE_BUTTONS) < 0 ||
+        reg_write(mcp, MCP23017_BANK1_GPPUA, PLATE_BUTTONS) < 0 ||
+        reg_write(mcp, MCP23017_BANK1_GPIOA, gpa) < 0 ||
+        reg_write(mcp, MCP23017_BANK1_IODIRB, 0x00) < 0) {
+        return -1;
+    }
+
+    mcp->gpa = gpa;
+    mcp->ready = true;
+    return 0;
+}
+
+/* Byte mode, all pins outputs; the power-on defaults are SEQOP=0, inputs */
+static int mcp_setup(struct mcp_backend *mcp)
+{
+    struct i2clcd_backend *inner = mcp->base.inner;
+    uint8_t iodir[3] = { MCP23017_IODIRA, 0x00, 0x00 };
+
+    if (mcp->plate) {
+        return plate_setup(mcp);
+    }
+
+    /* A previous user may have left the MCP23017 in BANK = 1 */
+    if (mcp->wide && reg_write(mcp, MCP23017_BANK1_IOCON, 0x00) < 0) {
+        return -1;
+    }
+
+    if (reg_write(mcp, mcp->wide ? MCP23017_IOCON : MCP23008_IOCON,
+                  MCP230XX_IOCON_SEQOP) < 0 ||
+        i2clcd_layer_write(mcp->ctx, inner, iodir, mcp->wide ? 3 : 2) < 0) {
+        return -1;
+    }
+
+    mcp->ready = true;
+    return 0;
+}
+
+/* Track the backlight in LCD bytes and apply the colour's blue channel */
+static void plate_filter(struct mcp_backend *mcp, uint8_t *buf, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        mcp->lit = !(buf[i] & PLATE_BLUE);
+        if (!(mcp->color & I2CLCD_COLOR_BLUE)) {
+            buf[i] |= PLATE_BLUE;
+        }
+    }
+}
+
+static int mcp_write(struct i2clcd_backend *be, const uint8_t *buf, size_t len)
+{
+    struct mcp_backend *mcp = (struct mcp_backend *)be;
+    bool first = true;
+    size_t chunk;
+
+    if (!mcp->ready && mcp_setup(mcp) < 0) {
+        return -1;
+    }
+
+    if (mcp->plate) {
+        mcp->buf[0] = MCP23017_BANK1_GPIOB;
+    } else {
+        mcp->buf[0] = mcp->wide ? MCP23017_GPIOA : MCP23008_GPIO;
+    }
+    while (len > 0) {
+        chunk = len < I2CLCD_TX_BUF_SIZE ? len : I2CLCD_TX_BUF_SIZE;
+        memcpy(mcp->buf + 1, buf, chunk);
+        if (mcp->plate) {
+            plate_filter(mcp, mcp->buf + 1, chunk);
+        }
+
+        /* A failed transfer may mean the expander reset; set it up again */
+        if (be->inner->ops->write(be->inner, mcp->buf, chunk + 1) < 0) {
+            mcp->ready = false;
+            return -1;
+        }
+
+        /* The caller paid for one transaction of port bytes; a split
+         * adds a transaction (address and prefix) per extra piece */
+        i2clcd_layer_extra(mcp->ctx, first ? 1 : 2);
+        if (!first) {
+            mcp->ctx->stats.xfers++;
+            if (mcp->ctx->bus_syscalls) {
+                mcp->ctx->stats.syscalls++;
+            }
+        }
+        first = false;
+        buf += chunk;
+        len -= chunk;
+    }
+
+    /* Red and green follow the backlight switch straight away */
+    if (mcp->plate && !mcp->defer && plate_gpa(mcp) != mcp->gpa) {
+        if (reg_write(mcp, MCP23017_BANK1_GPIOA, plate_gpa(mcp)) < 0) {
+            mcp->ready = false;
+            return -1;
+        }
+        mcp->gpa = plate_gpa(mcp);
+    }
+
+    return 0;
+}
+
+/* Report output latches; a power-on reset reads as all pins high, the way
+ * a freshly reset PCF8574 does */
+static int mcp_read(struct i2clcd_backend *be, uint8_t *buf, size_t len)
+{
+    struct mcp_backend *mcp = (struct mcp_backend *)be;
+    struct i2clcd_backend *inner = be->inner;
+    uint8_t reg = MCP23017_IODIRA;
+    uint8_t iodir;
+
+    if (i2clcd_layer_write(mcp->ctx, inner, &reg, 1) < 0 ||
+        i2clcd_layer_read(mcp->ctx, inner, &iodir, 1) < 0) {
+        mcp->ready = false;
+        return -1;
+    }
+
+    if (iodir == 0xFF) {
+        mcp->ready = false;
+        memset(buf, 0xFF, len);
+        return 0;
+    }
+
+    if (mcp->plate) {
+        reg = MCP23017_BANK1_OLATB;
+    } else {
+        reg = mcp->wide ? MCP23017_OLATA : MCP23008_OLAT;
+    }
+    /* The read itself is the caller's transaction */
+    if (i2clcd_layer_write(mcp->ctx, inner, &reg, 1) < 0 ||
+        inner->ops->read(inner, buf, len) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void mcp_destroy(struct i2clcd_backend *be)
+{
+    free(be);
+}
+
+static const struct i2clcd_backend_ops mcp_ops = {
+    .name    = "mcp230xx",
+    .write   = mcp_write,
+    .read    = mcp_read,
+    .destroy = mcp_destroy,
+};
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_backend_mcp_create(i2clcd_t *ctx,
+                                       i2clcd_expander_t expander,
+                                       struct i2clcd_backend **be)
+{
+    struct mcp_backend *mcp;
+
+    mcp = calloc(1, sizeof(*mcp));
+    if (!mcp) {
+        return I2CLCD_ERR_NOMEM;
+    }
+
+    mcp->base.ops = &mcp_ops;
+    mcp->ctx = ctx;
+    mcp->plate = (expander == I2CLCD_EXPANDER_RGB_PLATE);
+    mcp->wide = (expander == I2CLCD_EXPANDER_MCP23017) || mcp->plate;
+    mcp->color = I2CLCD_COLOR_WHITE;
+
+    *be = &mcp->base;
+    return I2CLCD_OK;
+}
+
+static struct mcp_backend *find_plate(i2clcd_t *ctx)
+{
+    struct mcp_backend *mcp;
+
+    mcp = (struct mcp_backend *)i2clcd_backend_find(ctx, &mcp_ops);
+    return (mcp && mcp->plate) ? mcp : NULL;
+}
+
+int i2clcd_mcp_color(i2clcd_t *ctx, uint8_t color, bool defer)
+{
+    struct mcp_backend *mcp = find_plate(ctx);
+
+    if (!mcp) {
+        return -1;
+    }
+
+    mcp->color = color;
+    mcp->defer = defer;
+
+    /* Setup writes the latch anyway */
+    if (defer || !mcp->ready || plate_gpa(mcp) == mcp->gpa) {
+        return 0;
+    }
+
+    if (reg_write(mcp, MCP23017_BANK1_GPIOA, plate_gpa(mcp)) < 0) {
+        mcp->ready = false;
+        return -1;
+    }
+    mcp->gpa = plate_gpa(mcp);
+    return 0;
+}
+
+int i2clcd_mcp_inputs(i2clcd_t *ctx, uint8_t *pressed)
+{
+    struct mcp_backend *mcp = find_plate(ctx);
+    struct i2clcd_backend *inner;
+    uint8_t gpa, level;
+
+    if (!mcp) {
+        return -1;
+    }
+    inner = mcp->base.inner;
+
+    if (!mcp->ready && mcp_setup(mcp) < 0) {
+        return -1;
+    }
+
+    /* Addressing GPIOA for the read also refreshes red and green; both
+     * transactions wait for the budget like the LCD's own */
+    gpa = plate_gpa(mcp);
+    if (reg_write(mcp, MCP23017_BANK1_GPIOA, gpa) < 0 ||
+        i2clcd_layer_read(ctx, inner, &level, 1) < 0) {
+        mcp->ready = false;
+        return -1;
+    }
+
+    mcp->gpa = gpa;
+    *pressed = (uint8_t)~level & PLATE_BUTTONS;
+    return 0;
+}
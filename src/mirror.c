@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * mirror.c - Encode-once fan-out to mirrored panels
+ *
+ * The mirror layer wraps the transport. Everything above it, from the
+ * shadow diff to the port-state encoding, runs once for the handle; the
+ * layer copies each transaction that reached the handle's own backpack to
+ * the in-step members with write_many calls, as few as the budget allows. A member is only ever
+ * written after the handle's copy succeeded, so the handle's retries never
+ * duplicate bytes on a member. Healing replays the handle's shadow through
+ * the normal recovery path with the layer narrowed to one member.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+struct mirror_member {
+    uint8_t  addr;
+    bool     diverged;     /* Missed bytes; waits for a heal */
+};
+
+struct mirror_backend {
+    struct i2clcd_backend base;
+    i2clcd_t *ctx;         /* Handle charged for member transfers */
+    struct mirror_member members[I2CLCD_MIRROR_MAX];
+    uint8_t  count;
+    int      solo;         /* Member being healed on its own, or -1 */
+    i2clcd_mirror_stats_t stats;
+};
+
+/*---------------------------------------------------------------------------
+ * Mirror Layer
+ *---------------------------------------------------------------------------*/
+
+/* Members per combined transfer: the budget's transaction limit bounds
+ * the bus time one transfer may hold, so large fan-outs go in groups */
+static size_t group_size(const i2clcd_t *ctx, size_t len, size_t n)
+{
+    size_t max = n;
+
+    if (ctx->budget && ctx->budget->cfg.max_xfer_bytes > 0) {
+        max = ctx->budget->cfg.max_xfer_bytes / len;
+        if (max == 0) {
+            max = 1;
+        }
+    }
+    return max < n ? max : n;
+}
+
+/* One combined transfer; members it did not reach are marked diverged */
+static void fan_out(struct mirror_backend *mb, const unsigned int *idx,
+                    size_t n, const uint8_t *buf, size_t len)
+{
+    struct i2clcd_backend *inner = mb->base.inner;
+    i2clcd_t *ctx = mb->ctx;
+    uint8_t addrs[I2CLCD_MIRROR_MAX];
+    uint64_t wait_ns;
+    size_t i;
+    int done;
+
+    for (i = 0; i < n; i++) {
+        addrs[i] = mb->members[idx[i]].addr;
+    }
+
+    /* The members' bytes cost bus time like the handle's own */
+    if (ctx->budget) {
+        wait_ns = i2clcd_budget_acquire(ctx, n * len);
+        if (wait_ns > 0) {
+            ctx->stats.sleeps++;
+            ctx->stats.sleep_ns += wait_ns;
+            ctx->stats.syscalls++;
+        }
+    }
+
+    done = inner->ops->write_many(inner, addrs, n, buf, len);
+
+    if (ctx->budget) {
+        i2clcd_budget_release(ctx);
+    }
+    if (ctx->bus_syscalls) {
+        ctx->stats.syscalls++;
+    }
+
+    /* Messages after the last one the adapter confirms may be lost */
+    if (done < 0) {
+        done = 0;
+    }
+    for (i = (size_t)done; i < n; i++) {
+        mb->members[idx[i]].diverged = true;
+    }
+
+    if ((size_t)done < n) {
+        mb->stats.failures++;
+    } else {
+        mb->stats.fanouts++;
+    }
+    ctx->stats.xfers += (uint64_t)done;
+    ctx->stats.bytes += (uint64_t)done * len;
+}
+
+static int mirror_write(struct i2clcd_backend *be, const uint8_t *buf,
+                        size_t len)
+{
+    struct mirror_backend *mb = (struct mirror_backend *)be;
+    struct i2clcd_backend *inner = be->inner;
+    unsigned int idx[I2CLCD_MIRROR_MAX];
+    size_t i, at, group, n = 0;
+
+    if (mb->solo >= 0) {
+        return inner->ops->write_to(inner, mb->members[mb->solo].addr,
+                                    buf, len);
+    }
+
+    if (inner->ops->write(inner, buf, len) < 0) {
+        return -1;
+    }
+
+    for (i = 0; i < mb->count; i++) {
+        if (!mb->members[i].diverged) {
+            idx[n++] = (unsigned int)i;
+        }
+    }
+    if (n == 0 || len == 0) {
+        return 0;
+    }
+
+    /* The budget's gap is left before each group, the handle's included */
+    if (mb->ctx->budget) {
+        i2clcd_budget_release(mb->ctx);
+    }
+
+    group = group_size(mb->ctx, len, n);
+    for (at = 0; at < n; at += group) {
+        fan_out(mb, &idx[at], n - at < group ? n - at : group, buf, len);
+    }
+    return 0;
+}
+
+/* Reads come from the handle's backpack; a heal never reads */
+static int mirror_read(struct i2clcd_backend *be, uint8_t *buf, size_t len)
+{
+    struct mirror_backend *mb = (struct mirror_backend *)be;
+
+    if (mb->solo >= 0) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    return be->inner->ops->read(be->inner, buf, len);
+}
+
+/* Mux selects pass straight through */
+static int mirror_write_to(struct i2clcd_backend *be, uint8_t addr,
+                           const uint8_t *buf, size_t len)
+{
+    return be->inner->ops->write_to(be->inner, addr, buf, len);
+}
+
+static void mirror_destroy(struct i2clcd_backend *be)
+{
+    free(be);
+}
+
+static const struct i2clcd_backend_ops mirror_ops = {
+    .name    = "mirror",
+    .write   = mirror_write,
+    .read    = mirror_read,
+    .write_to = mirror_write_to,
+    .destroy = mirror_destroy,
+};
+
+static struct mirror_backend *find_mirror(i2clcd_t *ctx)
+{
+    return (struct mirror_backend *)i2clcd_backend_find(ctx, &mirror_ops);
+}
+
+/*
+ * Re-run init and replay the shadow on one member. The handle's own link
+ * and resync state must not see the member's errors.
+ */
+static int heal(struct mirror_backend *mb, unsigned int i)
+{
+    i2clcd_t *ctx = mb->ctx;
+    bool resync_pending = ctx->resync_pending;
+    uint8_t nack_count = ctx->nack_count;
+    bool hotplug_on = ctx->hotplug_on;
+    int ret;
+
+    mb->solo = (int)i;
+    ctx->hotplug_on = false;
+    ret = i2clcd_recovery_run(ctx, true);
+    ctx->hotplug_on = hotplug_on;
+    ctx->nack_count = nack_count;
+    ctx->resync_pending = resync_pending;
+    mb->solo = -1;
+
+    if (ret < 0) {
+        return -1;
+    }
+
+    mb->members[i].diverged = false;
+    mb->stats.heals++;
+    return 0;
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+int i2clcd_mirror_heal(i2clcd_t *ctx)
+{
+    struct mirror_backend *mb = find_mirror(ctx);
+    unsigned int i;
+    int ret = 0;
+
+    if (!mb || ctx->recovering) {
+        return 0;
+    }
+
+    for (i = 0; i < mb->count; i++) {
+        if (!mb->members[i].diverged) {
+            continue;
+        }
+        /* Writes through a handle that is gone reach nobody */
+        if (ctx->link_down || heal(mb, i) < 0) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_mirror_add(i2clcd_t *handle, uint8_t addr)
+{
+    struct mirror_backend *mb;
+    unsigned int i;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (handle->expander != I2CLCD_EXPANDER_PCF8574) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    if (addr == handle->i2c_addr) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    mb = find_mirror(handle);
+    if (mb) {
+        for (i = 0; i < mb->count; i++) {
+            if (mb->members[i].addr == addr) {
+                return I2CLCD_ERR_INVALID_ARG;
+            }
+        }
+        if (mb->count >= I2CLCD_MIRROR_MAX) {
+            return I2CLCD_ERR_RANGE;
+        }
+    } else {
+        mb = calloc(1, sizeof(*mb));
+        if (!mb) {
+            return I2CLCD_ERR_NOMEM;
+        }
+        mb->base.ops = &mirror_ops;
+        mb->ctx = handle;
+        mb->solo = -1;
+
+        /* Below any mux layer, so one select covers the whole fan-out */
+        i2clcd_backend_push_bottom(handle, &mb->base);
+    }
+
+    /* A member joins in whatever state it was in */
+    i = mb->count++;
+    mb->members[i].addr = addr;
+    mb->members[i].diverged = true;
+
+    if (heal(mb, i) < 0) {
+        return I2CLCD_ERR_NODEV;
+    }
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_mirror_remove(i2clcd_t *handle, uint8_t addr)
+{
+    struct mirror_backend *mb;
+    unsigned int i;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    mb = find_mirror(handle);
+    for (i = 0; mb && i < mb->count; i++) {
+        if (mb->members[i].addr == addr) {
+            memmove(&mb->members[i], &mb->members[i + 1],
+                    (mb->count - i - 1) * sizeof(mb->members[0]));
+            mb->count--;
+            return I2CLCD_OK;
+        }
+    }
+
+    return I2CLCD_ERR_INVALID_ARG;
+}
+
+i2clcd_err_t i2clcd_mirror_sync(i2clcd_t *handle)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (i2clcd_mirror_heal(handle) < 0) {
+        return I2CLCD_ERR_NODEV;
+    }
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_mirror_stats(i2clcd_t *handle,
+                                 i2clcd_mirror_stats_t *stats)
+{
+    struct mirror_backend *mb;
+    unsigned int i;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    mb = find_mirror(handle);
+    if (!mb) {
+        memset(stats, 0, sizeof(*stats));
+        return I2CLCD_OK;
+    }
+
+    *stats = mb->stats;
+    stats->members = mb->count;
+    stats->diverged = 0;
+    for (i = 0; i < mb->count; i++) {
+        stats->diverged += mb->members[i].diverged;
+    }
+    return I2CLCD_OK;
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * mux.c - TCA9548A channel selection and channel-grouped flushes
+ *
+ * The select layer sits directly above the transport, so everything the
+ * handle sends (MCP230xx register writes included) reaches the backpack
+ * through its channel. The mux object is shared by every handle behind
+ * the chip and remembers the control register it last wrote; a layer only
+ * writes it when another channel is open. After any failure the register
+ * is treated as unknown, since the chip may have been reset.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * Channel Select Layer
+ *---------------------------------------------------------------------------*/
+
+struct mux_backend {
+    struct i2clcd_backend base;
+    i2clcd_t *ctx;         /* Handle charged for select transactions */
+    i2clcd_mux_t *mux;
+    uint8_t  mask;         /* Control register value for our channel */
+};
+
+static int mux_select(struct mux_backend *mb)
+{
+    struct i2clcd_backend *inner = mb->base.inner;
+    i2clcd_mux_t *mux = mb->mux;
+    i2clcd_t *ctx = mb->ctx;
+
+    if (mux->known && mux->reg == mb->mask) {
+        mux->stats.skipped++;
+        return 0;
+    }
+
+    if (!inner->ops->write_to) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    /* Its own transaction: the TCA9548A switches on the STOP */
+    mux->known = false;
+    if (inner->ops->write_to(inner, mux->addr, &mb->mask, 1) < 0) {
+        mux->stats.failed++;
+        return -1;
+    }
+    mux->reg = mb->mask;
+    mux->known = true;
+    mux->stats.selects++;
+
+    ctx->stats.xfers++;
+    ctx->stats.bytes++;
+    if (ctx->bus_syscalls) {
+        ctx->stats.syscalls++;
+    }
+    return 0;
+}
+
+static int mux_write(struct i2clcd_backend *be, const uint8_t *buf, size_t len)
+{
+    struct mux_backend *mb = (struct mux_backend *)be;
+
+    if (mux_select(mb) < 0) {
+        return -1;
+    }
+    if (be->inner->ops->write(be->inner, buf, len) < 0) {
+        mb->mux->known = false;
+        return -1;
+    }
+    return 0;
+}
+
+static int mux_read(struct i2clcd_backend *be, uint8_t *buf, size_t len)
+{
+    struct mux_backend *mb = (struct mux_backend *)be;
+
+    if (mux_select(mb) < 0) {
+        return -1;
+    }
+    if (be->inner->ops->read(be->inner, buf, len) < 0) {
+        mb->mux->known = false;
+        return -1;
+    }
+    return 0;
+}
+
+static void mux_destroy(struct i2clcd_backend *be)
+{
+    free(be);
+}
+
+static const struct i2clcd_backend_ops mux_ops = {
+    .name    = "tca9548a",
+    .write   = mux_write,
+    .read    = mux_read,
+    .destroy = mux_destroy,
+};
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_backend_mux_create(i2clcd_t *ctx,
+                                       struct i2clcd_backend **be)
+{
+    struct mux_backend *mb;
+
+    mb = calloc(1, sizeof(*mb));
+    if (!mb) {
+        return I2CLCD_ERR_NOMEM;
+    }
+
+    mb->base.ops = &mux_ops;
+    mb->ctx = ctx;
+    mb->mux = ctx->mux;
+    mb->mask = (uint8_t)(1u << ctx->mux_channel);
+
+    *be = &mb->base;
+    return I2CLCD_OK;
+}
+
+/*---------------------------------------------------------------------------
+ * Flush Scheduling
+ *---------------------------------------------------------------------------*/
+
+/* Handles whose channel is already open go first, then other channels,
+ * then handles on plain (or kernel-muxed) buses */
+static int flush_rank(const i2clcd_t *h)
+{
+    if (!h->mux) {
+        return 2;
+    }
+    if (h->mux->known && h->mux->reg == (1u << h->mux_channel)) {
+        return 0;
+    }
+    return 1;
+}
+
+static int flush_cmp(const i2clcd_t *a, const i2clcd_t *b)
+{
+    int ra = flush_rank(a), rb = flush_rank(b);
+
+    if (ra != rb) {
+        return ra - rb;
+    }
+    if (a->mux != b->mux) {
+        return (uintptr_t)a->mux < (uintptr_t)b->mux ? -1 : 1;
+    }
+    if (a->mux_channel != b->mux_channel) {
+        return (int)a->mux_channel - (int)b->mux_channel;
+    }
+    return strcmp(a->bus, b->bus);
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_mux_create(uint8_t addr, i2clcd_mux_t **mux)
+{
+    if (!mux) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (addr < TCA9548A_ADDR_MIN || addr > TCA9548A_ADDR_MAX) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    *mux = calloc(1, sizeof(**mux));
+    if (!*mux) {
+        return I2CLCD_ERR_NOMEM;
+    }
+
+    (*mux)->addr = addr;
+    return I2CLCD_OK;
+}
+
+void i2clcd_mux_destroy(i2clcd_mux_t *mux)
+{
+    free(mux);
+}
+
+i2clcd_err_t i2clcd_mux_stats(i2clcd_mux_t *mux, i2clcd_mux_stats_t *stats)
+{
+    if (!mux || !stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    *stats = mux->stats;
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_mux_flush(i2clcd_t *const *handles, size_t count)
+{
+    i2clcd_t **order;
+    i2clcd_t *h;
+    i2clcd_err_t err, first = I2CLCD_OK;
+    uint64_t t0;
+    size_t i, j;
+
+    if (!handles && count > 0) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!handles[i]) {
+            return I2CLCD_ERR_NOT_INIT;
+        }
+    }
+
+    if (count == 0) {
+        return I2CLCD_OK;
+    }
+
+    /* The whole flush is timed on the first handle's clock */
+    t0 = i2clcd_monotonic_ns(handles[0]);
+    order = calloc(count, sizeof(*order));
+    if (!order) {
+        return i2clcd_stats_api(handles[0], I2CLCD_API_MUX_FLUSH, t0,
+                                I2CLCD_ERR_NOMEM);
+    }
+
+    /* Stable insertion sort; the caller's order survives within a group */
+    for (i = 0; i < count; i++) {
+        h = handles[i];
+        for (j = i; j > 0 && flush_cmp(order[j - 1], h) > 0; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = h;
+    }
+
+    /* A clean handle sends nothing, so it costs no select either */
+    for (i = 0; i < count; i++) {
+        if (!order[i]->compositor.enabled) {
+            continue;
+        }
+        err = i2clcd_compositor_flush(order[i]);
+        if (err != I2CLCD_OK && first == I2CLCD_OK) {
+            first = err;
+        }
+    }
+
+    free(order);
+    return i2clcd_stats_api(handles[0], I2CLCD_API_MUX_FLUSH, t0, first);
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * pinmap.c - Backpack wiring compiled into PCF8574 encoding tables
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/* Signals in default-layout bit order: RS, RW, EN, BL, D4-D7 */
+static void map_ports(const i2clcd_pinmap_t *map, uint8_t port[8])
+{
+    port[0] = map->rs;
+    port[1] = map->rw;
+    port[2] = map->en;
+    port[3] = map->bl;
+    port[4] = map->d4;
+    port[5] = map->d5;
+    port[6] = map->d6;
+    port[7] = map->d7;
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+int i2clcd_wiring_build(struct i2clcd_wiring *w, const i2clcd_pinmap_t *map)
+{
+    static const i2clcd_pinmap_t def = I2CLCD_PINMAP_DEFAULT;
+    uint8_t port[8], used = 0, flip;
+    unsigned int i, v, bit, rs, bl;
+
+    if (!map) {
+        map = &def;
+    }
+
+    map_ports(map, port);
+    for (i = 0; i < 8; i++) {
+        if (port[i] > 7 || (used & (1u << port[i]))) {
+            return -1;
+        }
+        used |= (uint8_t)(1u << port[i]);
+    }
+
+    /* Logical BL means "lit"; an active-low pin carries the inverse */
+    flip = map->bl_active_low ? PCF8574_PIN_BL : 0;
+
+    for (v = 0; v < 256; v++) {
+        uint8_t phys = 0, logical = 0;
+
+        for (bit = 0; bit < 8; bit++) {
+            if ((v ^ flip) & (1u << bit)) {
+                phys |= (uint8_t)(1u << port[bit]);
+            }
+            if (v & (1u << port[bit])) {
+                logical |= (uint8_t)(1u << bit);
+            }
+        }
+        w->to_physical[v] = phys;
+        w->to_logical[v] = logical ^ flip;
+    }
+
+    w->rs = (uint8_t)(1u << map->rs);
+    w->rw = (uint8_t)(1u << map->rw);
+    w->en = (uint8_t)(1u << map->en);
+    w->bl[0] = map->bl_active_low ? (uint8_t)(1u << map->bl) : 0;
+    w->bl[1] = map->bl_active_low ? 0 : (uint8_t)(1u << map->bl);
+    w->data = w->to_physical[PCF8574_DATA_MASK | flip];
+    w->data_shift = -1;
+    if (map->d4 <= 4 && map->d5 == map->d4 + 1 && map->d6 == map->d4 + 2 &&
+        map->d7 == map->d4 + 3) {
+        w->data_shift = (int8_t)map->d4;
+    }
+
+    for (v = 0; v < 16; v++) {
+        w->nibble[v] = w->to_physical[(v << 4) | flip];
+    }
+
+    for (rs = 0; rs < 2; rs++) {
+        for (bl = 0; bl < 2; bl++) {
+            uint8_t ctl = (uint8_t)((rs ? w->rs : 0) | w->bl[bl]);
+
+            for (v = 0; v < 256; v++) {
+                uint8_t *out = w->encode[rs][bl][v];
+                uint8_t hi = w->nibble[v >> 4] | ctl;
+                uint8_t lo = w->nibble[v & 0x0F] | ctl;
+
+                out[0] = hi | w->en;
+                out[1] = hi;
+                out[2] = lo | w->en;
+                out[3] = lo;
+            }
+        }
+    }
+
+    return 0;
+}
+
+const i2clcd_pinmap_t *i2clcd_config_pinmap(const i2clcd_config_t *config)
+{
+    static const i2clcd_pinmap_t plate = I2CLCD_PINMAP_RGB_PLATE;
+
+    /* The plate's wiring is fixed, so it needs no map from the caller */
+    if (!config->pinmap && config->expander == I2CLCD_EXPANDER_RGB_PLATE) {
+        return &plate;
+    }
+    return config->pinmap;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_set_pinmap(i2clcd_t *handle, const i2clcd_pinmap_t *map)
+{
+    struct i2clcd_wiring w;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (i2clcd_wiring_build(&w, map) < 0) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    memcpy(&handle->wiring, &w, sizeof(w));
+    i2clcd_select(handle, handle->target);
+    return I2CLCD_OK;
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * plate.c - RGB LCD plate backlight colour and button polling
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/* Bus clocks per byte, including the acknowledge */
+#define PLATE_BYTE_BITS     9
+
+static void queue_event(struct i2clcd_buttons *bt, uint8_t button,
+                        bool pressed, uint64_t time_ns)
+{
+    i2clcd_button_event_t *ev;
+
+    if (bt->count == I2CLCD_BUTTON_QUEUE) {
+        bt->stats.dropped++;
+        return;
+    }
+
+    ev = &bt->queue[(bt->head + bt->count) % I2CLCD_BUTTON_QUEUE];
+    ev->button = (i2clcd_button_t)button;
+    ev->pressed = pressed;
+    ev->time_ns = time_ns;
+    bt->count++;
+    bt->stats.events++;
+}
+
+/* Each button changes state once its new level has held for debounce_ms */
+static void debounce(struct i2clcd_buttons *bt, uint8_t pressed, uint64_t now)
+{
+    uint64_t hold_ns = (uint64_t)bt->cfg.debounce_ms * 1000000;
+    unsigned int i;
+    uint8_t bit;
+
+    for (i = 0; i < I2CLCD_BUTTON_COUNT; i++) {
+        bit = (uint8_t)(1u << i);
+
+        if ((pressed ^ bt->raw) & bit) {
+            bt->since_ns[i] = now;
+        }
+        if (((pressed ^ bt->held) & bit) && now - bt->since_ns[i] >= hold_ns) {
+            bt->held ^= bit;
+            queue_event(bt, bit, (pressed & bit) != 0, bt->since_ns[i]);
+        }
+    }
+
+    bt->raw = pressed;
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+void i2clcd_buttons_run(i2clcd_t *ctx)
+{
+    struct i2clcd_buttons *bt = &ctx->buttons;
+    uint64_t now, lag, t0;
+    uint8_t pressed;
+    int ret;
+
+    if (!bt->enabled || ctx->link_down) {
+        return;
+    }
+
+    now = i2clcd_monotonic_ns(ctx);
+    if (now < bt->next_ns) {
+        return;
+    }
+
+    lag = now - bt->next_ns;
+    if (lag > bt->stats.lag_max_ns) {
+        bt->stats.lag_max_ns = lag;
+    }
+    if (lag > (uint64_t)bt->cfg.latency_ms * 1000000) {
+        bt->stats.late++;
+    }
+
+    /* Count the interval from now, so a late poll causes no burst */
+    bt->next_ns = now + (uint64_t)bt->cfg.poll_ms * 1000000;
+
+    t0 = now;
+    ret = i2clcd_mcp_inputs(ctx, &pressed);
+    ctx->stats.bus_ns += i2clcd_monotonic_ns(ctx) - t0;
+
+    bt->stats.polls++;
+    if (ret < 0) {
+        bt->stats.errors++;
+        return;
+    }
+
+    /* The first read only tells what was already held */
+    if (!bt->seeded) {
+        bt->raw = bt->held = pressed;
+        bt->seeded = true;
+        return;
+    }
+
+    debounce(bt, pressed, now);
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_set_color(i2clcd_t *handle, uint8_t color)
+{
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+    bool blue;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (handle->expander != I2CLCD_EXPANDER_RGB_PLATE) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    if (color & ~I2CLCD_COLOR_WHITE) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    blue = ((color ^ handle->color) & I2CLCD_COLOR_BLUE) != 0;
+    handle->color = color;
+
+    /* Red and green ride on the next button poll when there is one */
+    if (i2clcd_mcp_color(handle, color, handle->buttons.enabled) < 0) {
+        ret = I2CLCD_ERR_WRITE;
+    }
+
+    /* Blue is on the LCD port; inside a batch this adds one byte */
+    else if (blue && i2clcd_write_pins(handle, handle->pins) < 0) {
+        ret = I2CLCD_ERR_WRITE;
+    }
+
+    return i2clcd_stats_api(handle, I2CLCD_API_SET_COLOR, t0, ret);
+}
+
+i2clcd_err_t i2clcd_set_buttons(i2clcd_t *handle,
+                                const i2clcd_buttons_config_t *config)
+{
+    struct i2clcd_buttons *bt;
+    uint64_t bytes;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (handle->expander != I2CLCD_EXPANDER_RGB_PLATE) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    bt = &handle->buttons;
+    if (!config) {
+        bt->enabled = false;
+        return i2clcd_mcp_color(handle, handle->color, false) < 0 ?
+               I2CLCD_ERR_WRITE : I2CLCD_OK;
+    }
+
+    if (config->poll_ms == 0 || config->latency_ms == 0 ||
+        config->bus_hz == 0) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    memset(bt, 0, sizeof(*bt));
+    bt->cfg = *config;
+
+    /* Bytes that fit in the bound after the address and register bytes,
+     * in whole characters */
+    bytes = (uint64_t)config->latency_ms * config->bus_hz /
+            (PLATE_BYTE_BITS * 1000);
+    bytes = bytes > 2 ? (bytes - 2) & ~(uint64_t)3 : 0;
+    if (bytes < 4) {
+        bytes = 4;
+    }
+    bt->max_xfer = bytes < I2CLCD_TX_BUF_SIZE ? (size_t)bytes :
+                                                I2CLCD_TX_BUF_SIZE;
+
+    if (i2clcd_mcp_color(handle, handle->color, true) < 0) {
+        return I2CLCD_ERR_WRITE;
+    }
+
+    /* Seed the held buttons now */
+    bt->enabled = true;
+    bt->next_ns = i2clcd_monotonic_ns(handle);
+    i2clcd_buttons_run(handle);
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_buttons_poll(i2clcd_t *handle)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!handle->buttons.enabled) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    i2clcd_buttons_run(handle);
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_button_event(i2clcd_t *handle,
+                                 i2clcd_button_event_t *event, bool *got)
+{
+    struct i2clcd_buttons *bt;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!event || !got) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    bt = &handle->buttons;
+    if (!bt->enabled) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    *got = bt->count > 0;
+    if (*got) {
+        *event = bt->queue[bt->head];
+        bt->head = (bt->head + 1) % I2CLCD_BUTTON_QUEUE;
+        bt->count--;
+    }
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_buttons_get(i2clcd_t *handle, uint8_t *held)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!held) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (!handle->buttons.enabled) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    *held = handle->buttons.held;
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_buttons_stats(i2clcd_t *handle,
+                                  i2clcd_buttons_stats_t *stats)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    *stats = handle->buttons.stats;
+    return I2CLCD_OK;
+}
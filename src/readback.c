@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * readback.c - Reading controller memory through the RW pin
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+#include "hd44780.h"
+
+/*---------------------------------------------------------------------------
+ * Read Cycle
+ *
+ * With RW high the HD44780 drives D7-D4 while EN is high. The PCF8574 pins
+ * are quasi-bidirectional, so the data pins are written high (released)
+ * and then sampled with a one-byte read. The EN falling edge of one cycle
+ * and the rising edge of the next share a transaction.
+ *---------------------------------------------------------------------------*/
+
+static uint8_t read_pins(const i2clcd_t *ctx, bool rs)
+{
+    const struct i2clcd_wiring *w = &ctx->wiring;
+    uint8_t pins = w->data | w->rw | w->bl[ctx->backlight];
+
+    if (rs) {
+        pins |= w->rs;
+    }
+    return pins;
+}
+
+/* Sample one nibble: EN low, EN high, read */
+static int read_nibble(i2clcd_t *ctx, uint8_t pins, uint8_t *nibble)
+{
+    uint8_t seq[2] = { pins, (uint8_t)(pins | ctx->wiring.en) };
+
+    if (i2clcd_bus_write(ctx, seq, sizeof(seq)) < 0 ||
+        i2clcd_bus_read(ctx, nibble, 1) < 0) {
+        return -1;
+    }
+
+    *nibble = ctx->wiring.to_logical[*nibble] & PCF8574_DATA_MASK;
+    return 0;
+}
+
+static int read_bytes(i2clcd_t *ctx, bool rs, uint8_t *buf, size_t len)
+{
+    uint8_t pins = read_pins(ctx, rs);
+    uint8_t hi, lo, idle;
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < len && ret == 0; i++) {
+        ret = read_nibble(ctx, pins, &hi);
+        if (ret == 0) {
+            ret = read_nibble(ctx, pins, &lo);
+        }
+        buf[i] = (uint8_t)(hi | (lo >> 4));
+    }
+
+    /* End the last cycle and leave RW and EN low for the next write */
+    idle = ctx->wiring.bl[ctx->backlight];
+    ctx->pins = idle;
+    if (i2clcd_bus_write(ctx, &pins, 1) < 0 ||
+        i2clcd_bus_write(ctx, &idle, 1) < 0) {
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/* Rebuild the shadow from the controller's memories */
+static i2clcd_err_t sync_shadow(i2clcd_t *handle)
+{
+    struct i2clcd_shadow *sh;
+    uint8_t ac, bank;
+    i2clcd_err_t err;
+
+    /* The cursor position first, before reading moves it */
+    err = i2clcd_read_addr(handle, &ac);
+    if (err != I2CLCD_OK) {
+        return err;
+    }
+
+    sh = &handle->shadow;
+    i2clcd_shadow_reset(handle);
+
+    if (i2clcd_mem_read(handle, true, 0, sh->cgram, HD44780_CGRAM_SIZE) < 0) {
+        i2clcd_shadow_reset(handle);
+        return I2CLCD_ERR_IO;
+    }
+    memset(sh->cgram_valid, 0xFF, sizeof(sh->cgram_valid));
+
+    /* Two 40-cell banks; the addresses in between do not exist */
+    for (bank = 0; bank <= HD44780_LINE1_ADDR; bank += HD44780_LINE1_ADDR) {
+        if (i2clcd_mem_read(handle, false, bank, sh->ddram + bank,
+                            HD44780_DDRAM_LINE_LEN) < 0) {
+            i2clcd_shadow_reset(handle);
+            return I2CLCD_ERR_IO;
+        }
+        memset(sh->ddram_valid + bank / 8, 0xFF, HD44780_DDRAM_LINE_LEN / 8);
+    }
+
+    /* The counter cannot say which memory it was in; DDRAM is the usual */
+    if (i2clcd_command(handle, HD44780_CMD_SET_DDRAM | ac) < 0) {
+        return I2CLCD_ERR_WRITE;
+    }
+
+    return I2CLCD_OK;
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+bool i2clcd_can_read(const i2clcd_t *ctx)
+{
+    return ctx->expander == I2CLCD_EXPANDER_PCF8574 && ctx->ctrls == 1;
+}
+
+int i2clcd_mem_read(i2clcd_t *ctx, bool cgram, uint8_t addr, uint8_t *buf,
+                    size_t len)
+{
+    int ret;
+
+    /* Reads follow the entry mode, so run them forward */
+    if (ctx->entry_mode != HD44780_ENTRY_INC &&
+        i2clcd_command(ctx, HD44780_CMD_ENTRY_MODE | HD44780_ENTRY_INC) < 0) {
+        return -1;
+    }
+
+    ret = i2clcd_command(ctx, (cgram ? HD44780_CMD_SET_CGRAM :
+                                       HD44780_CMD_SET_DDRAM) | addr);
+    if (ret == 0) {
+        ret = read_bytes(ctx, true, buf, len);
+    }
+
+    /* Reads move the address counter behind the shadow's back */
+    ctx->shadow.addr_valid = false;
+
+    if (ctx->entry_mode != HD44780_ENTRY_INC &&
+        i2clcd_command(ctx, HD44780_CMD_ENTRY_MODE | ctx->entry_mode) < 0) {
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_read_mem(i2clcd_t *handle, bool cgram, uint8_t addr,
+                             uint8_t *buf, size_t len)
+{
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!i2clcd_can_read(handle)) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    if (!buf) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (addr >= (cgram ? HD44780_CGRAM_SIZE : HD44780_DDRAM_SIZE)) {
+        return I2CLCD_ERR_RANGE;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    if (i2clcd_mem_read(handle, cgram, addr, buf, len) < 0) {
+        ret = I2CLCD_ERR_IO;
+    }
+
+    return i2clcd_stats_api(handle, I2CLCD_API_READ_MEM, t0, ret);
+}
+
+i2clcd_err_t i2clcd_read_addr(i2clcd_t *handle, uint8_t *addr)
+{
+    uint8_t bf_ac;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!addr) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (!i2clcd_can_read(handle)) {
+        return I2CLCD_ERR_UNSUPPORTED;
+    }
+
+    if (read_bytes(handle, false, &bf_ac, 1) < 0) {
+        return I2CLCD_ERR_IO;
+    }
+
+    *addr = bf_ac & 0x7F;
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_sync_shadow(i2clcd_t *handle)
+{
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    return i2clcd_stats_api(handle, I2CLCD_API_SYNC_SHADOW, t0,
+                            sync_shadow(handle));
+}
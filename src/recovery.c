@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * recovery.c - 4-bit resync and shadow replay after bus errors
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+#include "hd44780.h"
+
+/*---------------------------------------------------------------------------
+ * Resync
+ *---------------------------------------------------------------------------*/
+
+/*
+ * Force the interface back to a known 4-bit phase. Three 0x3 nibbles land
+ * in 8-bit mode whether the controller was waiting for a high or a low
+ * nibble; 0x2 then selects 4-bit mode. If the first nibble completes a
+ * stray instruction, its high nibble is whatever was pending: 0x13 shifts
+ * the cursor, 0x23 selects one line, 0x43 and 0x83 move the address
+ * counter. None of that survives, because the function set and display
+ * control below and the full replay after rewrite every register it can
+ * touch. An 8-bit bus has no nibble phase; the 0x30 writes alone restore
+ * its width.
+ */
+static int resync(i2clcd_t *ctx, bool power_on)
+{
+    uint8_t display_ctrl = ctx->display_ctrl;
+    uint8_t entry_mode = ctx->entry_mode;
+    uint8_t sel = ctx->sel;
+
+    /* After power loss the controller needs the full init sequence */
+    if (power_on) {
+        if (i2clcd_init_sequence(ctx) < 0) {
+            return -1;
+        }
+        ctx->display_ctrl = display_ctrl;
+        ctx->entry_mode = entry_mode;
+
+        /* A visible cursor goes back to its controller */
+        i2clcd_select(ctx, (uint8_t)(1u << sel));
+        return i2clcd_update_display_ctrl(ctx);
+    }
+
+    /* Every controller of a 40x4 panel shares the glitch */
+    i2clcd_select(ctx, I2CLCD_CTRL_ALL);
+
+    if (i2clcd_write_nibble(ctx, 0x30, false) < 0) {
+        return -1;
+    }
+    i2clcd_delay_us(ctx, HD44780_DELAY_CLEAR_US);
+
+    if (i2clcd_write_nibble(ctx, 0x30, false) < 0 ||
+        i2clcd_write_nibble(ctx, 0x30, false) < 0 ||
+        (!ctx->eight_bit && i2clcd_write_nibble(ctx, 0x20, false) < 0)) {
+        return -1;
+    }
+
+    /* Registers the stray instruction may have changed */
+    if (i2clcd_command(ctx, i2clcd_function_set(ctx)) < 0 ||
+        i2clcd_update_display_ctrl(ctx) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------
+ * Replay
+ *---------------------------------------------------------------------------*/
+
+static bool bit_set(const uint8_t *bits, unsigned int i)
+{
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+/* Write each known byte, reusing the address counter across runs; DDRAM
+ * addresses that do not exist in 2-line mode are never written */
+static int replay_mem(i2clcd_t *ctx, const uint8_t *mem, const uint8_t *valid,
+                      unsigned int size, bool cgram)
+{
+    const struct i2clcd_shadow *sh = &ctx->shadow;
+    uint8_t set = cgram ? HD44780_CMD_SET_CGRAM : HD44780_CMD_SET_DDRAM;
+    unsigned int addr;
+
+    for (addr = 0; addr < size; addr++) {
+        if (!bit_set(valid, addr) || (!cgram && !HD44780_DDRAM_EXISTS(addr))) {
+            continue;
+        }
+
+        if (!sh->addr_valid || sh->addr_cgram != cgram || sh->addr != addr) {
+            if (i2clcd_command(ctx, set | addr) < 0) {
+                return -1;
+            }
+        }
+
+        if (i2clcd_data(ctx, mem[addr]) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int replay(i2clcd_t *ctx, const struct i2clcd_shadow *saved)
+{
+    uint8_t entry_mode = ctx->entry_mode;
+    int ret;
+
+    /* Replay runs forward without shifting the display */
+    ctx->entry_mode = HD44780_ENTRY_INC;
+
+    i2clcd_batch_begin(ctx);
+    ret = i2clcd_command(ctx, HD44780_CMD_ENTRY_MODE | ctx->entry_mode);
+    if (ret == 0) {
+        ret = replay_mem(ctx, saved->cgram, saved->cgram_valid,
+                         HD44780_CGRAM_SIZE, true);
+    }
+    if (ret == 0) {
+        ret = replay_mem(ctx, saved->ddram, saved->ddram_valid,
+                         HD44780_DDRAM_SIZE, false);
+    }
+
+    ctx->entry_mode = entry_mode;
+    if (ret == 0) {
+        ret = i2clcd_command(ctx, HD44780_CMD_ENTRY_MODE | ctx->entry_mode);
+    }
+
+    /* Put the address counter (and a visible cursor) back */
+    if (ret == 0 && saved->addr_valid) {
+        ret = i2clcd_command(ctx, (saved->addr_cgram ?
+                                   HD44780_CMD_SET_CGRAM :
+                                   HD44780_CMD_SET_DDRAM) | saved->addr);
+    }
+
+    if (i2clcd_batch_end(ctx) < 0) {
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+int i2clcd_recovery_run(i2clcd_t *ctx, bool power_on)
+{
+    struct i2clcd_shadow saved[2];
+    uint8_t target = ctx->target, sel = ctx->sel;
+    unsigned int attempt, c;
+    uint64_t t0, ns;
+    int ret = -1;
+
+    if (ctx->recovering) {
+        return -1;
+    }
+
+    for (c = 0; c < ctx->ctrls; c++) {
+        saved[c] = *i2clcd_shadow_of(ctx, (uint8_t)c);
+    }
+
+    t0 = i2clcd_monotonic_ns(ctx);
+    ctx->recovering = true;
+
+    /* A glitch during the replay itself calls for another pass */
+    for (attempt = 0; attempt <= ctx->recovery.retries; attempt++) {
+        ctx->resync_pending = false;
+        i2clcd_select(ctx, (uint8_t)(1u << sel));
+        ret = resync(ctx, power_on);
+        for (c = 0; ret == 0 && c < ctx->ctrls; c++) {
+            i2clcd_select(ctx, (uint8_t)(1u << c));
+            ret = replay(ctx, &saved[c]);
+        }
+        for (c = 0; c < ctx->ctrls; c++) {
+            *i2clcd_shadow_of(ctx, (uint8_t)c) = saved[c];
+        }
+        if (ret == 0 && !ctx->resync_pending) {
+            break;
+        }
+        ret = -1;
+    }
+
+    i2clcd_select(ctx, (uint8_t)(1u << sel));
+    i2clcd_select(ctx, target);
+
+    /* The saved shadow stays the target, whether or not it was reached */
+    ctx->recovering = false;
+    ctx->resync_pending = (ret < 0);
+
+    ns = i2clcd_monotonic_ns(ctx) - t0;
+    ctx->stats.recoveries++;
+    ctx->stats.recovery_ns += ns;
+    if (ns > ctx->stats.recovery_max_ns) {
+        ctx->stats.recovery_max_ns = ns;
+    }
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_set_recovery(i2clcd_t *handle,
+                                 const i2clcd_recovery_config_t *config)
+{
+    struct i2clcd_backend *be;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!config || config->backoff_max_us < config->backoff_us) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    handle->recovery = *config;
+
+    if (config->adapter_timeout_ms == 0 && config->adapter_retries == 0) {
+        return I2CLCD_OK;
+    }
+
+    /* The first layer that knows about an adapter takes the settings */
+    for (be = handle->backend; be; be = be->inner) {
+        if (be->ops->set_adapter) {
+            if (be->ops->set_adapter(be, config->adapter_timeout_ms,
+                                     config->adapter_retries) < 0) {
+                return I2CLCD_ERR_IOCTL;
+            }
+            break;
+        }
+    }
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_recover(i2clcd_t *handle)
+{
+    i2clcd_err_t ret = I2CLCD_OK;
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    if (i2clcd_recovery_run(handle, false) < 0) {
+        ret = I2CLCD_ERR_WRITE;
+    }
+
+    return i2clcd_stats_api(handle, I2CLCD_API_RECOVER, t0, ret);
+}
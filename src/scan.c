@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * scan.c - Parallel discovery of PCF8574 backpacks on all I2C buses
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/* PCF8574 0x20-0x27 and PCF8574A 0x38-0x3F */
+#define SCAN_ADDRS      16
+#define SCAN_MAX_BUSES  64
+
+/* Probe patterns: P2 and P4 stay low, the enable pin on either built-in
+ * pin map, so the LCD ignores them */
+#define SCAN_PATTERN_A  0x40
+#define SCAN_PATTERN_B  0xA0
+
+/* EN and RW of the common (P2, P1) and mjkdz (P4, P5) pin maps; a driven
+ * backpack idles with both low on its own map */
+#define SCAN_IDLE_COMMON  (PCF8574_PIN_EN | PCF8574_PIN_RW)
+#define SCAN_IDLE_MJKDZ   ((1 << 4) | (1 << 5))
+
+struct scan_bus {
+    unsigned int number;              /* N in /dev/i2c-N */
+    unsigned int flags;               /* I2CLCD_SCAN_* */
+    pthread_t thread;
+    bool started;
+    size_t found;
+    i2clcd_scan_result_t results[SCAN_ADDRS];
+};
+
+static uint8_t scan_addr(unsigned int i)
+{
+    return (uint8_t)(i < 8 ? 0x20 + i : 0x38 + (i - 8));
+}
+
+/*---------------------------------------------------------------------------
+ * Probing
+ *---------------------------------------------------------------------------*/
+
+static bool echoes(int fd, uint8_t value)
+{
+    uint8_t back;
+
+    return write(fd, &value, 1) == 1 && read(fd, &back, 1) == 1 &&
+           back == value;
+}
+
+/* Read-only guess: pins left idle by an HD44780 driver */
+static bool looks_idle(uint8_t latch)
+{
+    return (latch & SCAN_IDLE_COMMON) == 0 ||
+           (latch & SCAN_IDLE_MJKDZ) == 0;
+}
+
+/* Classify one address; returns false if nothing answered */
+static bool probe(int fd, uint8_t addr, unsigned int flags,
+                  i2clcd_scan_result_t *res)
+{
+    uint8_t keep;
+
+    res->addr = addr;
+    res->backpack = false;
+    res->busy = false;
+
+    if (ioctl(fd, I2C_SLAVE, addr) < 0) {
+        /* A kernel driver owns it, so something is there */
+        res->busy = (errno == EBUSY);
+        res->latch = 0;
+        return res->busy;
+    }
+
+    /* Quick read: harmless to a PCF8574, and any device ACKs its address */
+    if (read(fd, &res->latch, 1) != 1) {
+        return false;
+    }
+
+    if (!(flags & I2CLCD_SCAN_DEEP)) {
+        res->backpack = looks_idle(res->latch);
+        return true;
+    }
+
+    /* P0 and P3 (RS and backlight on the common wiring) keep their levels */
+    keep = res->latch & (PCF8574_PIN_BL | PCF8574_PIN_RS);
+    res->backpack = echoes(fd, keep | SCAN_PATTERN_A) &&
+                    echoes(fd, keep | SCAN_PATTERN_B);
+
+    if (res->backpack && write(fd, &res->latch, 1) != 1) {
+        res->backpack = false;
+    }
+
+    return true;
+}
+
+static void *scan_bus_thread(void *arg)
+{
+    struct scan_bus *bus = arg;
+    char path[32];
+    unsigned int i;
+    int fd;
+
+    snprintf(path, sizeof(path), "/dev/i2c-%u", bus->number);
+    fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    for (i = 0; i < SCAN_ADDRS; i++) {
+        i2clcd_scan_result_t *res = &bus->results[bus->found];
+
+        if (probe(fd, scan_addr(i), bus->flags, res)) {
+            snprintf(res->device, sizeof(res->device), "%s", path);
+            bus->found++;
+        }
+    }
+
+    close(fd);
+    return NULL;
+}
+
+/*---------------------------------------------------------------------------
+ * Bus Enumeration
+ *---------------------------------------------------------------------------*/
+
+static int bus_compare(const void *a, const void *b)
+{
+    const struct scan_bus *x = a, *y = b;
+
+    return (x->number > y->number) - (x->number < y->number);
+}
+
+static size_t list_buses(struct scan_bus *buses, size_t max)
+{
+    struct dirent *ent;
+    size_t n = 0;
+    char *end;
+    DIR *dir;
+
+    dir = opendir("/dev");
+    if (!dir) {
+        return 0;
+    }
+
+    while ((ent = readdir(dir)) != NULL && n < max) {
+        unsigned long num;
+
+        if (strncmp(ent->d_name, "i2c-", 4) != 0) {
+            continue;
+        }
+        num = strtoul(ent->d_name + 4, &end, 10);
+        if (end == ent->d_name + 4 || *end != '\0') {
+            continue;
+        }
+        memset(&buses[n], 0, sizeof(buses[n]));
+        buses[n++].number = (unsigned int)num;
+    }
+
+    closedir(dir);
+    qsort(buses, n, sizeof(buses[0]), bus_compare);
+    return n;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_scan(i2clcd_scan_result_t *results, size_t max,
+                         unsigned int flags, size_t *count)
+{
+    struct scan_bus *buses;
+    size_t nbuses, i, j, total = 0;
+
+    if (!count || (!results && max > 0)) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    buses = calloc(SCAN_MAX_BUSES, sizeof(*buses));
+    if (!buses) {
+        return I2CLCD_ERR_NOMEM;
+    }
+
+    /* Probes on one bus serialize; separate buses run side by side */
+    nbuses = list_buses(buses, SCAN_MAX_BUSES);
+    for (i = 0; i < nbuses; i++) {
+        buses[i].flags = flags;
+        buses[i].started = pthread_create(&buses[i].thread, NULL,
+                                          scan_bus_thread, &buses[i]) == 0;
+        if (!buses[i].started) {
+            scan_bus_thread(&buses[i]);
+        }
+    }
+
+    for (i = 0; i < nbuses; i++) {
+        if (buses[i].started) {
+            pthread_join(buses[i].thread, NULL);
+        }
+        for (j = 0; j < buses[i].found; j++, total++) {
+            if (total < max) {
+                results[total] = buses[i].results[j];
+            }
+        }
+    }
+
+    free(buses);
+    *count = total;
+    return I2CLCD_OK;
+}
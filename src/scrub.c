@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * scrub.c - Background refresh of controller memory from shadow state
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+#include "hd44780.h"
+
+/* Scrub positions per controller: CGRAM rows first, then DDRAM cells */
+#define SCRUB_CELLS     (HD44780_CGRAM_SIZE + HD44780_DDRAM_SIZE)
+
+/* Bus bytes for one instruction or data byte (two nibbles, EN high/low) */
+#define SCRUB_BYTE_COST 4
+
+/* Bus bytes to read one cell back (two nibbles, EN low/high, one read) */
+#define SCRUB_READ_COST 6
+
+static bool cell_known(const struct i2clcd_shadow *sh, unsigned int pos)
+{
+    uint8_t addr;
+
+    if (pos < HD44780_CGRAM_SIZE) {
+        return (sh->cgram_valid[pos >> 3] >> (pos & 7)) & 1;
+    }
+
+    addr = (uint8_t)(pos - HD44780_CGRAM_SIZE);
+    return HD44780_DDRAM_EXISTS(addr) &&
+           ((sh->ddram_valid[addr >> 3] >> (addr & 7)) & 1);
+}
+
+/* Rewrite one cell with its shadow value, addressing it only if needed */
+static int write_cell(i2clcd_t *ctx, unsigned int pos)
+{
+    const struct i2clcd_shadow *sh = &ctx->shadow;
+    bool cgram = pos < HD44780_CGRAM_SIZE;
+    uint8_t addr = (uint8_t)(cgram ? pos : pos - HD44780_CGRAM_SIZE);
+
+    if (!sh->addr_valid || sh->addr_cgram != cgram || sh->addr != addr) {
+        if (i2clcd_command(ctx, (cgram ? HD44780_CMD_SET_CGRAM :
+                                         HD44780_CMD_SET_DDRAM) | addr) < 0) {
+            return -1;
+        }
+    }
+
+    return i2clcd_data(ctx, cgram ? sh->cgram[addr] : sh->ddram[addr]);
+}
+
+/* Read-back needs the RW pin path; other backpacks rewrite blind */
+static bool verifying(const i2clcd_t *ctx)
+{
+    return ctx->scrub.cfg.verify && i2clcd_can_read(ctx);
+}
+
+/* Read the cells back and keep only those the glass disagrees on */
+static int verify_cells(i2clcd_t *ctx, uint16_t *cells, unsigned int *n)
+{
+    const struct i2clcd_shadow *sh = &ctx->shadow;
+    uint8_t buf[UINT8_MAX];
+    unsigned int i, run, m = 0;
+
+    /* Reads cover runs of adjacent cells in the same memory */
+    for (i = 0; i < *n; i += run) {
+        bool cgram = cells[i] < HD44780_CGRAM_SIZE;
+        uint8_t addr = (uint8_t)(cgram ? cells[i] :
+                                 cells[i] - HD44780_CGRAM_SIZE);
+        unsigned int j;
+
+        run = 1;
+        while (i + run < *n && cells[i + run] == cells[i] + run &&
+               (cells[i + run] < HD44780_CGRAM_SIZE) == cgram) {
+            run++;
+        }
+
+        if (i2clcd_mem_read(ctx, cgram, addr, buf, run) < 0) {
+            return -1;
+        }
+
+        for (j = 0; j < run; j++) {
+            uint8_t want = cgram ? sh->cgram[addr + j] : sh->ddram[addr + j];
+
+            if (buf[j] != want) {
+                cells[m++] = cells[i + j];
+            }
+        }
+    }
+
+    ctx->scrub.stats.verified += *n;
+    ctx->scrub.stats.mismatches += m;
+    *n = m;
+    return 0;
+}
+
+static int write_cells(i2clcd_t *ctx, uint8_t ctrl, uint16_t *cells,
+                       unsigned int n)
+{
+    struct i2clcd_shadow saved = *i2clcd_shadow_of(ctx, ctrl);
+    uint8_t entry_mode = ctx->entry_mode;
+    uint8_t target = ctx->target;
+    unsigned int i;
+    int ret = 0;
+
+    i2clcd_select(ctx, (uint8_t)(1u << ctrl));
+
+    if (verifying(ctx) && verify_cells(ctx, cells, &n) < 0) {
+        i2clcd_select(ctx, target);
+        return -1;
+    }
+    ctx->scrub.stats.cells += n;
+
+    i2clcd_batch_begin(ctx);
+
+    /* Write forward without shifting the display */
+    if (n > 0 && entry_mode != HD44780_ENTRY_INC) {
+        ctx->entry_mode = HD44780_ENTRY_INC;
+        ret = i2clcd_command(ctx, HD44780_CMD_ENTRY_MODE | ctx->entry_mode);
+    }
+
+    for (i = 0; i < n && ret == 0; i++) {
+        ret = write_cell(ctx, cells[i]);
+    }
+
+    if (n > 0 && entry_mode != HD44780_ENTRY_INC) {
+        ctx->entry_mode = entry_mode;
+        if (ret == 0) {
+            ret = i2clcd_command(ctx, HD44780_CMD_ENTRY_MODE | entry_mode);
+        }
+    }
+
+    /* Leave the address counter (and a visible cursor) where it was */
+    if (ret == 0 && saved.addr_valid &&
+        (!ctx->shadow.addr_valid ||
+         ctx->shadow.addr_cgram != saved.addr_cgram ||
+         ctx->shadow.addr != saved.addr)) {
+        ret = i2clcd_command(ctx, (saved.addr_cgram ?
+                                   HD44780_CMD_SET_CGRAM :
+                                   HD44780_CMD_SET_DDRAM) | saved.addr);
+    }
+
+    i2clcd_select(ctx, target);
+    if (i2clcd_batch_end(ctx) < 0) {
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------
+ * Internal API
+ *---------------------------------------------------------------------------*/
+
+int i2clcd_scrub_run(i2clcd_t *ctx)
+{
+    struct i2clcd_scrub *sc = &ctx->scrub;
+    unsigned int total = SCRUB_CELLS * ctx->ctrls;
+    const struct i2clcd_shadow *sh;
+    uint16_t cells[UINT8_MAX];
+    unsigned int i, pos, n = 0;
+    uint8_t ctrl;
+    uint64_t now;
+    size_t cost;
+
+    if (!sc->enabled || ctx->link_down) {
+        return 0;
+    }
+
+    now = i2clcd_monotonic_ns(ctx);
+    if (now < sc->next_ns) {
+        return 0;
+    }
+    sc->next_ns = now + (uint64_t)sc->cfg.interval_ms * 1000000;
+
+    /* A step stays within one controller */
+    ctrl = (uint8_t)(sc->pos / SCRUB_CELLS);
+    sh = i2clcd_shadow_of(ctx, ctrl);
+    for (i = 0; i < total && n < sc->cfg.cells; i++) {
+        pos = (sc->pos + i) % total;
+        if (pos / SCRUB_CELLS != ctrl) {
+            break;
+        }
+        if (cell_known(sh, pos % SCRUB_CELLS)) {
+            cells[n++] = (uint16_t)(pos % SCRUB_CELLS);
+        }
+    }
+
+    /* Nothing known here; the next step looks at the other controller */
+    if (n == 0) {
+        if (i < total && sc->pos + i >= total) {
+            sc->stats.sweeps++;
+        }
+        sc->pos = (uint16_t)((sc->pos + i) % total);
+        return 0;
+    }
+
+    /* Low priority: wait for a step that fits rather than for the bus */
+    cost = (size_t)(n + 4) * SCRUB_BYTE_COST;
+    if (verifying(ctx)) {
+        cost += (size_t)n * SCRUB_READ_COST;
+    }
+    if (ctx->budget && !i2clcd_budget_ready(ctx, cost)) {
+        sc->stats.skipped++;
+        return 0;
+    }
+
+    if (sc->pos + i >= total) {
+        sc->stats.sweeps++;
+    }
+    sc->pos = (uint16_t)((sc->pos + i) % total);
+    sc->stats.steps++;
+
+    return write_cells(ctx, ctrl, cells, n);
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_set_scrub(i2clcd_t *handle,
+                              const i2clcd_scrub_config_t *config)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!config) {
+        handle->scrub.enabled = false;
+        return I2CLCD_OK;
+    }
+
+    if (config->cells == 0) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    handle->scrub.cfg = *config;
+    handle->scrub.enabled = true;
+    handle->scrub.next_ns = i2clcd_monotonic_ns(handle);
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_scrub_step(i2clcd_t *handle)
+{
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!handle->scrub.enabled) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    return i2clcd_stats_api(handle, I2CLCD_API_SCRUB_STEP, t0,
+                            i2clcd_scrub_run(handle) < 0 ? I2CLCD_ERR_WRITE :
+                            I2CLCD_OK);
+}
+
+i2clcd_err_t i2clcd_scrub_stats(i2clcd_t *handle, i2clcd_scrub_stats_t *stats)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    *stats = handle->scrub.stats;
+    return I2CLCD_OK;
+}
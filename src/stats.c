@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * stats.c - Per-handle instrumentation counters and latency histograms
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * Names
+ *---------------------------------------------------------------------------*/
+
+static const char *api_names[I2CLCD_API_COUNT] = {
+    "init",
+    "open",
+    "clear",
+    "clear_line",
+    "home",
+    "display",
+    "set_cursor",
+    "cursor",
+    "blink",
+    "putc",
+    "puts",
+    "printf",
+    "set_line",
+    "backlight",
+    "create_char",
+    "compositor_flush",
+    "create_chars",
+    "compositor_start",
+    "compositor_wait",
+    "compositor_poll",
+    "set_priority",
+    "set_color",
+    "canvas_flush",
+    "mux_flush",
+    "trace_replay",
+    "sync_shadow",
+    "read_mem",
+    "recover",
+    "scrub_step",
+    "glyph",
+    "anim_step",
+};
+
+static const char *cmd_names[I2CLCD_CMD_TYPE_COUNT] = {
+    "clear",
+    "home",
+    "entry_mode",
+    "display_ctrl",
+    "shift",
+    "function_set",
+    "set_cgram",
+    "set_ddram",
+    "data",
+};
+
+const char *i2clcd_stats_api_name(i2clcd_api_t api)
+{
+    if ((int)api < 0 || api >= I2CLCD_API_COUNT) {
+        return "unknown";
+    }
+    return api_names[api];
+}
+
+const char *i2clcd_stats_cmd_name(i2clcd_cmd_type_t type)
+{
+    if ((int)type < 0 || type >= I2CLCD_CMD_TYPE_COUNT) {
+        return "unknown";
+    }
+    return cmd_names[type];
+}
+
+/*---------------------------------------------------------------------------
+ * Recording
+ *---------------------------------------------------------------------------*/
+
+static unsigned int log2_bucket(uint64_t ns)
+{
+    unsigned int b = 0;
+
+    while (ns > 1 && b < I2CLCD_HIST_BUCKETS - 1) {
+        ns >>= 1;
+        b++;
+    }
+    return b;
+}
+
+i2clcd_err_t i2clcd_stats_api(i2clcd_t *ctx, i2clcd_api_t api, uint64_t t0,
+                              i2clcd_err_t ret)
+{
+    i2clcd_hist_t *h = &ctx->stats.api[api];
+    uint64_t ns = i2clcd_monotonic_ns(ctx) - t0;
+
+    h->count++;
+    if (ret != I2CLCD_OK) {
+        h->errors++;
+    }
+    h->total_ns += ns;
+    if (ns > h->max_ns) {
+        h->max_ns = ns;
+    }
+    h->buckets[log2_bucket(ns)]++;
+
+    return ret;
+}
+
+void i2clcd_stats_command(i2clcd_t *ctx, uint8_t cmd, bool rs)
+{
+    unsigned int type = I2CLCD_CMD_DATA;
+
+    /* Instructions are identified by their highest set bit */
+    if (!rs) {
+        for (type = 7; type > 0 && !(cmd & (1 << type)); type--) {
+        }
+    }
+
+    ctx->stats.commands[type]++;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_stats_get(i2clcd_t *handle, i2clcd_stats_t *stats)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!stats) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    *stats = handle->stats;
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_stats_reset(i2clcd_t *handle)
+{
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    memset(&handle->stats, 0, sizeof(handle->stats));
+    return I2CLCD_OK;
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * trace.c - Raw bus trace recording and replay
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "i2clcd.h"
+#include "i2clcd_internal.h"
+
+/*---------------------------------------------------------------------------
+ * File Format
+ *
+ *   header:  "I2CLCDT" version(1) i2c_addr(1) expander(1) wiring(9)
+ *   record:  type(1) delta_us(varint) len(varint) bytes(len)
+ *
+ * A failed write keeps its bytes; the type says whether any may have
+ * arrived (everything but an address NACK). The wiring bytes are the pin
+ * levels for no signal, then for RS, RW, EN, BL and D4-D7 alone, which
+ * fixes the pin map including backlight polarity.
+ *---------------------------------------------------------------------------*/
+
+#define TRACE_MAGIC         "I2CLCDT"
+#define TRACE_MAGIC_LEN     7
+#define TRACE_VERSION       2
+#define TRACE_WIRING_LEN    10     /* Expander, then the wiring bytes */
+
+#define TRACE_REC_WRITE     0x01
+#define TRACE_REC_READ      0x02
+#define TRACE_REC_FAILED    0x80   /* Transaction returned an error */
+#define TRACE_REC_UNSENT    0x40   /* Address NACK: no byte arrived */
+#define TRACE_REC_FLAGS     (TRACE_REC_FAILED | TRACE_REC_UNSENT)
+
+#define TRACE_MAX_REC       4096
+
+struct trace_backend {
+    struct i2clcd_backend base;
+    FILE    *fp;
+    i2clcd_t *ctx;         /* Handle whose clock stamps the records */
+    uint64_t last_ns;      /* Timestamp of the previous record */
+};
+
+static void put_varint(FILE *fp, uint64_t v)
+{
+    while (v >= 0x80) {
+        fputc((int)(v & 0x7F) | 0x80, fp);
+        v >>= 7;
+    }
+    fputc((int)v, fp);
+}
+
+static int get_varint(FILE *fp, uint64_t *v)
+{
+    unsigned int shift = 0;
+    int c;
+
+    *v = 0;
+    do {
+        c = fgetc(fp);
+        if (c == EOF || shift > 63) {
+            return -1;
+        }
+        *v |= (uint64_t)(c & 0x7F) << shift;
+        shift += 7;
+    } while (c & 0x80);
+
+    return 0;
+}
+
+/* Describe what the handle's bytes mean on the wire */
+static void trace_wiring(const i2clcd_t *handle, uint8_t out[TRACE_WIRING_LEN])
+{
+    unsigned int bit;
+
+    out[0] = (uint8_t)handle->expander;
+    out[1] = handle->wiring.to_physical[0];
+    for (bit = 0; bit < 8; bit++) {
+        out[2 + bit] = handle->wiring.to_physical[1u << bit];
+    }
+}
+
+static void trace_record(struct trace_backend *tr, uint8_t type,
+                         uint64_t t0, const uint8_t *buf, size_t len)
+{
+    fputc(type, tr->fp);
+    put_varint(tr->fp, (t0 - tr->last_ns) / 1000);
+    put_varint(tr->fp, len);
+    fwrite(buf, 1, len, tr->fp);
+
+    /* Keep the remainder so rounding does not accumulate */
+    tr->last_ns = t0 - (t0 - tr->last_ns) % 1000;
+}
+
+/*---------------------------------------------------------------------------
+ * Trace Backend (wraps the backend below it)
+ *---------------------------------------------------------------------------*/
+
+static int trace_write(struct i2clcd_backend *be, const uint8_t *buf,
+                       size_t len)
+{
+    struct trace_backend *tr = (struct trace_backend *)be;
+    uint64_t t0 = i2clcd_monotonic_ns(tr->ctx);
+    uint8_t type = TRACE_REC_WRITE;
+    int ret, err;
+
+    ret = be->inner->ops->write(be->inner, buf, len);
+    err = errno;
+    if (ret < 0) {
+        type |= TRACE_REC_FAILED;
+        /* Only ENXIO guarantees nothing reached the device */
+        if (err == ENXIO) {
+            type |= TRACE_REC_UNSENT;
+        }
+    }
+    trace_record(tr, type, t0, buf, len);
+    errno = err;
+    return ret;
+}
+
+static int trace_read(struct i2clcd_backend *be, uint8_t *buf, size_t len)
+{
+    struct trace_backend *tr = (struct trace_backend *)be;
+    uint64_t t0 = i2clcd_monotonic_ns(tr->ctx);
+    int ret;
+
+    ret = be->inner->ops->read(be->inner, buf, len);
+    if (ret < 0) {
+        trace_record(tr, TRACE_REC_READ | TRACE_REC_FAILED, t0, NULL, 0);
+    } else {
+        trace_record(tr, TRACE_REC_READ, t0, buf, len);
+    }
+    return ret;
+}
+
+static void trace_destroy(struct i2clcd_backend *be)
+{
+    struct trace_backend *tr = (struct trace_backend *)be;
+
+    fclose(tr->fp);
+    free(tr);
+}
+
+static const struct i2clcd_backend_ops trace_ops = {
+    .name    = "trace",
+    .write   = trace_write,
+    .read    = trace_read,
+    .destroy = trace_destroy,
+};
+
+/* Check a trace file against the handle and send its records */
+static i2clcd_err_t replay(i2clcd_t *handle, const char *path,
+                           unsigned int flags)
+{
+    FILE *fp;
+    char magic[TRACE_MAGIC_LEN];
+    uint8_t wiring[TRACE_WIRING_LEN], ours[TRACE_WIRING_LEN];
+    uint8_t buf[TRACE_MAX_REC];
+    uint64_t delta_us, len, deadline;
+    i2clcd_err_t ret = I2CLCD_OK;
+    bool inexact = false;
+    int type, addr;
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        return I2CLCD_ERR_OPEN;
+    }
+
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+        memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_LEN) != 0 ||
+        fgetc(fp) != TRACE_VERSION || (addr = fgetc(fp)) == EOF ||
+        fread(wiring, 1, sizeof(wiring), fp) != sizeof(wiring)) {
+        fclose(fp);
+        return I2CLCD_ERR_IO;
+    }
+
+    /* The bytes were encoded for the recorded backpack's wiring */
+    trace_wiring(handle, ours);
+    if (memcmp(wiring, ours, sizeof(ours)) != 0 ||
+        (addr != handle->i2c_addr && !(flags & I2CLCD_REPLAY_ANY_ADDR))) {
+        fclose(fp);
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    /* The trace drives the controller behind the shadow's back */
+    i2clcd_shadow_reset(handle);
+    if (handle->compositor.enabled) {
+        handle->compositor.dirty = (uint8_t)((1 << handle->rows) - 1);
+    }
+
+    deadline = i2clcd_monotonic_ns(handle);
+    while ((type = fgetc(fp)) != EOF) {
+        if (get_varint(fp, &delta_us) < 0 || get_varint(fp, &len) < 0 ||
+            len > sizeof(buf) || fread(buf, 1, len, fp) != len) {
+            ret = I2CLCD_ERR_IO;
+            break;
+        }
+
+        if (!(flags & I2CLCD_REPLAY_FAST)) {
+            deadline += delta_us * 1000;
+            i2clcd_sleep_until_ns(handle, deadline);
+        }
+
+        if ((type & ~TRACE_REC_FLAGS) != TRACE_REC_READ &&
+            (type & ~TRACE_REC_FLAGS) != TRACE_REC_WRITE) {
+            ret = I2CLCD_ERR_IO;
+            break;
+        }
+        if ((type & ~TRACE_REC_FLAGS) != TRACE_REC_WRITE || len == 0 ||
+            (type & TRACE_REC_UNSENT)) {
+            continue;
+        }
+
+        /* Some of its bytes may have arrived; which ones is unknown */
+        if (type & TRACE_REC_FAILED) {
+            inexact = true;
+            continue;
+        }
+
+        if (i2clcd_bus_write(handle, buf, len) < 0) {
+            ret = I2CLCD_ERR_WRITE;
+            break;
+        }
+    }
+
+    fclose(fp);
+    if (ret == I2CLCD_OK && inexact) {
+        ret = I2CLCD_ERR_INEXACT;
+    }
+    return ret;
+}
+
+/*---------------------------------------------------------------------------
+ * Public API
+ *---------------------------------------------------------------------------*/
+
+i2clcd_err_t i2clcd_trace_start(i2clcd_t *handle, const char *path)
+{
+    struct trace_backend *tr;
+    uint8_t wiring[TRACE_WIRING_LEN];
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!path) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    /* Only one trace at a time */
+    if (i2clcd_backend_find(handle, &trace_ops)) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    tr = calloc(1, sizeof(*tr));
+    if (!tr) {
+        return I2CLCD_ERR_NOMEM;
+    }
+
+    tr->fp = fopen(path, "wb");
+    if (!tr->fp) {
+        free(tr);
+        return I2CLCD_ERR_OPEN;
+    }
+
+    fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_LEN, tr->fp);
+    fputc(TRACE_VERSION, tr->fp);
+    fputc(handle->i2c_addr, tr->fp);
+    trace_wiring(handle, wiring);
+    fwrite(wiring, 1, sizeof(wiring), tr->fp);
+    if (ferror(tr->fp)) {
+        fclose(tr->fp);
+        free(tr);
+        return I2CLCD_ERR_IO;
+    }
+
+    tr->base.ops = &trace_ops;
+    tr->ctx = handle;
+    tr->last_ns = i2clcd_monotonic_ns(handle);
+    i2clcd_backend_push(handle, &tr->base);
+
+    return I2CLCD_OK;
+}
+
+i2clcd_err_t i2clcd_trace_stop(i2clcd_t *handle)
+{
+    struct trace_backend *tr;
+    i2clcd_err_t ret = I2CLCD_OK;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    tr = (struct trace_backend *)i2clcd_backend_find(handle, &trace_ops);
+    if (!tr) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    if (ferror(tr->fp) || fflush(tr->fp) != 0) {
+        ret = I2CLCD_ERR_IO;
+    }
+    i2clcd_backend_remove(handle, &tr->base);
+
+    return ret;
+}
+
+i2clcd_err_t i2clcd_trace_replay(i2clcd_t *handle, const char *path,
+                                 unsigned int flags)
+{
+    uint64_t t0;
+
+    if (!handle) {
+        return I2CLCD_ERR_NOT_INIT;
+    }
+
+    if (!path) {
+        return I2CLCD_ERR_INVALID_ARG;
+    }
+
+    t0 = i2clcd_monotonic_ns(handle);
+    return i2clcd_stats_api(handle, I2CLCD_API_TRACE_REPLAY, t0,
+                            replay(handle, path, flags));
+}
@@ -0,0 +1,1395 @@
+/*
+ * Copyright (c) 2026 Andrew C. Young
+ * SPDX-License-Identifier: MIT
+ *
+ * golden.c - Bus cost regression gate over the emulator
+ *
+ * Runs canonical operation sequences on the emulator with a virtual clock,
+ * checks the final display contents, and compares bus bytes, transactions
+ * and requested delays against a checked-in baseline. Any figure above its
+ * baseline fails the run; use -u to rewrite the baseline after an
+ * intentional change.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "i2clcd.h"
+
+#define MAX_CASES   48
+
+/*---------------------------------------------------------------------------
+ * Sequences
+ *---------------------------------------------------------------------------*/
+
+typedef struct {
+    const char   *name;
+    i2clcd_size_t size;
+    bool          count_init;     /* Include the init sequence in the cost */
+    void        (*run)(i2clcd_t *lcd);
+    const char   *expect[I2CLCD_MAX_ROWS];
+    bool        (*check)(i2clcd_t *lcd); /* Extra state check, may be NULL */
+    void        (*configure)(i2clcd_config_t *config); /* May be NULL */
+} sequence_t;
+
+static const uint8_t glyphs[8][8] = {
+    { 0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00, 0x00 },  /* heart */
+    { 0x04, 0x0E, 0x1F, 0x04, 0x04, 0x04, 0x04, 0x00 },  /* up arrow */
+    { 0x04, 0x04, 0x04, 0x04, 0x1F, 0x0E, 0x04, 0x00 },  /* down arrow */
+    { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x1B, 0x1F, 0x00 },  /* lock */
+    { 0x00, 0x01, 0x03, 0x16, 0x1C, 0x08, 0x00, 0x00 },  /* check */
+    { 0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F, 0x00 },  /* box */
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F },  /* bar 1 */
+    { 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },  /* bar 8 */
+};
+
+static void run_init(i2clcd_t *lcd)
+{
+    (void)lcd;
+}
+
+static void run_set_line(i2clcd_t *lcd)
+{
+    i2clcd_set_line(lcd, 0, "Row zero");
+    i2clcd_set_line(lcd, 1, "Row one");
+    i2clcd_set_line(lcd, 2, "Row two");
+    i2clcd_set_line(lcd, 3, "Row three");
+}
+
+static void run_clear_redraw(i2clcd_t *lcd)
+{
+    i2clcd_clear(lcd);
+    run_set_line(lcd);
+}
+
+static void run_cursor_text(i2clcd_t *lcd)
+{
+    i2clcd_set_cursor(lcd, 4, 1);
+    i2clcd_puts(lcd, "puts");
+    i2clcd_set_cursor(lcd, 0, 0);
+    i2clcd_printf(lcd, "%d+%d=%d", 2, 2, 4);
+    i2clcd_putc(lcd, '!');
+}
+
+static void run_create_char(i2clcd_t *lcd)
+{
+    uint8_t slot;
+
+    for (slot = 0; slot < 8; slot++) {
+        i2clcd_create_char(lcd, slot, glyphs[slot]);
+    }
+}
+
+static bool check_create_char(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t st;
+
+    return i2clcd_emu_state(lcd, &st) == I2CLCD_OK &&
+           memcmp(st.cgram, glyphs, sizeof(glyphs)) == 0;
+}
+
+static void run_counter(i2clcd_t *lcd)
+{
+    unsigned int n;
+
+    i2clcd_compositor_start(lcd, 10);
+    i2clcd_set_line(lcd, 0, "Count:");
+    for (n = 0; n <= 100; n++) {
+        i2clcd_set_cursor(lcd, 10, 0);
+        i2clcd_printf(lcd, "%6u", n);
+        i2clcd_compositor_wait(lcd);
+    }
+    i2clcd_compositor_stop(lcd);
+}
+
+/* Partial writes must be repaired by resync and replay */
+static void run_recovery(i2clcd_t *lcd)
+{
+    i2clcd_fault_config_t faults = {
+        .seed          = 4,
+        .short_ppm     = 50000,
+        .eremoteio_ppm = 20000,
+        .nack_ppm      = 20000,
+    };
+    uint8_t n, row;
+
+    i2clcd_fault_start(lcd, &faults);
+    for (n = 0; n < 8; n++) {
+        for (row = 0; row < 4; row++) {
+            i2clcd_set_cursor(lcd, 0, row);
+            i2clcd_printf(lcd, "Pass %u row %u", n, row);
+        }
+    }
+    i2clcd_fault_stop(lcd);
+}
+
+static bool check_recovery(i2clcd_t *lcd)
+{
+    i2clcd_stats_t st;
+    bool ok;
+
+    /* An initialization nobody answers is an error, not a success */
+    i2clcd_emu_power(lcd, false);
+    ok = i2clcd_reinit(lcd) == I2CLCD_ERR_WRITE;
+    i2clcd_emu_power(lcd, true);
+
+    return ok && i2clcd_stats_get(lcd, &st) == I2CLCD_OK &&
+           st.recoveries > 0 && st.api[I2CLCD_API_INIT].errors == 1;
+}
+
+/* Link events seen by the hot-plug sequence */
+static i2clcd_link_event_t link_events[8];
+static unsigned int link_count;
+
+static void on_link(i2clcd_t *lcd, i2clcd_link_event_t event, void *user)
+{
+    (void)lcd;
+    (void)user;
+    if (link_count < 8) {
+        link_events[link_count++] = event;
+    }
+}
+
+/* Unplug, write while gone, reconnect, then brown out without traffic */
+static void run_hotplug(i2clcd_t *lcd)
+{
+    i2clcd_hotplug_config_t hp = I2CLCD_HOTPLUG_CONFIG_DEFAULT;
+
+    hp.probe_interval_ms = 0;
+    hp.callback = on_link;
+    i2clcd_set_hotplug(lcd, &hp);
+    link_count = 0;
+
+    run_set_line(lcd);
+    i2clcd_emu_power(lcd, false);
+    i2clcd_set_line(lcd, 1, "Written while gone");
+    i2clcd_poll(lcd, NULL);
+    i2clcd_emu_power(lcd, true);
+    i2clcd_poll(lcd, NULL);
+
+    i2clcd_emu_power(lcd, true);
+    i2clcd_poll(lcd, NULL);
+    i2clcd_set_line(lcd, 3, "Back");
+}
+
+static bool check_hotplug(i2clcd_t *lcd)
+{
+    bool up = false;
+
+    return link_count == 3 &&
+           link_events[0] == I2CLCD_LINK_LOST &&
+           link_events[1] == I2CLCD_LINK_RESTORED &&
+           link_events[2] == I2CLCD_LINK_BROWNOUT &&
+           i2clcd_poll(lcd, &up) == I2CLCD_OK && up;
+}
+
+/* Scrub one full sweep from a fresh position */
+static void scrub_sweep(i2clcd_t *lcd)
+{
+    i2clcd_scrub_config_t sc = I2CLCD_SCRUB_CONFIG_DEFAULT;
+    unsigned int n;
+
+    sc.interval_ms = 0;
+    i2clcd_set_scrub(lcd, &sc);
+    /* 80 DDRAM cells and 8 CGRAM rows: 11 steps, one more to wrap */
+    for (n = 0; n < 12; n++) {
+        i2clcd_scrub_step(lcd);
+    }
+}
+
+/* Corrupt the glass behind the library's back, then scrub one sweep */
+static void run_scrub(i2clcd_t *lcd)
+{
+    run_set_line(lcd);
+    i2clcd_create_char(lcd, 0, glyphs[0]);
+    i2clcd_stats_reset(lcd);
+
+    i2clcd_emu_glitch(lcd, false, 0x00, 'X');
+    i2clcd_emu_glitch(lcd, false, 0x54 + 19, 'Y');
+    i2clcd_emu_glitch(lcd, true, 3, 0x00);
+
+    scrub_sweep(lcd);
+}
+
+static bool check_scrub(i2clcd_t *lcd)
+{
+    i2clcd_scrub_stats_t st;
+    i2clcd_emu_state_t emu;
+
+    return i2clcd_scrub_stats(lcd, &st) == I2CLCD_OK && st.sweeps == 1 &&
+           st.verified == 96 && st.mismatches == 3 && st.cells == 3 &&
+           i2clcd_emu_state(lcd, &emu) == I2CLCD_OK &&
+           memcmp(emu.cgram, glyphs[0], 8) == 0;
+}
+
+/* A sweep over a clean panel: read back (PCF8574) or rewritten blind */
+static uint64_t writes_before;
+
+static void run_scrub_clean(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t emu;
+
+    run_set_line(lcd);
+    i2clcd_create_char(lcd, 0, glyphs[0]);
+    i2clcd_stats_reset(lcd);
+
+    writes_before = i2clcd_emu_state(lcd, &emu) == I2CLCD_OK ?
+                    emu.data_writes : 0;
+    scrub_sweep(lcd);
+}
+
+static bool check_scrub_clean(i2clcd_t *lcd)
+{
+    i2clcd_scrub_stats_t st;
+    i2clcd_emu_state_t emu;
+
+    return i2clcd_scrub_stats(lcd, &st) == I2CLCD_OK && st.sweeps == 1 &&
+           st.verified == 96 && st.mismatches == 0 && st.cells == 0 &&
+           i2clcd_emu_state(lcd, &emu) == I2CLCD_OK &&
+           emu.data_writes == writes_before;
+}
+
+static bool check_scrub_blind(i2clcd_t *lcd)
+{
+    i2clcd_scrub_stats_t st;
+
+    return i2clcd_scrub_stats(lcd, &st) == I2CLCD_OK && st.sweeps == 1 &&
+           st.verified == 0 && st.cells == 96;
+}
+
+static uint64_t reads_before;
+
+/* Another writer changes a cell; a synced shadow fixes it in one write */
+static void run_readback(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t emu;
+
+    run_set_line(lcd);
+    i2clcd_create_char(lcd, 0, glyphs[0]);
+    i2clcd_emu_glitch(lcd, false, 0x40 + 4, 'X');
+    i2clcd_stats_reset(lcd);
+
+    i2clcd_emu_state(lcd, &emu);
+    reads_before = emu.data_reads;
+    i2clcd_sync_shadow(lcd);
+    i2clcd_set_line(lcd, 1, "Row one");
+}
+
+static bool check_readback(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t emu;
+    uint8_t row[8];
+    return i2clcd_emu_state(lcd, &emu) == I2CLCD_OK &&
+           emu.data_reads - reads_before == 64 + 2 * 40 &&
+           i2clcd_read_mem(lcd, true, 0, row, sizeof(row)) == I2CLCD_OK &&
+           memcmp(row, glyphs[0], sizeof(row)) == 0;
+}
+
+static void config_mjkdz(i2clcd_config_t *config)
+{
+    static const i2clcd_pinmap_t mjkdz = I2CLCD_PINMAP_MJKDZ;
+
+    config->pinmap = &mjkdz;
+}
+
+/* Text, CGRAM and an inverted backlight through a different wiring */
+static void run_pinmap(i2clcd_t *lcd)
+{
+    run_set_line(lcd);
+    i2clcd_create_char(lcd, 0, glyphs[0]);
+    i2clcd_backlight(lcd, false);
+}
+
+static bool check_pinmap(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t emu;
+    uint8_t row[8];
+
+    return i2clcd_emu_state(lcd, &emu) == I2CLCD_OK && !emu.backlight &&
+           i2clcd_read_mem(lcd, true, 0, row, sizeof(row)) == I2CLCD_OK &&
+           memcmp(row, glyphs[0], sizeof(row)) == 0;
+}
+
+static void config_mcp23008(i2clcd_config_t *config)
+{
+    static const i2clcd_pinmap_t map = I2CLCD_PINMAP_MCP23008;
+
+    config->pinmap = &map;
+    config->expander = I2CLCD_EXPANDER_MCP23008;
+}
+
+static void config_mcp23017(i2clcd_config_t *config)
+{
+    config->expander = I2CLCD_EXPANDER_MCP23017;
+}
+
+/*
+ * Enable strobes and controller bytes of one set_line run: the 4-bit bus
+ * takes two strobes per byte, the MCP23017's 8-bit bus one. The bus bytes
+ * and transactions per character stay the same.
+ */
+static uint64_t run_strobes, run_bytes;
+
+static void run_set_line_strobes(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t before, after;
+
+    i2clcd_emu_state(lcd, &before);
+    run_set_line(lcd);
+    i2clcd_emu_state(lcd, &after);
+
+    run_strobes = after.strobes - before.strobes;
+    run_bytes = (after.instructions - before.instructions) +
+                (after.data_writes - before.data_writes);
+}
+
+static bool check_4bit(i2clcd_t *lcd)
+{
+    (void)lcd;
+    return run_bytes > 0 && run_strobes == 2 * run_bytes;
+}
+
+static bool check_8bit(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t emu;
+
+    return i2clcd_emu_state(lcd, &emu) == I2CLCD_OK && !emu.four_bit &&
+           run_bytes > 0 && run_strobes == run_bytes;
+}
+
+/* Every enable pulse lost on the 8-bit bus: one drop per byte, no data */
+static bool drop_ok;
+
+static void run_drop_nibble(i2clcd_t *lcd)
+{
+    i2clcd_fault_config_t faults = {
+        .seed            = 1,
+        .drop_nibble_ppm = 1000000,
+    };
+    i2clcd_fault_stats_t fst;
+    i2clcd_emu_state_t before, after;
+
+    i2clcd_emu_state(lcd, &before);
+    drop_ok = i2clcd_fault_start(lcd, &faults) == I2CLCD_OK;
+    i2clcd_set_line(lcd, 0, "Row zero");
+    drop_ok &= i2clcd_fault_stats(lcd, &fst) == I2CLCD_OK &&
+               i2clcd_fault_stop(lcd) == I2CLCD_OK;
+    i2clcd_emu_state(lcd, &after);
+
+    /* Set DDRAM plus 20 characters; data bytes with the EN bit are kept */
+    drop_ok &= fst.dropped_nibbles == 21 && after.strobes == before.strobes;
+}
+
+static bool check_drop_nibble(i2clcd_t *lcd)
+{
+    (void)lcd;
+    return drop_ok;
+}
+
+static void config_plate(i2clcd_config_t *config)
+{
+    config->expander = I2CLCD_EXPANDER_RGB_PLATE;
+}
+
+static bool check_plate(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t emu;
+
+    return i2clcd_emu_state(lcd, &emu) == I2CLCD_OK && emu.four_bit &&
+           emu.color == I2CLCD_COLOR_WHITE;
+}
+
+static i2clcd_button_event_t button_events[4];
+static unsigned int button_count;
+
+/* Press SELECT while a frame is pending, release it over the next frame */
+static void run_buttons(i2clcd_t *lcd)
+{
+    i2clcd_buttons_config_t bc = I2CLCD_BUTTONS_CONFIG_DEFAULT;
+    bool got = true;
+
+    i2clcd_set_buttons(lcd, &bc);
+    i2clcd_set_color(lcd, I2CLCD_COLOR_RED | I2CLCD_COLOR_BLUE);
+    i2clcd_compositor_start(lcd, 20);
+
+    i2clcd_emu_buttons(lcd, I2CLCD_BUTTON_SELECT);
+    run_set_line(lcd);
+    i2clcd_compositor_wait(lcd);
+    i2clcd_emu_buttons(lcd, 0);
+    i2clcd_compositor_wait(lcd);
+    i2clcd_compositor_stop(lcd);
+
+    for (button_count = 0; got && button_count < 4; button_count++) {
+        i2clcd_button_event(lcd, &button_events[button_count], &got);
+    }
+    button_count--;
+}
+
+static bool check_buttons(i2clcd_t *lcd)
+{
+    i2clcd_buttons_stats_t st;
+    i2clcd_emu_state_t emu;
+
+    return button_count == 2 &&
+           button_events[0].button == I2CLCD_BUTTON_SELECT &&
+           button_events[0].pressed &&
+           button_events[1].button == I2CLCD_BUTTON_SELECT &&
+           !button_events[1].pressed &&
+           i2clcd_buttons_stats(lcd, &st) == I2CLCD_OK && st.late == 0 &&
+           i2clcd_emu_state(lcd, &emu) == I2CLCD_OK &&
+           emu.color == (I2CLCD_COLOR_RED | I2CLCD_COLOR_BLUE);
+}
+
+/* Both controllers of a 40x4 panel hold two lines each */
+static bool check_dual(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t e1, e2;
+
+    return i2clcd_emu_controller(lcd, 0, &e1) == I2CLCD_OK &&
+           i2clcd_emu_controller(lcd, 1, &e2) == I2CLCD_OK &&
+           e1.four_bit && e2.four_bit &&
+           e1.instructions == e2.instructions &&
+           e1.data_writes == e2.data_writes;
+}
+
+/* The harness's clear and the sequence's each take one clear time for
+ * both halves, not one per half */
+static bool check_concurrent(i2clcd_t *lcd)
+{
+    i2clcd_stats_t st;
+
+    return check_dual(lcd) && i2clcd_stats_get(lcd, &st) == I2CLCD_OK &&
+           st.sleep_ns < 3 * 1520000;
+}
+
+static void run_cursor_40x4(i2clcd_t *lcd)
+{
+    i2clcd_cursor(lcd, true);
+    i2clcd_set_cursor(lcd, 0, 2);
+    i2clcd_puts(lcd, "E2");
+    i2clcd_set_cursor(lcd, 0, 1);
+    i2clcd_puts(lcd, "E1");
+}
+
+/* The cursor shows on the controller it was last placed on */
+static bool check_cursor_40x4(i2clcd_t *lcd)
+{
+    i2clcd_emu_state_t e1, e2;
+
+    return i2clcd_emu_controller(lcd, 0, &e1) == I2CLCD_OK &&
+           i2clcd_emu_controller(lcd, 1, &e2) == I2CLCD_OK &&
+           (e1.display_ctrl & 0x02) && !(e2.display_ctrl & 0x02) &&
+           e1.ac == 0x42 && e2.ac == 0x02;
+}
+
+/* Three panels behind one TCA9548A: lcd and c on channel 0, b on 1 */
+static i2clcd_mux_t *mux;
+static uint64_t mux_selects;
+static bool mux_lines_ok;
+
+static void config_mux(i2clcd_config_t *config)
+{
+    i2clcd_mux_create(0x70, &mux);
+    config->mux = mux;
+    config->mux_channel = 0;
+}
+
+static void run_mux_flush(i2clcd_t *lcd)
+{
+    i2clcd_config_t config = I2CLCD_CONFIG_DEFAULT;
+    i2clcd_vclock_t vc;
+    i2clcd_clock_t clock;
+    i2clcd_mux_stats_t before, after;
+    i2clcd_t *b = NULL, *c = NULL;
+    char line[I2CLCD_MAX_COLS + 1];
+
+    i2clcd_vclock_init(&vc, &clock);
+    config.size = I2CLCD_16X2;
+    config.backend = I2CLCD_BACKEND_EMULATOR;
+    config.clock = &clock;
+    config.mux = mux;
+    config.mux_channel = 1;
+    i2clcd_init(&config, &b);
+    config.mux_channel = 0;
+    i2clcd_init(&config, &c);
+
+    i2clcd_compositor_start(lcd, 10);
+    i2clcd_compositor_start(b, 10);
+    i2clcd_compositor_start(c, 10);
+    i2clcd_set_line(lcd, 0, "Channel 0 a");
+    i2clcd_set_line(b, 0, "Channel 1 b");
+    i2clcd_set_line(c, 0, "Channel 0 c");
+
+    /* In caller order that would be two selects; grouped it is one */
+    i2clcd_mux_stats(mux, &before);
+    i2clcd_mux_flush((i2clcd_t *const[]){ lcd, b, c }, 3);
+    i2clcd_mux_stats(mux, &after);
+    mux_selects = after.selects - before.selects;
+
+    mux_lines_ok = true;
+    i2clcd_emu_line(b, 0, line, sizeof(line));
+    mux_lines_ok &= strcmp(line, "Channel 1 b     ") == 0;
+    i2clcd_emu_line(c, 0, line, sizeof(line));
+    mux_lines_ok &= strcmp(line, "Channel 0 c     ") == 0;
+
+    i2clcd_deinit(b);
+    i2clcd_deinit(c);
+}
+
+static bool check_mux_flush(i2clcd_t *lcd)
+{
+    (void)lcd;
+    i2clcd_mux_destroy(mux);
+    mux = NULL;
+    return mux_lines_ok && mux_selects == 1;
+}
+
+/* A 32x4 canvas of four 16x2 panels; lcd is the top-left one */
+static bool canvas_ok;
+
+static void run_canvas(i2clcd_t *lcd)
+{
+    static const char *const expect[3][2] = {
+        { "wall            ", "                " },
+        { "Hello world! Row", "   ^^           " },
+        { "Row three       ", "                " },
+    };
+    i2clcd_config_t config = I2CLCD_CONFIG_DEFAULT;
+    i2clcd_vclock_t vc[3];
+    i2clcd_clock_t clock[3];
+    i2clcd_canvas_t *canvas;
+    i2clcd_canvas_stats_t st;
+    i2clcd_t *panel[3] = { NULL, NULL, NULL };
+    char line[I2CLCD_MAX_COLS + 1];
+    unsigned int i, r;
+
+    /* Separate clocks, so each panel counts as its own bus */
+    config.size = I2CLCD_16X2;
+    config.backend = I2CLCD_BACKEND_EMULATOR;
+    canvas_ok = i2clcd_canvas_create(32, 4, &canvas) == I2CLCD_OK;
+    for (i = 0; i < 3; i++) {
+        i2clcd_vclock_init(&vc[i], &clock[i]);
+        config.clock = &clock[i];
+        i2clcd_init(&config, &panel[i]);
+        i2clcd_clear(panel[i]);
+        i2clcd_compositor_start(panel[i], 10);
+    }
+    i2clcd_compositor_start(lcd, 10);
+
+    i2clcd_canvas_attach(canvas, lcd, 0, 0);
+    i2clcd_canvas_attach(canvas, panel[0], 16, 0);
+    i2clcd_canvas_attach(canvas, panel[1], 0, 2);
+    i2clcd_canvas_attach(canvas, panel[2], 16, 2);
+    canvas_ok &= i2clcd_canvas_attach(canvas, panel[2], 8, 1) ==
+                 I2CLCD_ERR_INVALID_ARG;
+
+    i2clcd_canvas_write(canvas, 4, 0, "Hello video wall");
+    i2clcd_canvas_write(canvas, 0, 2, "Hello world! Row one");
+    i2clcd_canvas_write(canvas, 16, 2, "Row three");
+    i2clcd_canvas_write(canvas, 3, 3, "^^");
+    canvas_ok &= i2clcd_canvas_flush(canvas, true) == I2CLCD_OK;
+
+    /* A second write of the same text costs nothing */
+    i2clcd_canvas_write(canvas, 0, 2, "Hello world!");
+    canvas_ok &= i2clcd_canvas_flush(canvas, true) == I2CLCD_OK;
+
+    canvas_ok &= i2clcd_canvas_stats(canvas, &st) == I2CLCD_OK &&
+                 st.flushes == 2 && st.buses == 4;
+    for (i = 0; i < 3; i++) {
+        for (r = 0; r < 2; r++) {
+            i2clcd_emu_line(panel[i], (uint8_t)r, line, sizeof(line));
+            canvas_ok &= strcmp(line, expect[i][r]) == 0;
+        }
+        i2clcd_deinit(panel[i]);
+    }
+    i2clcd_canvas_destroy(canvas);
+}
+
+static bool check_canvas(i2clcd_t *lcd)
+{
+    (void)lcd;
+    return canvas_ok;
+}
+
+/*
+ * Attached in an order that hides the chain: lcd (mux M), then b (budget Q
+ * only), then c (mux M and budget Q). All three contend, so one bus.
+ */
+static bool chain_ok;
+
+static void run_canvas_chain(i2clcd_t *lcd)
+{
+    i2clcd_budget_config_t bc = I2CLCD_BUDGET_CONFIG_DEFAULT;
+    i2clcd_config_t config = I2CLCD_CONFIG_DEFAULT;
+    i2clcd_vclock_t vc;
+    i2clcd_clock_t clock;
+    i2clcd_budget_t *budget = NULL;
+    i2clcd_canvas_t *canvas;
+    i2clcd_canvas_stats_t st;
+    i2clcd_t *b = NULL, *c = NULL;
+    char line[I2CLCD_MAX_COLS + 1];
+
+    i2clcd_vclock_init(&vc, &clock);
+    config.size = I2CLCD_16X2;
+    config.backend = I2CLCD_BACKEND_EMULATOR;
+    config.clock = &clock;
+    chain_ok = i2clcd_budget_create(&bc, &budget) == I2CLCD_OK &&
+               i2clcd_init(&config, &b) == I2CLCD_OK;
+    config.mux = mux;
+    config.mux_channel = 1;
+    chain_ok &= i2clcd_init(&config, &c) == I2CLCD_OK;
+    i2clcd_set_budget(b, budget);
+    i2clcd_set_budget(c, budget);
+
+    i2clcd_compositor_start(lcd, 10);
+    i2clcd_compositor_start(b, 10);
+    i2clcd_compositor_start(c, 10);
+    chain_ok &= i2clcd_canvas_create(16, 6, &canvas) == I2CLCD_OK;
+    i2clcd_canvas_attach(canvas, lcd, 0, 0);
+    i2clcd_canvas_attach(canvas, b, 0, 2);
+    i2clcd_canvas_attach(canvas, c, 0, 4);
+
+    i2clcd_canvas_write(canvas, 0, 0, "Mux M channel 0");
+    i2clcd_canvas_write(canvas, 0, 2, "Budget Q");
+    i2clcd_canvas_write(canvas, 0, 4, "Mux M, budget Q");
+    chain_ok &= i2clcd_canvas_flush(canvas, true) == I2CLCD_OK &&
+                i2clcd_canvas_stats(canvas, &st) == I2CLCD_OK &&
+                st.buses == 1;
+
+    i2clcd_emu_line(b, 0, line, sizeof(line));
+    chain_ok &= strcmp(line, "Budget Q        ") == 0;
+    i2clcd_emu_line(c, 0, line, sizeof(line));
+    chain_ok &= strcmp(line, "Mux M, budget Q ") == 0;
+
+    i2clcd_canvas_destroy(canvas);
+    i2clcd_deinit(b);
+    i2clcd_deinit(c);
+    i2clcd_budget_destroy(budget);
+}
+
+static bool check_canvas_chain(i2clcd_t *lcd)
+{
+    (void)lcd;
+    i2clcd_mux_destroy(mux);
+    mux = NULL;
+    return chain_ok;
+}
+
+/* Two mirrors of lcd; 0x26 loses power for one update and is healed */
+static bool mirror_ok;
+
+static bool mirror_matches(i2clcd_t *lcd, uint8_t addr)
+{
+    char want[I2CLCD_MAX_COLS + 1], got[I2CLCD_MAX_COLS + 1];
+    bool same = true;
+    uint8_t r;
+
+    for (r = 0; r < 2; r++) {
+        i2clcd_emu_view(lcd, 0x27);
+        i2clcd_emu_line(lcd, r, want, sizeof(want));
+        i2clcd_emu_view(lcd, addr);
+        i2clcd_emu_line(lcd, r, got, sizeof(got));
+        same &= strcmp(want, got) == 0;
+    }
+    i2clcd_emu_view(lcd, 0x27);
+    return same;
+}
+
+static void run_mirror(i2clcd_t *lcd)
+{
+    i2clcd_mirror_stats_t st;
+
+    mirror_ok = i2clcd_mirror_add(lcd, 0x26) == I2CLCD_OK &&
+                i2clcd_mirror_add(lcd, 0x25) == I2CLCD_OK &&
+                i2clcd_mirror_add(lcd, 0x25) == I2CLCD_ERR_INVALID_ARG;
+
+    i2clcd_set_line(lcd, 0, "Same on all");
+    i2clcd_set_line(lcd, 1, "three panels");
+    mirror_ok &= mirror_matches(lcd, 0x26) && mirror_matches(lcd, 0x25);
+
+    i2clcd_emu_view(lcd, 0x26);
+    i2clcd_emu_power(lcd, false);
+    i2clcd_set_line(lcd, 1, "Missed by two");
+    i2clcd_emu_power(lcd, true);
+    i2clcd_emu_view(lcd, 0x27);
+
+    mirror_ok &= i2clcd_mirror_stats(lcd, &st) == I2CLCD_OK &&
+                 st.members == 2 && st.diverged == 2 && st.failures == 1;
+    mirror_ok &= i2clcd_mirror_sync(lcd) == I2CLCD_OK &&
+                 mirror_matches(lcd, 0x26) && mirror_matches(lcd, 0x25);
+    mirror_ok &= i2clcd_mirror_stats(lcd, &st) == I2CLCD_OK &&
+                 st.diverged == 0 && st.heals == 4;
+}
+
+static bool check_mirror(i2clcd_t *lcd)
+{
+    (void)lcd;
+    return mirror_ok;
+}
+
+/*
+ * Three mirrors under the default budget: every member's bytes are charged,
+ * no combined transfer holds more than 32 bytes, and a member that misses
+ * its transfer diverges alone
+ */
+static void run_mirror_budget(i2clcd_t *lcd)
+{
+    i2clcd_budget_config_t bc = I2CLCD_BUDGET_CONFIG_DEFAULT;
+    i2clcd_budget_stats_t b0, b1;
+    i2clcd_mirror_stats_t st;
+    i2clcd_stats_t s0, s1;
+    i2clcd_budget_t *budget = NULL;
+
+    mirror_ok = i2clcd_budget_create(&bc, &budget) == I2CLCD_OK &&
+                i2clcd_set_budget(lcd, budget) == I2CLCD_OK &&
+                i2clcd_mirror_add(lcd, 0x26) == I2CLCD_OK &&
+                i2clcd_mirror_add(lcd, 0x25) == I2CLCD_OK &&
+                i2clcd_mirror_add(lcd, 0x24) == I2CLCD_OK;
+
+    i2clcd_stats_get(lcd, &s0);
+    i2clcd_budget_stats(budget, &b0);
+    i2clcd_set_line(lcd, 0, "Same on all");
+    i2clcd_set_line(lcd, 1, "four panels");
+    i2clcd_stats_get(lcd, &s1);
+    i2clcd_budget_stats(budget, &b1);
+    mirror_ok &= b1.bytes - b0.bytes == s1.bytes - s0.bytes &&
+                 mirror_matches(lcd, 0x26) && mirror_matches(lcd, 0x25) &&
+                 mirror_matches(lcd, 0x24);
+
+    i2clcd_emu_view(lcd, 0x25);
+    i2clcd_emu_power(lcd, false);
+    i2clcd_set_line(lcd, 1, "Missed by one");
+    i2clcd_emu_power(lcd, true);
+    i2clcd_emu_view(lcd, 0x27);
+
+    mirror_ok &= i2clcd_mirror_stats(lcd, &st) == I2CLCD_OK &&
+                 st.diverged == 1 && st.failures == 1 &&
+                 mirror_matches(lcd, 0x26) && mirror_matches(lcd, 0x24);
+    mirror_ok &= i2clcd_mirror_sync(lcd) == I2CLCD_OK &&
+                 mirror_matches(lcd, 0x25);
+
+    i2clcd_set_budget(lcd, NULL);
+    i2clcd_budget_destroy(budget);
+}
+
+/* A font pack in one upload; the cursor stays where it was */
+static bool create_chars_ok;
+
+static void run_create_chars(i2clcd_t *lcd)
+{
+    uint8_t pack[8][8];
+    i2clcd_emu_state_t st;
+    i2clcd_stats_t before, after;
+
+    i2clcd_set_cursor(lcd, 4, 1);
+    create_chars_ok = i2clcd_create_chars(lcd, 0, 8, glyphs) == I2CLCD_OK;
+    i2clcd_putc(lcd, '!');
+
+    /* Unchanged rows cost nothing */
+    i2clcd_stats_get(lcd, &before);
+    create_chars_ok &= i2clcd_create_chars(lcd, 2, 6, &glyphs[2]) ==
+                       I2CLCD_OK;
+    i2clcd_stats_get(lcd, &after);
+    create_chars_ok &= after.bytes == before.bytes;
+
+    /* Two changed rows far apart go out as two runs */
+    memcpy(pack, glyphs, sizeof(pack));
+    pack[1][0] ^= 0x1F;
+    pack[6][7] ^= 0x1F;
+    create_chars_ok &= i2clcd_create_chars(lcd, 0, 8, pack) == I2CLCD_OK;
+    i2clcd_putc(lcd, '?');
+
+    create_chars_ok &= i2clcd_create_chars(lcd, 7, 2, glyphs) ==
+                       I2CLCD_ERR_RANGE &&
+                       i2clcd_emu_state(lcd, &st) == I2CLCD_OK &&
+                       memcmp(st.cgram, pack, sizeof(pack)) == 0;
+}
+
+static bool check_create_chars(i2clcd_t *lcd)
+{
+    i2clcd_stats_t st;
+
+    /* Uploads have their own histogram; the range error never started */
+    return create_chars_ok && i2clcd_stats_get(lcd, &st) == I2CLCD_OK &&
+           st.api[I2CLCD_API_CREATE_CHARS].count == 3 &&
+           st.api[I2CLCD_API_CREATE_CHAR].count == 0;
+}
+
+/* More glyphs than slots; the ones on screen must survive */
+static bool glyph_ok;
+
+static void run_glyph(i2clcd_t *lcd)
+{
+    static const uint8_t extra[8] = {
+        0x1F, 0x15, 0x0A, 0x04, 0x0A, 0x15, 0x1F, 0x00 }; /* hourglass */
+    i2clcd_glyph_stats_t gst;
+    i2clcd_emu_state_t est;
+    i2clcd_stats_t before, after;
+    uint8_t i, slot;
+
+    glyph_ok = true;
+    for (i = 0; i < 8; i++) {
+        glyph_ok &= i2clcd_glyph(lcd, glyphs[i], &slot) == I2CLCD_OK &&
+                    slot == i;
+    }
+    i2clcd_set_line(lcd, 0, "\x08\x09");
+
+    /* A hit costs nothing on the bus */
+    i2clcd_stats_get(lcd, &before);
+    glyph_ok &= i2clcd_glyph(lcd, glyphs[0], &slot) == I2CLCD_OK &&
+                slot == 0;
+    i2clcd_stats_get(lcd, &after);
+    glyph_ok &= after.bytes == before.bytes;
+
+    /* Slots 0 and 1 are shown; 2 is the least recently requested */
+    glyph_ok &= i2clcd_glyph(lcd, extra, &slot) == I2CLCD_OK && slot == 2 &&
+                i2clcd_emu_state(lcd, &est) == I2CLCD_OK &&
+                memcmp(&est.cgram[2 << 3], extra, 8) == 0;
+
+    i2clcd_set_line(lcd, 1, "\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f");
+    glyph_ok &= i2clcd_glyph(lcd, glyphs[2], &slot) == I2CLCD_ERR_RANGE;
+
+    glyph_ok &= i2clcd_glyph_stats(lcd, &gst) == I2CLCD_OK &&
+                gst.hits == 1 && gst.misses == 9 && gst.evictions == 1 &&
+                gst.full == 1;
+}
+
+static bool check_glyph(i2clcd_t *lcd)
+{
+    i2clcd_stats_t st;
+
+    return glyph_ok && i2clcd_stats_get(lcd, &st) == I2CLCD_OK &&
+           st.api[I2CLCD_API_GLYPH].count == 11 &&
+           st.api[I2CLCD_API_GLYPH].errors == 1 &&
+           st.api[I2CLCD_API_CREATE_CHAR].count == 9;
+}
+
+/* A looping spinner and a one-shot fill, turned by the compositor's wait */
+static bool anim_ok;
+
+static void run_anim(i2clcd_t *lcd)
+{
+    static const uint8_t spinner[4][8] = {
+        { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00 },  /* | */
+        { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00, 0x00 },  /* / */
+        { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00, 0x00 },  /* - */
+        { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00 },  /* \ */
+    };
+    i2clcd_anim_stats_t st;
+    i2clcd_emu_state_t est;
+    int i;
+
+    i2clcd_set_line(lcd, 0, "Busy \x08");
+    i2clcd_set_line(lcd, 1, "\x09");
+    anim_ok = i2clcd_anim_start(lcd, 0, spinner, 4, 250, true) ==
+              I2CLCD_OK &&
+              i2clcd_anim_start(lcd, 1, &glyphs[5], 3, 100, false) ==
+              I2CLCD_OK &&
+              i2clcd_anim_start(lcd, 2, spinner, 0, 100, true) ==
+              I2CLCD_ERR_RANGE;
+
+    /* One second of frames at 10 fps, with nothing to redraw */
+    i2clcd_compositor_start(lcd, 10);
+    for (i = 0; i < 10; i++) {
+        anim_ok &= i2clcd_compositor_wait(lcd) == I2CLCD_OK;
+    }
+    i2clcd_compositor_stop(lcd);
+
+    anim_ok &= i2clcd_anim_stats(lcd, &st) == I2CLCD_OK &&
+               st.frames == 6 && st.skipped == 0 &&
+               i2clcd_emu_state(lcd, &est) == I2CLCD_OK &&
+               memcmp(&est.cgram[0], spinner[0], 8) == 0 &&
+               memcmp(&est.cgram[8], glyphs[7], 8) == 0;
+}
+
+static bool check_anim(i2clcd_t *lcd)
+{
+    (void)lcd;
+    return anim_ok;
+}
+
+/*
+ * A bulk redraw queued at LOW and NORMAL, then an alert over part of it:
+ * the alert reaches the glass at once, and the bulk cells it replaced are
+ * never sent
+ */
+static bool prio_ok;
+
+static void run_priority(i2clcd_t *lcd)
+{
+    i2clcd_prio_stats_t low, normal, high;
+    i2clcd_emu_state_t e0, e1;
+    char line[I2CLCD_MAX_COLS + 1];
+
+    i2clcd_compositor_start(lcd, 10);
+    i2clcd_set_priority(lcd, I2CLCD_PRIO_LOW);
+    i2clcd_set_line(lcd, 0, "Bulk refresh 000");
+    i2clcd_set_priority(lcd, I2CLCD_PRIO_NORMAL);
+    i2clcd_set_line(lcd, 1, "Bulk refresh 111");
+
+    i2clcd_priority_stats(lcd, I2CLCD_PRIO_LOW, &low);
+    i2clcd_priority_stats(lcd, I2CLCD_PRIO_NORMAL, &normal);
+    i2clcd_emu_line(lcd, 0, line, sizeof(line));
+    prio_ok = low.depth == 14 && normal.depth == 14 &&
+              strcmp(line, "                ") == 0;
+
+    i2clcd_emu_state(lcd, &e0);
+    i2clcd_set_priority(lcd, I2CLCD_PRIO_HIGH);
+    i2clcd_set_cursor(lcd, 0, 0);
+    i2clcd_puts(lcd, "ALERT");
+    i2clcd_emu_state(lcd, &e1);
+
+    /* Four replaced LOW cells count as superseded; "T" covered a blank */
+    i2clcd_priority_stats(lcd, I2CLCD_PRIO_LOW, &low);
+    i2clcd_priority_stats(lcd, I2CLCD_PRIO_HIGH, &high);
+    i2clcd_emu_line(lcd, 0, line, sizeof(line));
+    prio_ok &= strcmp(line, "ALERT           ") == 0 &&
+               e1.data_writes - e0.data_writes == 5 &&
+               high.depth == 0 && high.cells == 5 && high.flushes == 1 &&
+               low.depth == 10 && low.superseded == 4;
+
+    /* The frame sends NORMAL then LOW a period after queueing: 32 cells
+     * in all with the alert, so the replaced "Bulk" never went out */
+    i2clcd_emu_state(lcd, &e0);
+    prio_ok &= i2clcd_compositor_wait(lcd) == I2CLCD_OK;
+    i2clcd_emu_state(lcd, &e1);
+    i2clcd_priority_stats(lcd, I2CLCD_PRIO_LOW, &low);
+    i2clcd_priority_stats(lcd, I2CLCD_PRIO_NORMAL, &normal);
+    i2clcd_priority_stats(lcd, I2CLCD_PRIO_HIGH, &high);
+    prio_ok &= low.depth == 0 && normal.depth == 0 &&
+               normal.cells == 16 && low.cells == 11 &&
+               e1.data_writes - e0.data_writes == 27 &&
+               normal.latency_max_ns == 100000000 &&
+               low.latency_max_ns == 100000000 &&
+               high.latency_max_ns < low.latency_max_ns;
+    i2clcd_compositor_stop(lcd);
+}
+
+static bool check_priority(i2clcd_t *lcd)
+{
+    (void)lcd;
+    return prio_ok;
+}
+
+/* A recorded workload replayed onto fresh handles, good and bad */
+static bool trace_ok;
+
+static i2clcd_err_t replay_fresh(const char *path, unsigned int flags,
+                                 uint8_t addr,
+                                 void (*configure)(i2clcd_config_t *),
+                                 i2clcd_emu_state_t *st)
+{
+    i2clcd_config_t config = I2CLCD_CONFIG_DEFAULT;
+    i2clcd_vclock_t vc;
+    i2clcd_clock_t clock;
+    i2clcd_t *lcd;
+    i2clcd_err_t err;
+
+    i2clcd_vclock_init(&vc, &clock);
+    config.size = I2CLCD_16X2;
+    config.backend = I2CLCD_BACKEND_EMULATOR;
+    config.clock = &clock;
+    config.i2c_addr = addr;
+    if (configure) {
+        configure(&config);
+    }
+    if (i2clcd_init(&config, &lcd) != I2CLCD_OK) {
+        return I2CLCD_ERR_OPEN;
+    }
+
+    err = i2clcd_trace_replay(lcd, path, flags);
+    i2clcd_emu_state(lcd, st);
+    i2clcd_deinit(lcd);
+    return err;
+}
+
+static void run_trace(i2clcd_t *lcd)
+{
+    char path[] = "/tmp/golden-trace-XXXXXX";
+    i2clcd_emu_state_t want, got;
+    FILE *fp;
+    long size;
+    int fd;
+
+    fd = mkstemp(path);
+    trace_ok = fd >= 0;
+    if (!trace_ok) {
+        return;
+    }
+    close(fd);
+
+    trace_ok = i2clcd_trace_start(lcd, path) == I2CLCD_OK;
+    i2clcd_create_chars(lcd, 0, 8, glyphs);
+    i2clcd_set_line(lcd, 0, "Traced \x08\x09");
+    i2clcd_set_line(lcd, 1, "and replayed");
+    trace_ok &= i2clcd_trace_stop(lcd) == I2CLCD_OK &&
+                i2clcd_emu_state(lcd, &want) == I2CLCD_OK;
+
+    trace_ok &= replay_fresh(path, I2CLCD_REPLAY_FAST, 0x27, NULL, &got) ==
+                I2CLCD_OK &&
+                memcmp(got.ddram, want.ddram, sizeof(want.ddram)) == 0 &&
+                memcmp(got.cgram, want.cgram, sizeof(want.cgram)) == 0;
+
+    /* Another address only with ANY_ADDR; other wiring never */
+    trace_ok &= replay_fresh(path, I2CLCD_REPLAY_FAST, 0x26, NULL, &got) ==
+                I2CLCD_ERR_INVALID_ARG;
+    trace_ok &= replay_fresh(path, I2CLCD_REPLAY_FAST |
+                             I2CLCD_REPLAY_ANY_ADDR, 0x26, NULL, &got) ==
+                I2CLCD_OK &&
+                memcmp(got.ddram, want.ddram, sizeof(want.ddram)) == 0;
+    trace_ok &= replay_fresh(path, I2CLCD_REPLAY_FAST |
+                             I2CLCD_REPLAY_ANY_ADDR, 0x27, config_mjkdz,
+                             &got) == I2CLCD_ERR_INVALID_ARG;
+
+    /* A record cut short is an I/O error, not a shorter trace */
+    fp = fopen(path, "rb");
+    trace_ok &= fp && fseek(fp, 0, SEEK_END) == 0;
+    size = fp ? ftell(fp) : 0;
+    if (fp) {
+        fclose(fp);
+    }
+    trace_ok &= size > 1 && truncate(path, size - 1) == 0 &&
+                replay_fresh(path, I2CLCD_REPLAY_FAST, 0x27, NULL, &got) ==
+                I2CLCD_ERR_IO;
+
+    unlink(path);
+}
+
+static bool check_trace(i2clcd_t *lcd)
+{
+    (void)lcd;
+    return trace_ok;
+}
+
+static const sequence_t sequences[] = {
+    { "init_16x2",      I2CLCD_16X2, true,  run_init,
+      { "                ", "                " }, NULL, NULL },
+    { "set_line_20x4",  I2CLCD_20X4, false, run_set_line_strobes,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " }, check_4bit, NULL },
+    { "clear_redraw_20x4", I2CLCD_20X4, false, run_clear_redraw,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " }, NULL, NULL },
+    { "cursor_text_16x2", I2CLCD_16X2, false, run_cursor_text,
+      { "2+2=4!          ", "    puts        " }, NULL, NULL },
+    { "create_char_all", I2CLCD_16X2, false, run_create_char,
+      { "                ", "                " }, check_create_char, NULL },
+    { "create_chars_16x2", I2CLCD_16X2, false, run_create_chars,
+      { "                ", "    !?          " }, check_create_chars, NULL },
+    { "counter_16x2",   I2CLCD_16X2, false, run_counter,
+      { "Count:       100", "                " }, NULL, NULL },
+    { "recovery_20x4",  I2CLCD_20X4, false, run_recovery,
+      { "Pass 7 row 0        ", "Pass 7 row 1        ",
+        "Pass 7 row 2        ", "Pass 7 row 3        " },
+      check_recovery, NULL },
+    { "hotplug_20x4",   I2CLCD_20X4, false, run_hotplug,
+      { "Row zero            ", "Written while gone  ",
+        "Row two             ", "Back                " },
+      check_hotplug, NULL },
+    { "scrub_20x4",     I2CLCD_20X4, false, run_scrub,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " }, check_scrub, NULL },
+    { "scrub_clean_20x4", I2CLCD_20X4, false, run_scrub_clean,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " }, check_scrub_clean,
+      NULL },
+    { "scrub_clean_mcp23008_20x4", I2CLCD_20X4, false, run_scrub_clean,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " }, check_scrub_blind,
+      config_mcp23008 },
+    { "readback_20x4",  I2CLCD_20X4, false, run_readback,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " },
+      check_readback, NULL },
+    { "pinmap_mjkdz_20x4", I2CLCD_20X4, false, run_pinmap,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " }, check_pinmap,
+      config_mjkdz },
+    { "set_line_mcp23008_20x4", I2CLCD_20X4, false, run_set_line,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " }, NULL,
+      config_mcp23008 },
+    { "set_line_mcp23017_20x4", I2CLCD_20X4, false, run_set_line_strobes,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " }, check_8bit,
+      config_mcp23017 },
+    { "drop_nibble_mcp23017_20x4", I2CLCD_20X4, false, run_drop_nibble,
+      { "                    ", "                    ",
+        "                    ", "                    " }, check_drop_nibble,
+      config_mcp23017 },
+    { "set_line_plate_16x2", I2CLCD_16X2, false, run_set_line,
+      { "Row zero        ", "Row one         " }, check_plate, config_plate },
+    { "buttons_plate_20x4", I2CLCD_20X4, false, run_buttons,
+      { "Row zero            ", "Row one             ",
+        "Row two             ", "Row three           " }, check_buttons,
+      config_plate },
+    { "hotplug_mcp23017_20x4", I2CLCD_20X4, false, run_hotplug,
+      { "Row zero            ", "Written while gone  ",
+        "Row two             ", "Back                " }, check_hotplug,
+      config_mcp23017 },
+    { "set_line_40x4",  I2CLCD_40X4, false, run_set_line,
+      { "Row zero                                ",
+        "Row one                                 ",
+        "Row two                                 ",
+        "Row three                               " }, check_dual, NULL },
+    { "clear_redraw_40x4", I2CLCD_40X4, false, run_clear_redraw,
+      { "Row zero                                ",
+        "Row one                                 ",
+        "Row two                                 ",
+        "Row three                               " }, check_concurrent, NULL },
+    { "cursor_40x4",    I2CLCD_40X4, false, run_cursor_40x4,
+      { "                                        ",
+        "E1                                      ",
+        "E2                                      ",
+        "                                        " }, check_cursor_40x4, NULL },
+    { "mux_flush_16x2", I2CLCD_16X2, false, run_mux_flush,
+      { "Channel 0 a     ", "                " }, check_mux_flush,
+      config_mux },
+    { "canvas_2x2_16x2", I2CLCD_16X2, false, run_canvas,
+      { "    Hello video ", "                " }, check_canvas, NULL },
+    { "canvas_chain_16x2", I2CLCD_16X2, false, run_canvas_chain,
+      { "Mux M channel 0 ", "                " }, check_canvas_chain,
+      config_mux },
+    { "mirror_16x2",    I2CLCD_16X2, false, run_mirror,
+      { "Same on all     ", "Missed by two   " }, check_mirror, NULL },
+    { "mirror_budget_16x2", I2CLCD_16X2, false, run_mirror_budget,
+      { "Same on all     ", "Missed by one   " }, check_mirror, NULL },
+    { "glyph_cache_16x2", I2CLCD_16X2, false, run_glyph,
+      { "\x08\x09              ",
+        "\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f        " }, check_glyph, NULL },
+    { "anim_16x2",      I2CLCD_16X2, false, run_anim,
+      { "Busy \x08          ", "\x09               " }, check_anim, NULL },
+    { "priority_16x2",  I2CLCD_16X2, false, run_priority,
+      { "ALERTrefresh 000", "Bulk refresh 111" }, check_priority, NULL },
+    { "trace_replay_16x2", I2CLCD_16X2, false, run_trace,
+      { "Traced \x08\x09       ", "and replayed    " }, check_trace, NULL },
+};
+
+#define NUM_SEQUENCES (sizeof(sequences) / sizeof(sequences[0]))
+
+/*---------------------------------------------------------------------------
+ * Measurement
+ *---------------------------------------------------------------------------*/
+
+typedef struct {
+    char     name[64];
+    uint64_t bytes;
+    uint64_t xfers;
+    uint64_t delay_us;
+} cost_t;
+
+static int measure(const sequence_t *seq, cost_t *cost)
+{
+    i2clcd_config_t config = I2CLCD_CONFIG_DEFAULT;
+    i2clcd_vclock_t vc;
+    i2clcd_clock_t clock;
+    i2clcd_stats_t st;
+    i2clcd_t *lcd;
+    char line[I2CLCD_MAX_COLS + 1];
+    uint8_t rows, r;
+    int ret = 0;
+
+    i2clcd_vclock_init(&vc, &clock);
+    config.size = seq->size;
+    config.backend = I2CLCD_BACKEND_EMULATOR;
+    config.clock = &clock;
+    if (seq->configure) {
+        seq->configure(&config);
+    }
+
+    if (i2clcd_init(&config, &lcd) != I2CLCD_OK) {
+        fprintf(stderr, "%s: init failed\n", seq->name);
+        return -1;
+    }
+
+    /* The shadow is cold after init; start every sequence from a clear */
+    if (!seq->count_init) {
+        i2clcd_clear(lcd);
+        i2clcd_stats_reset(lcd);
+    }
+
+    seq->run(lcd);
+
+    i2clcd_stats_get(lcd, &st);
+    snprintf(cost->name, sizeof(cost->name), "%s", seq->name);
+    cost->bytes = st.bytes;
+    cost->xfers = st.xfers;
+    cost->delay_us = st.sleep_ns / 1000;
+
+    i2clcd_get_size(lcd, NULL, &rows);
+    for (r = 0; r < rows; r++) {
+        i2clcd_emu_line(lcd, r, line, sizeof(line));
+        if (strcmp(line, seq->expect[r]) != 0) {
+            fprintf(stderr, "%s: row %u is \"%s\", expected \"%s\"\n",
+                    seq->name, r, line, seq->expect[r]);
+            ret = -1;
+        }
+    }
+
+    if (seq->check && !seq->check(lcd)) {
+        fprintf(stderr, "%s: controller state check failed\n", seq->name);
+        ret = -1;
+    }
+
+    i2clcd_deinit(lcd);
+    return ret;
+}
+
+/*---------------------------------------------------------------------------
+ * Baseline File
+ *
+ * One line per sequence: name bytes transactions delay_us
+ *---------------------------------------------------------------------------*/
+
+static int load_baseline(const char *path, cost_t *base, size_t *count)
+{
+    FILE *fp;
+    char buf[256];
+    unsigned long long bytes, xfers, delay;
+
+    fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    *count = 0;
+    while (fgets(buf, sizeof(buf), fp) && *count < MAX_CASES) {
+        cost_t *c = &base[*count];
+
+        if (buf[0] == '#' || buf[0] == '\n') {
+            continue;
+        }
+        if (sscanf(buf, "%63s %llu %llu %llu", c->name,
+                   &bytes, &xfers, &delay) == 4) {
+            c->bytes = bytes;
+            c->xfers = xfers;
+            c->delay_us = delay;
+            (*count)++;
+        }
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+static int save_baseline(const char *path, const cost_t *costs, size_t count)
+{
+    FILE *fp;
+    size_t i;
+
+    fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+
+    fprintf(fp, "# name bytes transactions delay_us\n");
+    for (i = 0; i < count; i++) {
+        fprintf(fp, "%s %llu %llu %llu\n", costs[i].name,
+                (unsigned long long)costs[i].bytes,
+                (unsigned long long)costs[i].xfers,
+                (unsigned long long)costs[i].delay_us);
+    }
+
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+static const cost_t *find_cost(const cost_t *base, size_t count,
+                               const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (strcmp(base[i].name, name) == 0) {
+            return &base[i];
+        }
+    }
+    return NULL;
+}
+
+static int compare(const char *what, const char *name, uint64_t now,
+                   uint64_t base)
+{
+    if (now > base) {
+        printf("FAIL %s: %s %llu > baseline %llu\n", name, what,
+               (unsigned long long)now, (unsigned long long)base);
+        return -1;
+    }
+    if (now < base) {
+        printf("note %s: %s %llu < baseline %llu (update the baseline)\n",
+               name, what, (unsigned long long)now,
+               (unsigned long long)base);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    cost_t costs[NUM_SEQUENCES], base[MAX_CASES];
+    const cost_t *b;
+    size_t i, nbase = 0;
+    bool update = false;
+    int opt, failed = 0;
+
+    while ((opt = getopt(argc, argv, "u")) != -1) {
+        switch (opt) {
+        case 'u':
+            update = true;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-u] BASELINE\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-u] BASELINE\n", argv[0]);
+        return 2;
+    }
+
+    for (i = 0; i < NUM_SEQUENCES; i++) {
+        if (measure(&sequences[i], &costs[i]) < 0) {
+            failed++;
+        }
+    }
+
+    if (update) {
+        if (failed) {
+            fprintf(stderr, "Not updating baseline: state checks failed\n");
+            return 1;
+        }
+        if (save_baseline(argv[optind], costs, NUM_SEQUENCES) < 0) {
+            perror(argv[optind]);
+            return 1;
+        }
+        printf("Baseline written to %s\n", argv[optind]);
+        return 0;
+    }
+
+    if (load_baseline(argv[optind], base, &nbase) < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    for (i = 0; i < NUM_SEQUENCES; i++) {
+        b = find_cost(base, nbase, costs[i].name);
+        if (!b) {
+            printf("FAIL %s: not in baseline\n", costs[i].name);
+            failed++;
+            continue;
+        }
+        if (compare("bytes", costs[i].name, costs[i].bytes, b->bytes) < 0 ||
+            compare("transactions", costs[i].name,
+                    costs[i].xfers, b->xfers) < 0 ||
+            compare("delay_us", costs[i].name,
+                    costs[i].delay_us, b->delay_us) < 0) {
+            failed++;
+        }
+    }
+
+    printf("%zu sequences, %d failed\n", NUM_SEQUENCES, failed);
+    return failed ? 1 : 0;
+}